@@ -0,0 +1,506 @@
+#include "beta99_player.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "sid_engine.h"
+
+namespace {
+
+// Bundle layout (tools/beta99_pack.py, little-endian):
+//   header  "B99F" u16 version u16 reserved u32 ssf_count u32 trigger_count
+//   ssf     u64 hashid u32 duration u32 op_count, then op_count ops
+//   op      u32 delta u8 opcode u8 length, then length payload bytes
+//   trigger u32 delta u16 ssf_index u8 voice u8 pad
+// A B99R bundle has the same header and triggers but its SSF table is
+// ssf_count u32 indices into a B99D dictionary:
+//   header  "B99D" u16 version u16 reserved u32 entry_count u32 reserved
+//   then entry_count u32 file offsets of ssf records
+constexpr uint32_t kBundleMagic = 0x46393942u;  // "B99F"
+constexpr uint32_t kRefBundleMagic = 0x52393942u;  // "B99R"
+constexpr uint32_t kDictMagic = 0x44393942u;  // "B99D"
+constexpr uint16_t kBundleVersion = 1;
+constexpr size_t kHeaderSize = 16;
+constexpr size_t kSsfHeaderSize = 16;
+constexpr size_t kOpHeaderSize = 6;
+constexpr size_t kTriggerSize = 8;
+
+constexpr uint8_t kOpSetFreq = 0x01;
+constexpr uint8_t kOpSetPw = 0x02;
+constexpr uint8_t kOpSetCtrl = 0x03;
+constexpr uint8_t kOpSetAd = 0x04;
+constexpr uint8_t kOpSetSr = 0x05;
+constexpr uint8_t kOpSetModFreq = 0x06;
+constexpr uint8_t kOpSetModTest = 0x07;
+constexpr uint8_t kOpSetFilterRoute = 0x08;
+constexpr uint8_t kOpSetFilterExt = 0x09;
+constexpr uint8_t kOpSetFilterCutoff = 0x0A;
+constexpr uint8_t kOpSetFilterRes = 0x0B;
+constexpr uint8_t kOpSetFilterMode = 0x0C;
+constexpr uint8_t kOpSetVolume = 0x0D;
+
+constexpr uint8_t kChipMaskBoth = 0x3;
+constexpr uint8_t kRegFilterResRoute = 0x17;
+constexpr uint8_t kRegModeVolume = 0x18;
+
+// Keep the engine queue at most half full so it never drops events.
+constexpr uint32_t kQueueFillDivisor = 2;
+// Writes are expanded at most this far ahead of what the engine is playing
+// (two PAL frames), so a dense passage reaches the queue as a steady
+// stream rather than one burst of everything that fits.
+constexpr uint32_t kDefaultLookaheadCycles = 2 * 19656;
+// Streamed triggers: how far past the newest trigger SSF ops may run
+// before we wait for the host (one PAL frame).
+constexpr uint64_t kStreamHorizonCycles = 19656;
+constexpr size_t kStreamQueueSize = 256;
+
+struct Trigger {
+    uint32_t delta;
+    uint16_t ssf;
+    uint8_t voice;
+};
+
+// One SSF (and any chunks it was split into) playing on a voice.
+struct Cursor {
+    bool active;
+    uint16_t ssf;
+    uint16_t last_ssf;         // final chunk of this fragment
+    const uint8_t *op;         // next op
+    uint32_t ops_left;         // in the current chunk
+    uint64_t start_clock;
+    uint64_t clock;            // time of the previous op
+};
+
+const uint8_t *g_bundle = nullptr;
+const uint8_t **g_ssfs = nullptr;  // record per SSF, in the bundle or dictionary
+uint32_t g_ssf_count = 0;
+const uint8_t *g_triggers = nullptr;
+uint32_t g_trigger_count = 0;
+
+const uint8_t *g_dict = nullptr;
+size_t g_dict_size = 0;
+uint32_t g_dict_count = 0;
+
+beta99_trigger_source_t g_source = BETA99_TRIGGERS_BUNDLE;
+bool g_playing = false;
+uint32_t g_lookahead = kDefaultLookaheadCycles;
+uint32_t g_next_trigger = 0;
+uint64_t g_trigger_clock = 0;   // time of the previous trigger
+uint64_t g_emit_clock = 0;      // time of the last queued write
+Cursor g_cursors[3] = {};
+uint8_t g_regs[0x19] = {};
+
+Trigger g_stream[kStreamQueueSize];
+size_t g_stream_head = 0;
+size_t g_stream_tail = 0;
+
+beta99_player_stats_t g_stats = {};
+
+inline uint16_t rd16(const uint8_t *p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline uint32_t rd32(const uint8_t *p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline uint64_t ssf_hashid(uint16_t ssf) {
+    const uint8_t *p = g_ssfs[ssf];
+    return static_cast<uint64_t>(rd32(p)) | (static_cast<uint64_t>(rd32(p + 4)) << 32);
+}
+
+// Trigger voices are 1-3 as in the desidulate log; 0 (no voice column or a
+// voice-less fragment) plays on voice 1 like the packer's default.
+inline uint8_t trigger_voice_index(uint8_t voice) {
+    if (voice == 0) return 0;
+    return static_cast<uint8_t>((voice > 3 ? 3 : voice) - 1);
+}
+
+void emit_write(uint64_t clock, uint8_t addr, uint8_t value) {
+    uint64_t delta = (clock > g_emit_clock) ? clock - g_emit_clock : 0;
+    if (delta > UINT32_MAX) {
+        delta = UINT32_MAX;
+    }
+    sid_engine_queue_event(kChipMaskBoth, addr, value, static_cast<uint32_t>(delta));
+    g_emit_clock += delta;
+    g_regs[addr] = value;
+    g_stats.events_queued++;
+}
+
+void set_reg_bits(uint64_t clock, uint8_t addr, uint8_t mask, uint8_t bits) {
+    emit_write(clock, addr, static_cast<uint8_t>((g_regs[addr] & ~mask) | (bits & mask)));
+}
+
+// Register writes for one SSF op on a voice. freq3/test3 belong to the
+// voice that modulates this one (voice 3 for voice 1, and so on).
+void apply_op(uint64_t clock, uint8_t voice, uint8_t opcode, const uint8_t *data, uint8_t len) {
+    const uint8_t base = static_cast<uint8_t>(voice * 7);
+    const uint8_t mod_base = static_cast<uint8_t>(((voice + 2) % 3) * 7);
+    const uint16_t v16 = (len >= 2) ? rd16(data) : 0;
+    const uint8_t v8 = (len >= 1) ? data[0] : 0;
+
+    switch (opcode) {
+        case kOpSetFreq:
+            emit_write(clock, base + 0, static_cast<uint8_t>(v16 & 0xff));
+            emit_write(clock, base + 1, static_cast<uint8_t>(v16 >> 8));
+            break;
+        case kOpSetPw:
+            emit_write(clock, base + 2, static_cast<uint8_t>(v16 & 0xff));
+            emit_write(clock, base + 3, static_cast<uint8_t>((v16 >> 8) & 0x0f));
+            break;
+        case kOpSetCtrl:
+            emit_write(clock, base + 4, v8);
+            break;
+        case kOpSetAd:
+            emit_write(clock, base + 5, v8);
+            break;
+        case kOpSetSr:
+            emit_write(clock, base + 6, v8);
+            break;
+        case kOpSetModFreq:
+            emit_write(clock, mod_base + 0, static_cast<uint8_t>(v16 & 0xff));
+            emit_write(clock, mod_base + 1, static_cast<uint8_t>(v16 >> 8));
+            break;
+        case kOpSetModTest:
+            set_reg_bits(clock, mod_base + 4, 0x08, v8 ? 0x08 : 0x00);
+            break;
+        case kOpSetFilterRoute:
+            set_reg_bits(clock, kRegFilterResRoute, static_cast<uint8_t>(1u << voice),
+                         v8 ? static_cast<uint8_t>(1u << voice) : 0x00);
+            break;
+        case kOpSetFilterExt:
+            set_reg_bits(clock, kRegFilterResRoute, 0x08, v8 ? 0x08 : 0x00);
+            break;
+        case kOpSetFilterCutoff:
+            emit_write(clock, 0x15, static_cast<uint8_t>(v16 & 0x07));
+            emit_write(clock, 0x16, static_cast<uint8_t>((v16 >> 3) & 0xff));
+            break;
+        case kOpSetFilterRes:
+            set_reg_bits(clock, kRegFilterResRoute, 0xf0, static_cast<uint8_t>(v8 << 4));
+            break;
+        case kOpSetFilterMode:
+            set_reg_bits(clock, kRegModeVolume, 0x70, static_cast<uint8_t>((v8 & 0x07) << 4));
+            break;
+        case kOpSetVolume:
+            set_reg_bits(clock, kRegModeVolume, 0x0f, v8);
+            break;
+        default:
+            break;  // unknown ops are skipped, their delta still counts
+    }
+}
+
+void cursor_load_chunk(Cursor &c, uint16_t ssf) {
+    const uint8_t *p = g_ssfs[ssf];
+    c.ssf = ssf;
+    c.ops_left = rd32(p + 12);
+    c.op = p + kSsfHeaderSize;
+}
+
+// Move to the next chunk when the current one is used up. Chunk deltas
+// continue from the previous chunk's last op.
+bool cursor_ready(Cursor &c) {
+    while (c.active && c.ops_left == 0) {
+        if (c.ssf >= c.last_ssf) {
+            c.active = false;
+            break;
+        }
+        cursor_load_chunk(c, static_cast<uint16_t>(c.ssf + 1));
+    }
+    return c.active;
+}
+
+inline uint64_t cursor_next_clock(const Cursor &c) {
+    return c.clock + rd32(c.op);
+}
+
+void start_trigger(uint64_t clock, uint16_t ssf, uint8_t voice_raw) {
+    if (ssf >= g_ssf_count) {
+        g_stats.triggers_invalid++;
+        return;
+    }
+    g_stats.triggers_played++;
+    Cursor &c = g_cursors[trigger_voice_index(voice_raw)];
+
+    // The packer splits long fragments into consecutive chunks and
+    // triggers each at the same time; play them back to back instead.
+    if (c.active && c.start_clock == clock && ssf == c.last_ssf + 1 &&
+        ssf_hashid(ssf) == ssf_hashid(c.last_ssf)) {
+        c.last_ssf = ssf;
+        return;
+    }
+
+    c.active = true;
+    c.last_ssf = ssf;
+    c.start_clock = clock;
+    c.clock = clock;
+    cursor_load_chunk(c, ssf);
+    cursor_ready(c);
+}
+
+bool peek_trigger(Trigger *out) {
+    if (g_source == BETA99_TRIGGERS_BUNDLE) {
+        if (g_next_trigger >= g_trigger_count) return false;
+        const uint8_t *p = g_triggers + g_next_trigger * kTriggerSize;
+        out->delta = rd32(p);
+        out->ssf = rd16(p + 4);
+        out->voice = p[6];
+        return true;
+    }
+    if (g_stream_head == g_stream_tail) return false;
+    *out = g_stream[g_stream_head];
+    return true;
+}
+
+void consume_trigger() {
+    if (g_source == BETA99_TRIGGERS_BUNDLE) {
+        g_next_trigger++;
+    } else {
+        g_stream_head = (g_stream_head + 1) % kStreamQueueSize;
+    }
+}
+
+// Queue the earliest pending trigger or SSF op. False when nothing is due
+// yet (or ever).
+bool step() {
+    Trigger trig = {};
+    bool have_trigger = peek_trigger(&trig);
+    uint64_t trigger_clock = have_trigger ? g_trigger_clock + trig.delta : UINT64_MAX;
+
+    Cursor *next = nullptr;
+    uint64_t next_clock = UINT64_MAX;
+    for (Cursor &c : g_cursors) {
+        if (!cursor_ready(c)) continue;
+        uint64_t t = cursor_next_clock(c);
+        if (t < next_clock) {
+            next_clock = t;
+            next = &c;
+        }
+    }
+
+    if (have_trigger && trigger_clock <= next_clock) {
+        consume_trigger();
+        if (g_source == BETA99_TRIGGERS_STREAM && trigger_clock < g_emit_clock) {
+            g_stats.triggers_late++;
+            trigger_clock = g_emit_clock;
+        }
+        g_trigger_clock = trigger_clock;
+        start_trigger(trigger_clock, trig.ssf, trig.voice);
+        return true;
+    }
+    if (!next) {
+        if (g_source == BETA99_TRIGGERS_BUNDLE && !have_trigger) {
+            g_playing = false;
+        }
+        return false;
+    }
+    if (g_source == BETA99_TRIGGERS_STREAM && !have_trigger &&
+        next_clock > g_trigger_clock + kStreamHorizonCycles) {
+        return false;
+    }
+
+    const uint8_t *op = next->op;
+    uint8_t opcode = op[4];
+    uint8_t len = op[5];
+    apply_op(next_clock, static_cast<uint8_t>(next - g_cursors), opcode, op + kOpHeaderSize, len);
+    next->clock = next_clock;
+    next->op += kOpHeaderSize + len;
+    next->ops_left--;
+    return true;
+}
+
+void unload_bundle() {
+    beta99_player_stop();
+    delete[] g_ssfs;
+    g_ssfs = nullptr;
+    g_bundle = nullptr;
+    g_ssf_count = 0;
+    g_triggers = nullptr;
+    g_trigger_count = 0;
+    g_stats.ssf_count = 0;
+    g_stats.trigger_count = 0;
+}
+
+}  // namespace
+
+bool beta99_player_set_dictionary(const uint8_t *data, size_t size) {
+    unload_bundle();
+    g_dict = nullptr;
+    g_dict_size = 0;
+    g_dict_count = 0;
+    if (!data) {
+        return true;
+    }
+    if (size < kHeaderSize || rd32(data) != kDictMagic || rd16(data + 4) != kBundleVersion ||
+        (size - kHeaderSize) / 4 < rd32(data + 8)) {
+        return false;
+    }
+    g_dict = data;
+    g_dict_size = size;
+    g_dict_count = rd32(data + 8);
+    return true;
+}
+
+bool beta99_player_load(const uint8_t *data, size_t size) {
+    unload_bundle();
+
+    if (!data || size < kHeaderSize || rd16(data + 4) != kBundleVersion) {
+        return false;
+    }
+    const uint32_t magic = rd32(data);
+    const bool by_ref = (magic == kRefBundleMagic);
+    if (magic != kBundleMagic && !(by_ref && g_dict)) {
+        return false;
+    }
+    uint32_t ssf_count = rd32(data + 8);
+    uint32_t trigger_count = rd32(data + 12);
+    if (ssf_count > 0x10000u) {
+        return false;
+    }
+
+    // Records are checked once here so playback can read them unchecked.
+    // Dictionary entries are checked as bundles reference them.
+    const uint8_t **ssfs = new const uint8_t *[ssf_count ? ssf_count : 1];
+    const uint8_t *end = data + size;
+    const uint8_t *p = data + kHeaderSize;
+    for (uint32_t i = 0; i < ssf_count; ++i) {
+        const uint8_t *rec = p;
+        const uint8_t *rec_end = end;
+        if (by_ref) {
+            if (end - p < 4 || rd32(p) >= g_dict_count) {
+                delete[] ssfs;
+                return false;
+            }
+            uint32_t off = rd32(g_dict + kHeaderSize + 4 * rd32(p));
+            if (off >= g_dict_size) {
+                delete[] ssfs;
+                return false;
+            }
+            rec = g_dict + off;
+            rec_end = g_dict + g_dict_size;
+            p += 4;
+        }
+        const uint8_t *q = rec;
+        bool ok = (rec_end - q) >= static_cast<ptrdiff_t>(kSsfHeaderSize);
+        uint32_t ops = ok ? rd32(q + 12) : 0;
+        q += ok ? kSsfHeaderSize : 0;
+        for (uint32_t n = 0; ok && n < ops; ++n) {
+            ok = (rec_end - q) >= static_cast<ptrdiff_t>(kOpHeaderSize) &&
+                 (rec_end - q) - static_cast<ptrdiff_t>(kOpHeaderSize) >= q[5];
+            q += ok ? kOpHeaderSize + q[5] : 0;
+        }
+        if (!ok) {
+            delete[] ssfs;
+            return false;
+        }
+        ssfs[i] = rec;
+        if (!by_ref) {
+            p = q;
+        }
+    }
+    if (static_cast<size_t>(end - p) / kTriggerSize < trigger_count) {
+        delete[] ssfs;
+        return false;
+    }
+
+    g_bundle = data;
+    g_ssfs = ssfs;
+    g_ssf_count = ssf_count;
+    g_triggers = p;
+    g_trigger_count = trigger_count;
+    g_stats.ssf_count = ssf_count;
+    g_stats.trigger_count = trigger_count;
+    return true;
+}
+
+void beta99_player_start(beta99_trigger_source_t source) {
+    if (!g_bundle) {
+        return;
+    }
+    g_source = source;
+    g_next_trigger = 0;
+    g_trigger_clock = 0;
+    g_emit_clock = 0;
+    g_stream_head = g_stream_tail = 0;
+    memset(g_cursors, 0, sizeof g_cursors);
+    memset(g_regs, 0, sizeof g_regs);
+    g_regs[kRegModeVolume] = 0x0f;  // matches the engine's reset state
+    g_stats.triggers_played = 0;
+    g_stats.triggers_late = 0;
+    g_stats.triggers_invalid = 0;
+    g_stats.events_queued = 0;
+    g_stats.queue_depth = 0;
+    g_stats.queue_depth_peak = 0;
+    g_stats.lead_cycles = 0;
+    g_stats.underruns = 0;
+    sid_engine_reset_queue_state();
+    g_playing = true;
+}
+
+void beta99_player_stop(void) {
+    g_playing = false;
+    memset(g_cursors, 0, sizeof g_cursors);
+}
+
+bool beta99_player_push_trigger(uint32_t delta, uint16_t ssf_index, uint8_t voice) {
+    size_t next = (g_stream_tail + 1) % kStreamQueueSize;
+    if (next == g_stream_head) {
+        return false;
+    }
+    g_stream[g_stream_tail] = Trigger{delta, ssf_index, voice};
+    g_stream_tail = next;
+    return true;
+}
+
+void beta99_player_set_lookahead(uint32_t cycles) {
+    g_lookahead = cycles;
+}
+
+void beta99_player_service(void) {
+    if (!g_playing) {
+        return;
+    }
+    sid_engine_queue_stats_t qs;
+    sid_engine_get_queue_stats(&qs);
+    uint32_t limit = qs.capacity / kQueueFillDivisor;
+    g_stats.queue_limit = limit;
+    if (qs.depth == 0 && g_stats.queue_depth != 0) {
+        g_stats.underruns++;
+    }
+    // The engine is pending_cycles behind the last write we queued (an
+    // empty queue holds its clock). Fill until the queue reaches the end of
+    // the lookahead window; the write that crosses it carries any longer
+    // gap in its delta, so the queue does not run dry between services.
+    uint64_t play_clock = g_emit_clock - (qs.pending_cycles < g_emit_clock ? qs.pending_cycles
+                                                                            : g_emit_clock);
+    uint64_t window = g_lookahead ? play_clock + g_lookahead : UINT64_MAX;
+    uint32_t before = g_stats.events_queued;
+    // A single op writes at most two registers.
+    while (g_playing && g_emit_clock < window &&
+           qs.depth + (g_stats.events_queued - before) + 2 <= limit) {
+        if (!step()) {
+            break;
+        }
+    }
+    uint32_t depth = qs.depth + (g_stats.events_queued - before);
+    g_stats.queue_depth = depth;
+    if (depth > g_stats.queue_depth_peak) {
+        g_stats.queue_depth_peak = depth;
+    }
+    g_stats.lead_cycles = static_cast<uint32_t>(g_emit_clock - play_clock);
+}
+
+bool beta99_player_is_playing(void) {
+    return g_playing;
+}
+
+void beta99_player_get_stats(beta99_player_stats_t *out) {
+    if (!out) {
+        return;
+    }
+    *out = g_stats;
+    out->playing = g_playing;
+    out->lookahead_cycles = g_lookahead;
+    out->stream_pending = static_cast<uint32_t>(
+        (g_stream_tail + kStreamQueueSize - g_stream_head) % kStreamQueueSize);
+}
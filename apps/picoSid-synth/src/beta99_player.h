@@ -0,0 +1,60 @@
+#ifndef PICO_SID_SYNTH_BETA99_PLAYER_H_
+#define PICO_SID_SYNTH_BETA99_PLAYER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Where triggers come from once playback starts: the bundle's own
+// timeline, or beta99_player_push_trigger() (e.g. from USB).
+typedef enum {
+    BETA99_TRIGGERS_BUNDLE = 0,
+    BETA99_TRIGGERS_STREAM = 1,
+} beta99_trigger_source_t;
+
+typedef struct {
+    uint32_t ssf_count;
+    uint32_t trigger_count;       // triggers in the bundle
+    uint32_t triggers_played;
+    uint32_t triggers_late;       // streamed triggers that arrived behind the clock
+    uint32_t triggers_invalid;    // unknown SSF index
+    uint32_t events_queued;
+    uint32_t stream_pending;      // streamed triggers not yet scheduled
+    uint32_t lookahead_cycles;    // how far ahead of playback writes are queued
+    uint32_t queue_limit;         // engine queue depth the player never exceeds
+    uint32_t queue_depth;         // engine queue depth after the last service
+    uint32_t queue_depth_peak;    // worst case since start
+    uint32_t lead_cycles;         // queued time ahead of playback, last service
+    uint32_t underruns;           // times the queue ran dry between services
+    bool playing;
+} beta99_player_stats_t;
+
+// Use a B99D SSF dictionary (shared by a corpus of B99R bundles), kept in
+// place like the bundles, typically in flash. NULL drops it. Either way the
+// loaded bundle is unloaded.
+bool beta99_player_set_dictionary(const uint8_t *data, size_t size);
+// Validate a B99F bundle, or a B99R bundle against the dictionary, and
+// index its SSFs. The bundle is used in place (RAM or XIP flash) and must
+// stay valid until the next load.
+bool beta99_player_load(const uint8_t *data, size_t size);
+void beta99_player_start(beta99_trigger_source_t source);
+void beta99_player_stop(void);
+// Queue a streamed trigger; delta is in SID cycles since the previous one.
+bool beta99_player_push_trigger(uint32_t delta, uint16_t ssf_index, uint8_t voice);
+// Expand SSF ops into sid_engine_queue_event() up to the lookahead window
+// ahead of playback, merged across voices in time order; call from the
+// main loop at least once per window. 0 only bounds by queue depth.
+void beta99_player_set_lookahead(uint32_t cycles);
+void beta99_player_service(void);
+bool beta99_player_is_playing(void);
+void beta99_player_get_stats(beta99_player_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // PICO_SID_SYNTH_BETA99_PLAYER_H_
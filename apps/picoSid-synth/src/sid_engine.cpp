@@ -4,7 +4,13 @@
 #include <stddef.h>
 #include <climits>
 
+#ifdef SID_ENGINE_HOST
+// Host builds (tools/oddtracker) queue and render from one audio thread.
+static inline uint32_t save_and_disable_interrupts(void) { return 0; }
+static inline void restore_interrupts(uint32_t) {}
+#else
 #include "hardware/sync.h"
+#endif
 
 #include "reSID16/sid.h"
 #include "reSID16/siddefs.h"
@@ -66,6 +72,10 @@ size_t g_event_head = 0;
 size_t g_event_tail = 0;
 uint32_t g_cycles_to_next_event = UINT32_MAX;
 uint32_t g_event_drop_count = 0;
+// Deltas ever queued / ever applied; each is written by one side only, so
+// their difference (less the head's progress) is the queued time span.
+uint64_t g_cycles_queued = 0;
+uint64_t g_cycles_applied = 0;
 
 inline size_t advance_index(size_t idx) { return (idx + 1) % kEventQueueSize; }
 inline bool event_queue_empty() { return g_event_head == g_event_tail; }
@@ -108,6 +118,7 @@ void apply_event(const TimedEvent &ev) {
 bool pop_event(TimedEvent *out) {
     if (event_queue_empty()) return false;
     *out = g_event_queue[g_event_head];
+    g_cycles_applied += out->delta;
     g_event_head = advance_index(g_event_head);
     if (event_queue_empty()) {
         g_cycles_to_next_event = UINT32_MAX;
@@ -400,6 +411,12 @@ void sid_engine_render_frame(int16_t *left, int16_t *right) {
     *right = clamp16(right_scaled);
 }
 
+void sid_engine_render_block(int16_t *stereo, size_t frames) {
+    for (size_t i = 0; i < frames; ++i) {
+        sid_engine_render_frame(&stereo[2 * i], &stereo[2 * i + 1]);
+    }
+}
+
 void sid_engine_queue_event(uint8_t chip_mask, uint8_t addr, uint8_t value, uint32_t delta_cycles) {
     size_t next_tail = advance_index(g_event_tail);
     if (next_tail == g_event_head) {
@@ -411,6 +428,7 @@ void sid_engine_queue_event(uint8_t chip_mask, uint8_t addr, uint8_t value, uint
     g_event_queue[g_event_tail].addr = addr;
     g_event_queue[g_event_tail].value = value;
     g_event_queue[g_event_tail].delta = delta_cycles;
+    g_cycles_queued += delta_cycles;
     g_event_tail = next_tail;
 
     if (g_cycles_to_next_event == UINT32_MAX) {
@@ -457,6 +475,14 @@ static float clamp_master_volume(float level) {
     return level;
 }
 
+void sid_engine_set_filter_enabled(bool enabled) {
+    for (SID16 *sid : g_sids) {
+        if (sid) {
+            sid->enable_filter(enabled);
+        }
+    }
+}
+
 void sid_engine_set_master_volume(float level) {
     g_master_volume = clamp_master_volume(level);
 }
@@ -517,6 +543,8 @@ void sid_engine_reset_queue_state(void) {
     g_event_tail = 0;
     g_cycles_to_next_event = UINT32_MAX;
     g_event_drop_count = 0;
+    g_cycles_queued = 0;
+    g_cycles_applied = 0;
     g_cycle_residual = 0.0;
 }
 
@@ -552,5 +580,13 @@ void sid_engine_get_queue_stats(sid_engine_queue_stats_t *stats) {
     stats->capacity = static_cast<uint32_t>(kEventQueueSize);
     stats->dropped = g_event_drop_count;
     stats->cycles_to_next = (g_cycles_to_next_event == UINT32_MAX) ? 0u : g_cycles_to_next_event;
+    uint64_t pending = 0;
+    if (!event_queue_empty()) {
+        // The head event's delta is partly played already.
+        uint32_t head_delta = g_event_queue[g_event_head].delta;
+        uint32_t head_left = (g_cycles_to_next_event == UINT32_MAX) ? head_delta : g_cycles_to_next_event;
+        pending = g_cycles_queued - g_cycles_applied - (head_delta - head_left);
+    }
+    stats->pending_cycles = pending > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(pending);
     restore_interrupts(save);
 }
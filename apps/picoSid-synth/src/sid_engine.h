@@ -13,12 +13,16 @@ void sid_engine_init(uint32_t sample_rate_hz);
 void sid_engine_note_on(uint8_t midi_note, uint8_t velocity);
 void sid_engine_note_off(uint8_t midi_note);
 void sid_engine_render_frame(int16_t *left, int16_t *right);
+// Interleaved left/right frames, e.g. one host audio callback's buffer.
+void sid_engine_render_block(int16_t *stereo, size_t frames);
 void sid_engine_queue_event(uint8_t chip, uint8_t addr, uint8_t value, uint32_t delta_cycles);
 void sid_engine_set_channel_models(bool left_6581, bool right_6581);
 void sid_engine_set_model(bool use_6581);
 bool sid_engine_is_6581(void);
 void sid_engine_set_split_channels(bool split);
 bool sid_engine_get_split_channels(void);
+// The filter is off by default to save cycles on the device.
+void sid_engine_set_filter_enabled(bool enabled);
 void sid_engine_set_master_volume(float level);
 float sid_engine_get_master_volume(void);
 typedef struct {
@@ -33,6 +37,7 @@ typedef struct {
     uint32_t capacity;
     uint32_t dropped;
     uint32_t cycles_to_next;
+    uint32_t pending_cycles;  // until the last queued event is applied
 } sid_engine_queue_stats_t;
 typedef struct {
     uint16_t voice_freq[3];
@@ -7,12 +7,30 @@
 #include <cstdint>
 #include <cassert>
 #include <cstddef>
+#include <cstdlib>
 #include <algorithm>
 #include <map>
 #include <set>
 #include <functional>
 #include <cstdio>
 #include <cstring>
+#include <climits>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+
+// the per pixel kernels have SSE2 (and for the dither AVX2) versions; define CONVERT_SCALAR to use
+// the scalar reference versions instead. convert --selftest checks them against the reference.
+#if !defined(CONVERT_SCALAR) && defined(__AVX2__)
+#include <immintrin.h>
+#define CONVERT_AVX2 1
+#endif
+#if !defined(CONVERT_SCALAR) && defined(__SSE2__)
+#include <emmintrin.h>
+#define CONVERT_SSE2 1
+#endif
 
 // add a word at the end of every row with debug information
 // #define ADD_EOR_DEBUGGING
@@ -112,18 +130,54 @@ static inline void dither(uint8_t& r, uint8_t& g, uint8_t &b, uint x3, uint y3)
     dither(b, x3, y3);
 }
 
-void dither_image(uint w, uint h, std::vector<unsigned char> &source)
+// reference version of dither_image()
+static void dither_image_scalar(uint w, uint h, uint8_t *source)
 {
     for(uint y=0; y < h; y++) {
         uint8_t *base = &source[y * w * 3];
-        for(uint x = 0; x < w; x+= 4) {
-#if 1
-            dither(base[0], base[1], base[2], 0, y&3u);
-            dither(base[3], base[4], base[5], 1, y&3u);
-            dither(base[6], base[7], base[8], 2, y&3u);
-            dither(base[9], base[10], base[11], 3, y&3u);
+        for(uint x = 0; x < w; x++) {
+            dither(base[0], base[1], base[2], x&3u, y&3u);
+            base += 3;
+        }
+    }
+}
+
+void dither_image(uint w, uint h, std::vector<unsigned char> &source)
+{
+    // dp[] / 2 for each byte of a row: the 12 byte (4 pixel) period repeated to 96 bytes, which
+    // 16 and 32 byte vectors both divide
+    uint8_t add[4][96];
+    for(uint y3 = 0; y3 < 4; y3++) {
+        for(uint k = 0; k < 96; k++) {
+            add[y3][k] = dp[(k / 3u) % 4u + y3 * 4] / 2;
+        }
+    }
+    uint n = w * 3;
+    for(uint y=0; y < h; y++) {
+        uint8_t *base = &source[y * n];
+        const uint8_t *row_add = add[y & 3u];
+        uint x = 0;
+#if CONVERT_AVX2
+        const __m256i mask256 = _mm256_set1_epi8((char)0xf8);
+        for(; x + 96 <= n; x += 96) {
+            for(uint j = 0; j < 96; j += 32) {
+                __m256i v = _mm256_loadu_si256((const __m256i *)(base + x + j));
+                v = _mm256_adds_epu8(v, _mm256_loadu_si256((const __m256i *)(row_add + j)));
+                _mm256_storeu_si256((__m256i *)(base + x + j), _mm256_and_si256(v, mask256));
+            }
+        }
+#endif
+#if CONVERT_SSE2
+        const __m128i mask = _mm_set1_epi8((char)0xf8);
+        for(; x + 16 <= n; x += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(base + x));
+            v = _mm_adds_epu8(v, _mm_loadu_si128((const __m128i *)(row_add + x % 96)));
+            _mm_storeu_si128((__m128i *)(base + x), _mm_and_si128(v, mask));
+        }
 #endif
-            base += 12;
+        for(; x < n; x++) {
+            uint v = base[x] + row_add[x % 96];
+            base[x] = std::min(v, 255u) & 0xf8u;
         }
     }
 }
@@ -168,82 +222,143 @@ static inline uint get_key(uint min, uint da, uint db, uint dc, uint dd) {
            (((dd - min) >> 3u) << 5u * 0u);
 }
 
+// the per channel 2x2 quad minimum and lookup key for every byte offset k of a row pair: for the
+// quad of pixels x, x+1 (k = 3x + channel, x even) the minimum of row0[k], row0[k+3], row1[k] and
+// row1[k+3], and their distances from it as get_key() packs them. Entries for odd x are left over
+// from the vector loop and not used.
+static void quad_keys_scalar(const uint8_t *row0, const uint8_t *row1, uint k, uint n, uint8_t *mins, uint32_t *keys)
+{
+    for(; k < n; k++) {
+        if (k % 6u >= 3) continue;
+        uint m = std::min({row0[k], row0[k + 3], row1[k], row1[k + 3]});
+        mins[k] = m;
+        keys[k] = get_key(m, row0[k], row0[k + 3], row1[k], row1[k + 3]);
+    }
+}
 
-#ifndef ENCODE_565
-bool compress_image(const char *name, uint w, uint h, std::vector<unsigned char> &source, std::vector<unsigned char> &dest, std::vector<uint32_t> &line_offsets, uint max_rdist, uint max_gdist, uint max_bdist, uint extra_line_words = 0)
+static void quad_keys(const uint8_t *row0, const uint8_t *row1, uint w, uint8_t *mins, uint32_t *keys)
 {
-    bool use_56bit_raw = true;
+    uint n = w * 3;
+    uint k = 0;
+#if CONVERT_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mask5 = _mm_set1_epi8(0x1f);
+    const __m128i one = _mm_set1_epi16(1);
+    // the +3 loads read 3 bytes ahead; stop short of the end of the row
+    for(; k + 19 <= n; k += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(row0 + k));
+        __m128i b = _mm_loadu_si128((const __m128i *)(row0 + k + 3));
+        __m128i c = _mm_loadu_si128((const __m128i *)(row1 + k));
+        __m128i d = _mm_loadu_si128((const __m128i *)(row1 + k + 3));
+        __m128i m = _mm_min_epu8(_mm_min_epu8(a, b), _mm_min_epu8(c, d));
+        _mm_storeu_si128((__m128i *)(mins + k), m);
+        // dithered values are multiples of 8, so (v - min) >> 3 is exact
+        a = _mm_and_si128(_mm_srli_epi16(_mm_sub_epi8(a, m), 3), mask5);
+        b = _mm_and_si128(_mm_srli_epi16(_mm_sub_epi8(b, m), 3), mask5);
+        c = _mm_and_si128(_mm_srli_epi16(_mm_sub_epi8(c, m), 3), mask5);
+        d = _mm_and_si128(_mm_srli_epi16(_mm_sub_epi8(d, m), 3), mask5);
+        for(int half = 0; half < 2; half++) {
+            __m128i a16 = half ? _mm_unpackhi_epi8(a, zero) : _mm_unpacklo_epi8(a, zero);
+            __m128i b16 = half ? _mm_unpackhi_epi8(b, zero) : _mm_unpacklo_epi8(b, zero);
+            __m128i c16 = half ? _mm_unpackhi_epi8(c, zero) : _mm_unpacklo_epi8(c, zero);
+            __m128i d16 = half ? _mm_unpackhi_epi8(d, zero) : _mm_unpacklo_epi8(d, zero);
+            // key bits 0-15 and 16-19, interleaved into 32 bit lanes
+            __m128i lo = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(b16, 10), _mm_slli_epi16(c16, 5)), d16);
+            lo = _mm_or_si128(lo, _mm_slli_epi16(_mm_and_si128(a16, one), 15));
+            __m128i hi = _mm_srli_epi16(a16, 1);
+            _mm_storeu_si128((__m128i *)(keys + k + half * 8), _mm_unpacklo_epi16(lo, hi));
+            _mm_storeu_si128((__m128i *)(keys + k + half * 8 + 4), _mm_unpackhi_epi16(lo, hi));
+        }
+    }
+#endif
+    quad_keys_scalar(row0, row1, k, n, mins, keys);
+}
 
-    assert(!((w|h)&1u));
 
-    if (!key_lookup)
+// best of the 32 2x2 patterns (and offset) for the keys abc << 5 | d of the (a, b, c) prefixes
+// [first, end). Each key sees the patterns and offsets in the same order as a pattern by pattern
+// pass over the whole table would, so ties resolve the same way; the 32 values of d are the
+// inner loop, which the compiler vectorizes.
+static void build_key_lookup(uint first, uint end) {
+    for(uint abc = first; abc < end; abc++)
     {
-        key_lookup = (uint8_t *)calloc(1,0x100000);
-        key_dist = (uint16_t *) calloc(2, 0x100000);
-        key_offset = (int8_t *) calloc(1, 0x100000);
-        for(int i = 0; i < 0x100000; i++)
+        int a = abc >> 10u, b = (abc >> 5u) & 0x1f, c = abc & 0x1f;
+        // 16 bit lanes throughout (scores stay below 4 * 34 * 34)
+        int16_t dist[32], lookup[32], offset[32];
+        for(int d = 0; d < 32; d++)
         {
-            key_dist[i] = 0x7fffu;
+            dist[d] = 0x7fff;
+            lookup[d] = 0;
+            offset[d] = 0;
         }
         for(int i = 0; i < 32; i++)
         {
-            uint8_t choice = (i < 4) ? 0x81 + i : 1 + i;
-            key_lookup[sorted_keys[i]] = choice;
-            key_dist[sorted_keys[i]] = 0;
+            int16_t choice = (i < 4) ? 0x81 + i : 1 + i;
+            if ((sorted_keys[i] >> 5u) == abc) {
+                lookup[sorted_keys[i] & 0x1f] = choice;
+                dist[sorted_keys[i] & 0x1f] = 0;
+            }
+            int da = (sorted_keys[i] >> (5u * 3u)) & 0x1f;
+            int db = (sorted_keys[i] >> (5u * 2u)) & 0x1f;
+            int dc = (sorted_keys[i] >> (5u * 1u)) & 0x1f;
+            int dd = (sorted_keys[i] >> (5u * 0u)) & 0x1f;
             for(int o = -3; o < 3; o++) { // todo really?
-//                for(int o=0;o<1;o++) {
-                uint da = (sorted_keys[i] >> (5u * 3u)) & 0x1f;
-                uint db = (sorted_keys[i] >> (5u * 2u)) & 0x1f;
-                uint dc = (sorted_keys[i] >> (5u * 1u)) & 0x1f;
-                uint dd = (sorted_keys[i] >> (5u * 0u)) & 0x1f;
-//                if (da == db && db == dc & dc == dd && (o == da || o == -da)) continue;
-                for(uint a = 0; a < 32; a++)
+                int16_t abc_score = (a + o - da) * (a + o - da) + (b + o - db) * (b + o - db) + (c + o - dc) * (c + o - dc);
+                int16_t tie = o ? 0 : 1; // todo what is this second half
+                for(int d = 0; d < 32; d++)
                 {
-                    for(uint b = 0; b < 32; b++)
-                    {
-                        for(uint c = 0; c < 32; c++)
-                        {
-                            for(uint d = 0; d < 32; d++)
-                            {
-                                uint j = (a << (5u * 3u)) | (b << (5u * 2u)) | (c << (5u * 1u) | (d << (5u * 0u)));
-                                uint score = (a + o - da) * (a + o - da);
-                                score += (b + o - db) * (b + o - db);
-                                score += (c + o - dc) * (c + o - dc);
-                                score += (d + o - dd) * (d + o - dd);
-                                if (score < key_dist[j] || (score == key_dist[j] && !o))
-                                {
-                                    if (score == 0) {
-//                                        printf("pants\n");
-                                    }
-
-                                    key_dist[j] = score;
-                                    key_lookup[j] = choice;
-                                    key_offset[j] = o;
-                                }
-                            }
-                        }
-                    }
+                    int16_t e = d + o - dd;
+                    int16_t score = abc_score + e * e;
+                    int16_t better = (score < dist[d]) | ((score == dist[d]) & tie); // no branches: vectorizes
+                    dist[d] = better ? score : dist[d];
+                    lookup[d] = better ? choice : lookup[d];
+                    offset[d] = better ? o : offset[d];
                 }
             }
         }
-
-        for(int i = 0; i < 32; i++)
+        for(int d = 0; d < 32; d++)
         {
-            assert(key_dist[sorted_keys[i]] == 0);
+            key_dist[(abc << 5u) + d] = dist[d];
+            key_lookup[(abc << 5u) + d] = lookup[d];
+            key_offset[(abc << 5u) + d] = offset[d];
         }
-        uint t = 0;
-        for(int i = 0; i < 0x100000; i++) {
-            if (!key_dist[i]) {
-//                printf("%d %d %d\n", i, key_offset[i], key_dist[i]);
-                t++;
-        }
-            if (key_offset[i]) {
-                //printf("%d %d %d\n", i, key_offset[i], key_dist[i]);
-            }
-        }
-//        assert(t == 32);
-assert(t == 128); // todo why
     }
+}
+
+// 2^20 keys x 32 patterns x 6 offsets: built once, split over the cores
+static void init_key_lookup() {
+    key_lookup = (uint8_t *) calloc(1, 0x100000);
+    key_dist = (uint16_t *) calloc(2, 0x100000);
+    key_offset = (int8_t *) calloc(1, 0x100000);
+    const uint prefixes = 0x100000 >> 5u;
+    uint threads = std::max(1u, std::min(std::thread::hardware_concurrency(), 64u));
+    std::vector<std::thread> workers;
+    for(uint t = 1; t < threads; t++) {
+        workers.emplace_back(build_key_lookup, prefixes * t / threads, prefixes * (t + 1) / threads);
+    }
+    build_key_lookup(0, prefixes / threads);
+    for(std::thread &t : workers) t.join();
+
+    for(int i = 0; i < 32; i++)
+    {
+        assert(key_dist[sorted_keys[i]] == 0);
+    }
+    uint t = 0;
+    for(int i = 0; i < 0x100000; i++) {
+        if (!key_dist[i]) t++;
+    }
+//    assert(t == 32);
+    assert(t == 128); // todo why
+}
+
+#ifndef ENCODE_565
+int compress_image(const char *name, uint w, uint h, std::vector<unsigned char> &source, std::vector<unsigned char> &dest, std::vector<uint32_t> &line_offsets, uint max_rdist, uint max_gdist, uint max_bdist, uint extra_line_words = 0)
+{
+    bool use_56bit_raw = true;
+
+    assert(!((w|h)&1u));
+
+    if (!key_lookup) init_key_lookup();
     uint32_t counts[4] = {0,0,0,0};
     uint8_t *d = &dest[0];
     line_offsets.clear();
@@ -361,111 +476,40 @@ assert(t == 128); // todo why
     while (d < dest.end().base()) *d++ = 0;
     //return counts[0]*8 + counts[3] * 7 + counts[1] *3 + counts[2] * 4;
     int cost = counts[0]*8 + counts[3] * 7 + counts[2] *3 + counts[1] * 4;
-    min_cost = MIN(cost, min_cost);
-    bool rc = cost > max_cost;
-    max_cost = MAX(cost, max_cost);
-    total_cost += cost;
-    total_vals += w*h;
 //    printf("%s %d*8 %d*7 %d*4 %d*3\n", name, counts[0], counts[3], counts[1], counts[2]);
-    return rc;
+    return cost;
 }
 
 #else
-bool compress_image(const char *name, uint w, uint h, std::vector<unsigned char> &source, std::vector<unsigned char> &dest, std::vector<uint32_t> &line_offsets, uint max_rdist, uint max_gdist, uint max_bdist, uint extra_line_words = 0)
+int compress_image(const char *name, uint w, uint h, std::vector<unsigned char> &source, std::vector<unsigned char> &dest, std::vector<uint32_t> &line_offsets, uint max_rdist, uint max_gdist, uint max_bdist, uint extra_line_words = 0)
 {
     bool use_56bit_raw = true;
 
     assert(!((w|h)&1u));
 
-    if (!key_lookup)
-    {
-        key_lookup = (uint8_t *) calloc(1, 0x100000);
-        key_dist = (uint16_t *) calloc(2, 0x100000);
-        key_offset = (int8_t *) calloc(1, 0x100000);
-        for(int i = 0; i < 0x100000; i++)
-        {
-            key_dist[i] = 0x7fffu;
-        }
-        for(int i = 0; i < 32; i++)
-        {
-            uint8_t choice = (i < 4) ? 0x81 + i : 1 + i;
-            key_lookup[sorted_keys[i]] = choice;
-            key_dist[sorted_keys[i]] = 0;
-            for(int o = -3; o < 3; o++) { // todo really?
-//                for(int o=0;o<1;o++) {
-                uint da = (sorted_keys[i] >> (5u * 3u)) & 0x1f;
-                uint db = (sorted_keys[i] >> (5u * 2u)) & 0x1f;
-                uint dc = (sorted_keys[i] >> (5u * 1u)) & 0x1f;
-                uint dd = (sorted_keys[i] >> (5u * 0u)) & 0x1f;
-//                if (da == db && db == dc & dc == dd && (o == da || o == -da)) continue;
-                for(uint a = 0; a < 32; a++)
-                {
-                    for(uint b = 0; b < 32; b++)
-                    {
-                        for(uint c = 0; c < 32; c++)
-                        {
-                            for(uint d = 0; d < 32; d++)
-                            {
-                                uint j = (a << (5u * 3u)) | (b << (5u * 2u)) | (c << (5u * 1u) | (d << (5u * 0u)));
-                                uint score = (a + o - da) * (a + o - da);
-                                score += (b + o - db) * (b + o - db);
-                                score += (c + o - dc) * (c + o - dc);
-                                score += (d + o - dd) * (d + o - dd);
-                                // todo what is this second half
-                                //if (score < key_dist[j]) // || (score == key_dist[j] && !o))
-                                if (score < key_dist[j] || (score == key_dist[j] && !o))
-                                {
-                                    if (score == 0) {
-//                                        printf("pants\n");
-                                    }
-
-                                    key_dist[j] = score;
-                                    key_lookup[j] = choice;
-                                    key_offset[j] = o;
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
-
-        for(int i = 0; i < 32; i++)
-        {
-            assert(key_dist[sorted_keys[i]] == 0);
-        }
-        uint t = 0;
-        for(int i = 0; i < 0x100000; i++) {
-            if (!key_dist[i]) {
-//                printf("%d %d %d\n", i, key_offset[i], key_dist[i]);
-                t++;
-            }
-            if (key_offset[i]) {
-                //printf("%d %d %d\n", i, key_offset[i], key_dist[i]);
-            }
-        }
-//        assert(t == 32);
-        assert(t == 128); // todo why
-    }
+    if (!key_lookup) init_key_lookup();
     uint32_t counts[4] = {0,0,0,0};
     uint8_t *d = &dest[0];
     line_offsets.clear();
+    std::vector<uint8_t> mins(w * 3);
+    std::vector<uint32_t> keys(w * 3);
     for(uint y=0; y < h; y+=2) {
         uint8_t *base = &source[y * w * 3];
         uint8_t *base2 = base + w * 3;
         line_offsets.push_back(d - &dest[0]);
 
+        quad_keys(base, base2, w, &mins[0], &keys[0]);
         for(uint x = 0; x < w; x+= 2) {
-            uint rmin = std::min({base[0], base[3], base2[0], base2[3]});
-            uint gmin = std::min({base[1], base[4], base2[1], base2[4]});
-            uint bmin = std::min({base[2], base[5], base2[2], base2[5]});
-            uint rkey = get_key(rmin, base[0], base[3], base2[0], base2[3]);
+            uint rmin = mins[x * 3];
+            uint gmin = mins[x * 3 + 1];
+            uint bmin = mins[x * 3 + 2];
+            uint rkey = keys[x * 3];
             uint16_t rdist = key_dist[rkey];
             uint8_t rval = key_lookup[rkey];
-            uint gkey =  get_key(gmin, base[1], base[4], base2[1], base2[4]);
+            uint gkey = keys[x * 3 + 1];
             uint16_t gdist = key_dist[gkey];
             uint8_t gval = key_lookup[gkey];
-            uint bkey =  get_key(bmin, base[2], base[5], base2[2], base2[5]);
+            uint bkey = keys[x * 3 + 2];
             uint16_t bdist = key_dist[bkey];
             uint8_t bval = key_lookup[bkey];
             uint16_t dist = std::max({rdist, gdist, bdist});
@@ -560,17 +604,22 @@ bool compress_image(const char *name, uint w, uint h, std::vector<unsigned char>
     while (d < dest.end().base()) *d++ = 0;
     //return counts[0]*8 + counts[3] * 7 + counts[1] *3 + counts[2] * 4;
     int cost = counts[0]*8 + counts[3] * 7 + counts[2] *3 + counts[1] * 4;
+//    printf("%s %d*8 %d*7 %d*4 %d*3\n", name, counts[0], counts[3], counts[1], counts[2]);
+    return cost;
+}
+
+#endif
+
+// frames are recorded in order; true for a new worst frame
+static bool record_cost(int cost, uint w, uint h) {
     min_cost = std::min(cost, min_cost);
     bool rc = cost > max_cost;
     max_cost = std::max(cost, max_cost);
     total_cost += cost;
     total_vals += w*h;
-//    printf("%s %d*8 %d*7 %d*4 %d*3\n", name, counts[0], counts[3], counts[1], counts[2]);
     return rc;
 }
 
-#endif
-
 void write_hword(uint word, FILE *out) {
     assert(word < 0x10000);
     fputc(word & 0xff, out);
@@ -589,7 +638,7 @@ uint8_t to_bcd(uint x) {
 }
 
 #define PLAT_MAJOR 0
-#define PLAT_MINOR 60
+#define PLAT_MINOR 61
 
 struct frame_header {
     uint32_t mark0;
@@ -607,7 +656,9 @@ struct frame_header {
     uint32_t audio_freq;
     uint8_t audio_channels; // always assume 16 bit
     uint8_t pad[3];
-    uint32_t unused[4]; // little space for expansion
+    // bit n set: row n is the same as in the previous frame (0.61). Its data is still present, but each
+    // run of such rows starts and ends on a sector boundary so the player can skip it
+    uint32_t reused_rows[4];
     uint32_t total_sectors;
     uint32_t last_sector;
     // 1, 2, 4, 8 frame increments
@@ -617,7 +668,159 @@ struct frame_header {
     uint16_t row_offsets[];
 } __attribute__((packed));
 
-int encode_movie(const char *filename, const char *audio_filename, const char *filename_out, int start_frame) {
+// a frame in flight between the encode workers and the in-order writer
+struct encoded_frame {
+    std::vector<unsigned char> source;
+    std::vector<unsigned char> dest;
+    std::vector<uint32_t> line_offsets;
+    std::vector<uint8_t> audio;
+    int frame = -1; // frame held, -1 = free
+    bool done = false;
+    bool read_ok = false;
+    bool eof = false; // no more frames
+    int cost = 0;
+};
+
+struct encode_queue {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<encoded_frame> slots; // frame i uses slot i % slots.size()
+    int next_frame = 0;
+    int frames = 0; // INT_MAX until the end of a streamed input is seen
+    bool stop = false;
+
+    // the inputs are read strictly in order (so they may be pipes), video and audio in lockstep
+    std::mutex read_mutex;
+    std::condition_variable read_cv;
+    int next_read = 0;
+    FILE *file;
+    FILE *audio_file;
+    bool streaming; // the video ends wherever the stream does
+    bool audio_ended;
+    uint w, h;
+    uint max_rdist, max_gdist, max_bdist;
+    uint extra_line_words;
+};
+
+// dither and compress frames into free slots; frames are independent, only the writer is ordered
+static void encode_worker(encode_queue *q) {
+    size_t size3 = q->w * q->h * 3;
+    std::unique_lock<std::mutex> lock(q->mutex);
+    for(;;) {
+        q->cv.wait(lock, [q] {
+            return q->stop || q->next_frame >= q->frames || q->slots[q->next_frame % q->slots.size()].frame < 0;
+        });
+        if (q->stop || q->next_frame >= q->frames) return;
+        int i = q->next_frame++;
+        encoded_frame &f = q->slots[i % q->slots.size()];
+        f.frame = i;
+        f.done = false;
+        lock.unlock();
+
+        {
+            std::unique_lock<std::mutex> read_lock(q->read_mutex);
+            q->read_cv.wait(read_lock, [q, i] { return q->next_read == i; });
+            size_t got = fread(&f.source[0], 1, size3, q->file);
+            // a streamed video stops at its last complete frame
+            f.eof = got < size3 && !ferror(q->file) && (!got || q->streaming);
+            if (f.eof && got) {
+                fprintf(stderr, "Dropping partial frame %d (%ld of %ld bytes)\n", i, (long)got, (long)size3);
+            }
+            f.read_ok = got == size3;
+            if (f.read_ok && q->audio_file) {
+                size_t got_audio = q->audio_ended ? 0 : fread(&f.audio[0], 1, f.audio.size(), q->audio_file);
+                if (got_audio < f.audio.size()) {
+                    if (ferror(q->audio_file)) {
+                        f.read_ok = false;
+                    } else {
+                        // audio shorter than the video is padded out with silence
+                        if (!q->audio_ended) {
+                            fprintf(stderr, "Audio ends at frame %d, padding with silence\n", i);
+                            q->audio_ended = true;
+                        }
+                        memset(&f.audio[got_audio], 0, f.audio.size() - got_audio);
+                    }
+                }
+            }
+            q->next_read++;
+        }
+        q->read_cv.notify_all();
+        if (f.read_ok) {
+            dither_image(q->w, q->h, f.source);
+            f.cost = compress_image(NULL, q->w, q->h, f.source, f.dest, f.line_offsets, q->max_rdist, q->max_gdist, q->max_bdist, q->extra_line_words);
+#ifdef ADD_EOR_DEBUGGING
+            for(int r = 0; r < q->h/2; r++) {
+                int32_t o = f.line_offsets[r+1] - 4;
+                assert(o > 0);
+                assert(o < f.dest.size() - 4);
+                assert(!(o&3u));
+                // we cost 4 bytes per row, but we can use this instead of CRC to detect bad data (and also
+                // help with debugging, since we get a good idea what row the data belongs to)
+                f.dest[o + 0] = 0xaa;
+                f.dest[o + 1] = o + 1;
+                f.dest[o + 2] = i;
+                f.dest[o + 3] = r;
+            }
+#endif
+        }
+
+        lock.lock();
+        if (f.eof) q->frames = std::min(q->frames, i);
+        f.done = true;
+        q->cv.notify_all();
+    }
+}
+
+static inline bool row_reused(const uint32_t *reused_rows, uint row) {
+    return reused_rows[row >> 5u] & (1u << (row & 31u));
+}
+
+// flag the row pairs whose dithered pixels are all within row_threshold of the reference, i.e. of what the
+// player shows for the row if it has been copying it forward. the reference follows the other rows
+static uint find_reused_rows(uint w, uint h, const std::vector<unsigned char> &source, std::vector<unsigned char> &reference, int row_threshold, uint32_t *reused_rows) {
+    if (reference.empty()) {
+        reference = source;
+        return 0;
+    }
+    uint count = 0;
+    size_t row_bytes = w * 3 * 2;
+    for(uint y = 0; y < h / 2; y++) {
+        const uint8_t *s = &source[y * row_bytes];
+        uint8_t *r = &reference[y * row_bytes];
+        size_t i = 0;
+        while (i < row_bytes && abs(s[i] - r[i]) <= row_threshold) i++;
+        if (i == row_bytes) {
+            reused_rows[y >> 5u] |= 1u << (y & 31u);
+            count++;
+        } else {
+            memcpy(r, s, row_bytes);
+        }
+    }
+    return count;
+}
+
+// copy the rows of dest to image, padding so that every run of reused rows starts and ends on a sector
+// boundary; line_offsets are updated to match. returns the sectors the runs take
+static uint pad_reused_rows(uint h, const uint32_t *reused_rows, const std::vector<unsigned char> &dest, std::vector<uint32_t> &line_offsets, std::vector<unsigned char> &image) {
+    uint sectors = 0;
+    uint32_t run_start = 0;
+    image.clear();
+    for(uint y = 0; y < h / 2; y++) {
+        uint32_t from = line_offsets[y];
+        line_offsets[y] = image.size();
+        image.insert(image.end(), dest.begin() + from, dest.begin() + line_offsets[y + 1]);
+        bool reused = row_reused(reused_rows, y);
+        if (reused && (!y || !row_reused(reused_rows, y - 1))) run_start = line_offsets[y];
+        if (reused != (y + 1 < h / 2 && row_reused(reused_rows, y + 1))) {
+            image.resize((image.size() + 511u) & ~511u, 0);
+            if (reused) sectors += (image.size() - run_start) / 512;
+        }
+    }
+    line_offsets[h / 2] = image.size();
+    return sectors;
+}
+
+int encode_movie(const char *filename, const char *audio_filename, const char *filename_out, int start_frame, unsigned threads, int row_threshold) {
     worst_frame = 0;
     total_cost = 0;
     max_cost = 0;
@@ -636,13 +839,7 @@ int encode_movie(const char *filename, const char *audio_filename, const char *f
     size_t size3 = w * h * 3;
     size_t size2 = w * h * 2;
     std::vector<uint32_t> frame_sectors;
-    std::vector<unsigned char> source;
-    std::vector<unsigned char> dest;
-    std::vector<uint32_t> line_offsets;
-    line_offsets.resize(120);
-    source.resize(size3);
-    dest.resize(size2);
-    FILE *file = fopen(filename, "rb");
+    FILE *file = strcmp(filename, "-") ? fopen(filename, "rb") : stdin;
     FILE *audio_file = audio_filename ? fopen(audio_filename, "rb") : nullptr;
     FILE *file_out = filename_out ? fopen(filename_out, "wb") : nullptr;
     if (!file) {
@@ -657,12 +854,31 @@ int encode_movie(const char *filename, const char *audio_filename, const char *f
         fprintf(stderr, "Couldn't open output pl2 file %s\n", filename_out);
         return -1;
     }
-    fseek(file, 0, SEEK_END);
-    size_t frames = ftell(file) / size3;
-    printf("Frame count %ld = %02ld:%02ld:%02ld\n", frames, (frames / (3600 * 30)) % 60, (frames / (60 * 30)) % 60, (frames / 30) % 60);
-    fseek(file, start_frame * size3, SEEK_SET);
+    // the frame links and sizes in the headers are patched in at the end, which needs a real file
+    if (!file_out || fseek(file_out, 0, SEEK_SET)) {
+        fprintf(stderr, "Output pl2 file must be seekable\n");
+        return -1;
+    }
+    // a regular file is counted up front, anything else (a pipe from ffmpeg) is read until it ends
+    struct stat st;
+    bool streaming = fstat(fileno(file), &st) || !S_ISREG(st.st_mode);
+    size_t frames = INT_MAX;
+    if (!streaming) {
+        frames = st.st_size / size3 - std::min((size_t)start_frame, st.st_size / size3);
+        printf("Frame count %ld = %02ld:%02ld:%02ld\n", frames, (frames / (3600 * 30)) % 60, (frames / (60 * 30)) % 60, (frames / 30) % 60);
+    } else {
+        printf("Streaming frames from %s\n", filename);
+    }
+    if (start_frame && fseek(file, start_frame * size3, SEEK_SET)) {
+        fprintf(stderr, "Can't skip to frame %d of %s\n", start_frame, filename);
+        return -1;
+    }
 //    frames = 10000; // movie
     uint32_t worst_length = 0;
+    uint reused_row_count = 0;
+    uint skipped_sectors = 0;
+    std::vector<unsigned char> reference;
+    std::vector<unsigned char> padded;
     int lcount=0;
     int blcount=0;
     int fbmax=0;
@@ -678,14 +894,62 @@ int encode_movie(const char *filename, const char *audio_filename, const char *f
     const int max_gdist = 4;
     const int max_bdist = 4;
 
-    for (int i = 0; i<frames;i++)
+    const uint audio_freq = 44100;
+    const uint audio_channels = 2;
+    const uint audio_words = (audio_freq * 2 * audio_channels / 30) / 4;
+    assert(audio_words * 30 * 4 == 2 * audio_channels * audio_freq); // make sure we divide correctly
+
+    init_key_lookup();
+    if (!threads) threads = 1;
+    encode_queue q;
+    q.frames = frames;
+    q.file = file;
+    q.audio_file = audio_file;
+    q.streaming = streaming;
+    q.audio_ended = false;
+    q.w = w;
+    q.h = h;
+    q.max_rdist = max_rdist;
+    q.max_gdist = max_gdist;
+    q.max_bdist = max_bdist;
+    q.extra_line_words = extra_line_words;
+    q.slots.resize(threads * 2);
+    for(encoded_frame &f : q.slots) {
+        f.source.resize(size3);
+        f.dest.resize(size2);
+        f.line_offsets.resize(120);
+        f.audio.resize(audio_words * 4);
+    }
+    std::vector<std::thread> workers;
+    for(unsigned t = 0; t < threads; t++) {
+        workers.emplace_back(encode_worker, &q);
+    }
+    auto stop_workers = [&] {
+        {
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.stop = true;
+        }
+        q.cv.notify_all();
+        for(std::thread &t : workers) t.join();
+    };
+
+    // frames are written in order: sector numbers and the stats depend on everything before
+    for (int i = 0; ;i++)
     {
-        if (1 != fread(&source[0], size3, 1, file)) {
+        encoded_frame *slot = &q.slots[i % q.slots.size()];
+        {
+            std::unique_lock<std::mutex> lock(q.mutex);
+            q.cv.wait(lock, [&] { return i >= q.frames || (slot->frame == i && slot->done); });
+            if (i >= q.frames) break;
+        }
+        if (!slot->read_ok) {
             fprintf(stderr, "Error reading frame %d\n", i);
+            stop_workers();
             return -1;
         }
-        dither_image(w, h, source);
-        if (compress_image(NULL, w, h, source, dest, line_offsets, max_rdist, max_gdist, max_bdist, extra_line_words))
+        const std::vector<unsigned char> *dest = &slot->dest;
+        std::vector<uint32_t> &line_offsets = slot->line_offsets;
+        if (record_cost(slot->cost, w, h))
         {
             worst_frame = i;
         }
@@ -707,22 +971,17 @@ int encode_movie(const char *filename, const char *audio_filename, const char *f
 
             l = o;
         }
-#ifdef ADD_EOR_DEBUGGING
-        for(int r = 0; r < h/2; r++) {
-            int32_t o = line_offsets[r+1] - 4;
-            assert(o > 0);
-            assert(o < dest.size() - 4);
-            assert(!(o&3u));
-            // we cost 4 bytes per row, but we can use this instead of CRC to detect bad data (and also
-            // help with debugging, since we get a good idea what row the data belongs to)
-            dest[o + 0] = 0xaa;
-            dest[o + 1] = o + 1;
-            dest[o + 2] = i;
-            dest[o + 3] = r;
-        }
-#endif
         fbmax = std::max(fb, fbmax);
         if (fb) bfcount++;
+        uint32_t reused_rows[4] = {0, 0, 0, 0};
+        if (row_threshold >= 0) {
+            uint reused = find_reused_rows(w, h, slot->source, reference, row_threshold, reused_rows);
+            if (reused) {
+                reused_row_count += reused;
+                skipped_sectors += pad_reused_rows(h, reused_rows, slot->dest, line_offsets, padded);
+                dest = &padded;
+            }
+        }
         if (file_out)
         {
             size_t secoff = ftell(file_out);
@@ -753,10 +1012,11 @@ int encode_movie(const char *filename, const char *audio_filename, const char *f
             header.width = w;
             header.height = h;
             header.image_words = line_offsets[h / 2] >> 2;
+            memcpy(header.reused_rows, reused_rows, sizeof(reused_rows));
             if (audio_file) {
-                header.audio_freq = 44100;
-                header.audio_channels = 2;
-                header.audio_words = (header.audio_freq * 2 * header.audio_channels / 30) / 4;
+                header.audio_freq = audio_freq;
+                header.audio_channels = audio_channels;
+                header.audio_words = audio_words;
             } else {
                 header.audio_freq = header.audio_channels = header.audio_words = 0;
             }
@@ -775,30 +1035,36 @@ int encode_movie(const char *filename, const char *audio_filename, const char *f
             sector_offset = pad_sector(sector_offset, file_out);
             if (audio_file)
             {
-                assert(header.audio_words * 30 * 4 ==
-                       2 * header.audio_channels * header.audio_freq); // make sure we divide correctly
-                uint32_t buf[header.audio_words];
-                uint audio_size_bytes = header.audio_words * 4;
-                fseek(audio_file, audio_size_bytes * (size_t) i, SEEK_SET);
-                if (1 != fread(buf, audio_size_bytes, 1, audio_file)) {
-                    fprintf(stderr, "Error reading audio for frame %d\n", i);
-                    return -1;
-                }
-                fwrite(buf, audio_size_bytes, 1, file_out);
+                uint audio_size_bytes = slot->audio.size();
+                fwrite(&slot->audio[0], audio_size_bytes, 1, file_out);
                 sector_offset = pad_sector(audio_size_bytes & 0x1ff, file_out);
             }
             uint32_t actual_size = line_offsets[h / 2];
-            fwrite(&dest[0], 1, actual_size, file_out);
+            fwrite(&(*dest)[0], 1, actual_size, file_out);
             sector_offset = pad_sector(actual_size & 0x1ff, file_out);
         }
         if (!(i%60))
         {
             printf("%02d:%02d:%02d\n", (i / (3600 * 30)) % 60, (i / (60 * 30)) % 60, (i / 30) % 60);
         }
+        {
+            std::lock_guard<std::mutex> lock(q.mutex);
+            slot->frame = -1;
+        }
+        q.cv.notify_all();
+    }
+    stop_workers();
+    frames = q.frames;
+    if (!frames) {
+        fprintf(stderr, "No frames in %s\n", filename);
+        return -1;
+    }
+    if (streaming) {
+        printf("Frame count %ld = %02ld:%02ld:%02ld\n", frames, (frames / (3600 * 30)) % 60, (frames / (60 * 30)) % 60, (frames / 30) % 60);
     }
     uint32_t total_sectors = ftell(file_out) / 512;
 
-    fclose(file);
+    if (file != stdin) fclose(file);
     assert(frames == frame_sectors.size());
     for(int i=0; i<frames; i++) {
         fseek(file_out, 512 * ((uint64_t)frame_sectors[i]) + offsetof(frame_header, total_sectors), SEEK_SET);
@@ -819,13 +1085,98 @@ int encode_movie(const char *filename, const char *audio_filename, const char *f
     printf("last frame at %d\n", frame_sectors[frames-1]);
     printf("Worst frame %d mic %d mac %d avg %d maxl %d\n", worst_frame, min_cost, max_cost, (int)((total_cost * w * (long)h) / total_vals), worst_length);
     printf("%d %d %d, fbmax %d bfc %d/%ld\n", blcount, lcount, (int)(100l * blcount / lcount), fbmax, bfcount, frames);
+    printf("Reused rows %d/%ld, %d sectors skippable\n", reused_row_count, frames * (h / 2), skipped_sectors);
     return 0;
 }
 
+// fill a row of n bytes with one of the test patterns: random, random near the top (for the
+// saturating add), all 255, all 0, or a ramp
+static void selftest_fill(uint8_t *row, uint n, uint pattern, uint32_t &seed) {
+    for(uint i = 0; i < n; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        switch (pattern) {
+            case 0: row[i] = (uint8_t)seed; break;
+            case 1: row[i] = (uint8_t)(240 + seed % 16); break;
+            case 2: row[i] = 255; break;
+            case 3: row[i] = 0; break;
+            default: row[i] = (uint8_t)(i * 7); break;
+        }
+    }
+}
+
+// run the vector kernels and the scalar reference on the same rows, for widths that are and are not
+// multiples of the vector sizes; returns the number of mismatches
+static int selftest() {
+    const uint guard = 64;
+    uint32_t seed = 0x1234567u;
+    int failures = 0;
+    long rows = 0;
+    for(uint w = 1; w <= 330; w++) {
+        for(uint pattern = 0; pattern < 5; pattern++) {
+            uint n = w * 3;
+            const uint h = 4; // every row of the dither pattern
+            std::vector<unsigned char> image(n * h + guard);
+            selftest_fill(&image[0], n * h + guard, pattern, seed);
+            std::vector<unsigned char> reference(image);
+            dither_image(w, h, image);
+            dither_image_scalar(w, h, &reference[0]);
+            if (image != reference) {
+                fprintf(stderr, "selftest: dither_image differs for width %d pattern %d\n", w, pattern);
+                failures++;
+            }
+            rows += h;
+            if (w & 1u) continue;
+            // the quad keys are taken from dithered rows, and read only the pair of rows given
+            std::vector<uint8_t> mins(n), ref_mins(n);
+            std::vector<uint32_t> keys(n), ref_keys(n);
+            for(uint y = 0; y < h; y += 2) {
+                const uint8_t *row0 = &reference[y * n];
+                quad_keys(row0, row0 + n, w, &mins[0], &keys[0]);
+                quad_keys_scalar(row0, row0 + n, 0, n, &ref_mins[0], &ref_keys[0]);
+                for(uint k = 0; k < n; k++) {
+                    if (k % 6u < 3 && (mins[k] != ref_mins[k] || keys[k] != ref_keys[k])) {
+                        fprintf(stderr, "selftest: quad_keys differs for width %d pattern %d at %d\n", w, pattern, k);
+                        failures++;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+#if CONVERT_AVX2
+    const char *kernels = "AVX2/SSE2";
+#elif CONVERT_SSE2
+    const char *kernels = "SSE2";
+#else
+    const char *kernels = "scalar";
+#endif
+    printf("selftest (%s): %ld rows, %d failures\n", kernels, rows, failures);
+    return failures;
+}
+
 int main(int argc, char **argv) {
+    if (argc == 2 && !strcmp(argv[1], "--selftest")) {
+        return selftest() ? 1 : 0;
+    }
+    unsigned threads = std::thread::hardware_concurrency();
+    int row_threshold = 0;
+    while (argc > 4 && argv[1][0] == '-' && argv[1][1] && !argv[1][2]) {
+        if (argv[1][1] == 'j') {
+            threads = atoi(argv[2]);
+        } else if (argv[1][1] == 't') {
+            row_threshold = atoi(argv[2]);
+        } else {
+            break;
+        }
+        argc -= 2;
+        argv += 2;
+    }
     if (argc != 4) {
-        fprintf(stderr, "usage: convert <rgb_file> <pcm_file> <output_file.pl2>\n");
+        fprintf(stderr, "usage: convert [-j threads] [-t row_threshold] <rgb_file|-> <pcm_file> <output_file.pl2>\n"
+                        "       convert --selftest\n");
         return -1;
     }
-    return encode_movie(argv[1], argv[2], argv[3], 0);
+    return encode_movie(argv[1], argv[2], argv[3], 0, threads, row_threshold);
 }
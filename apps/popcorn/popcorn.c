@@ -279,6 +279,7 @@ struct audio_buffer_pool *audio_buffer_pool;
 // +1 so we can tell full from empty
 #define ROW_OFFSET_CIRCLE_SIZE (MOVIE_ROWS * 2 + 1 + 10)
 static uint16_t row_buffer_offsets[ROW_OFFSET_CIRCLE_SIZE];
+static uint16_t row_buffer_words[ROW_OFFSET_CIRCLE_SIZE];
 
 static uint row_wrap_add(uint a, uint b) {
     assert(a < ROW_OFFSET_CIRCLE_SIZE && b <= MOVIE_ROWS);
@@ -337,7 +338,9 @@ struct frame_header {
     uint32_t audio_freq;
     uint8_t audio_channels; // always assume 16 bit
     uint8_t pad[3];
-    uint32_t unused[4]; // little space for expansion
+    // bit n set: row n is the same as in the previous frame (format 0.61, zero before). Its data is still
+    // present, but each run of such rows starts and ends on a sector boundary so it can be skipped
+    uint32_t reused_rows[4];
     uint32_t total_sectors;
     uint32_t last_sector;
     // 1, 2, 4, 8 frame increments
@@ -356,6 +359,7 @@ static struct decoder_state_state {
         NEED_VIDEO_SECTORS,
         PREPPING_VIDEO_SECTORS,
         READING_VIDEO_SECTORS,
+        COPYING_VIDEO_ROWS,
         AWAIT_AUDIO_BUFFER,
         NEED_AUDIO_SECTORS,
         READING_AUDIO_SECTORS,
@@ -373,6 +377,7 @@ static struct decoder_state_state {
         // todo we should combine these
         uint16_t frame_row_count;
         uint16_t row_index;
+        uint16_t copy_sectors; // sectors of the reused rows being copied
     } video_read, video_read_rollback;
     struct {
         uint32_t sector_base;
@@ -385,6 +390,8 @@ static struct decoder_state_state {
         // remaining data from previous frame in a pinch)...
         // todo right now we always try and keep MOVIE_ROWS valid lines ending at valid_to_row
         uint16_t display_start_row;
+        // absolute sector of the frame whose rows end at valid_to_row (if it was read completely), or -1
+        uint32_t complete_frame_sector;
     } rows;
     struct {
         volatile enum {
@@ -448,6 +455,10 @@ static uint peek_upcoming_row(struct frame_header *head, int ahead) {
            head->row_offsets[ds.video_read.frame_row_count + ahead];
 }
 
+static inline bool row_reused(const struct frame_header *head, uint row) {
+    return head->reused_rows[row >> 5u] & (1u << (row & 31u));
+}
+
 struct gpt_entry {
     uint64_t ptype1, ptype2;
     uint64_t guid1, guid2;
@@ -469,6 +480,47 @@ static void __attribute__((noinline)) update_audio_sector_volume(uint32_t *_samp
 
 #pragma GCC pop_options
 
+// where a copied row of words goes: at offset, or wrapped to the start of image_data, without passing limit
+// (the offset of the oldest row still needed). -1 if there is no room
+static int copied_row_offset(uint offset, uint words, uint limit) {
+    if (offset + words > IMAGE_DATA_WORDS) {
+        if (limit >= offset) return -1;
+        offset = 0;
+    }
+    if (limit >= offset && offset + words > limit) return -1;
+    return (int) offset;
+}
+
+// a run of reused rows starts at the next row: if the frame before it in the ring is the previous frame
+// of the movie (i.e. we are playing forwards at 1x) and still has the run's rows, copy those instead of
+// reading the run's sectors. The display may free each of them only once it is copied, so check that
+// the copies fit with nothing else freed
+static bool __time_critical_func(start_copying_reused_rows)(const struct frame_header *head) {
+    if (head->backward_frame_sectors[0] == 0xffffffff ||
+        ds.rows.complete_frame_sector != movies[registered_current_movie].current_sector - head->sector_number +
+                                         head->backward_frame_sectors[0]) {
+        return false;
+    }
+    uint first = ds.video_read.frame_row_count;
+    uint end = first;
+    while (end < MOVIE_ROWS && row_reused(head, end)) end++;
+    uint run_words = head->row_offsets[end] - head->row_offsets[first];
+    uint from = row_wrap_sub(row_wrap_add(ds.video_read.frame_base_row, first), MOVIE_ROWS);
+    if ((run_words & 127u) || !row_index_in_range(from, ds.rows.valid_from_row, ds.rows.valid_to_row)) {
+        return false;
+    }
+    int offset = ds.video_read.write_buffer_offset;
+    for (uint r = first; r < end; r++, from = row_wrap_add(from, 1)) {
+        offset = copied_row_offset(offset, row_buffer_words[from], row_buffer_offsets[from]);
+        if (offset < 0) return false;
+        offset += row_buffer_words[from];
+    }
+    popcorn_debug("    copy reused rows %d->%d, skip %d sectors\n", first, end, run_words / 128);
+    ds.video_read.copy_sectors = run_words / 128;
+    ds.state = COPYING_VIDEO_ROWS;
+    return true;
+}
+
 static void __time_critical_func(handle_prep_video_sectors)(struct frame_header *head) {
     bool done = false;
     // we are making a decision about how many sectors we can read (we read up to MAX_BLOCK_COUNT - 1) in case one is split
@@ -505,6 +557,13 @@ static void __time_critical_func(handle_prep_video_sectors)(struct frame_header
             break;
         }
         uint row_index = ds.video_read.row_index;
+        if (!ds.video_read.remaining_row_words && ds.video_read.frame_row_count < MOVIE_ROWS &&
+            row_reused(head, ds.video_read.frame_row_count) &&
+            (!ds.video_read.frame_row_count || !row_reused(head, ds.video_read.frame_row_count - 1u))) {
+            // the run is on a sector boundary; read up to it first, since skipping it starts a new read
+            if (sector_count) break;
+            if (start_copying_reused_rows(head)) return;
+        }
         if (!ds.video_read.remaining_row_words) {
             // we need a new row
             uint remaining_row_words = peek_upcoming_row(head, 0);
@@ -531,6 +590,7 @@ static void __time_critical_func(handle_prep_video_sectors)(struct frame_header
                 may_wrap = false;
             }
             row_buffer_offsets[row_index] = ds.video_read.write_buffer_offset;
+            row_buffer_words[row_index] = remaining_row_words;
             ds.video_read.frame_row_count++;
             ds.video_read.row_index = row_index;
         }
@@ -616,6 +676,7 @@ static void __time_critical_func(handle_prep_video_sectors)(struct frame_header
                         popcorn_debug("%d from new row ri = %d(of %d)", to_consume, row_index,
                                       (uint) ds.video_read.remaining_row_words);
                         row_buffer_offsets[row_index] = ds.video_read.write_buffer_offset;
+                        row_buffer_words[row_index] = ds.video_read.remaining_row_words;
                         ds.video_read.remaining_row_words -= to_consume;
                         ds.video_read.write_buffer_offset += to_consume;
                         consumed += to_consume;
@@ -665,6 +726,7 @@ static void __time_critical_func(handle_prep_video_sectors)(struct frame_header
         sd_readblocks_scatter_async(scatter, ds.video_read.sector_base, sector_count);
         ds.state = READING_VIDEO_SECTORS;
     } else if (done) {
+        ds.rows.complete_frame_sector = movies[registered_current_movie].current_sector;
         if (!ds.loaded_audio_this_frame) {
             ds.state = AWAIT_AUDIO_BUFFER;
         } else {
@@ -822,6 +884,7 @@ static void handle_init(const struct frame_header *head) {
     ds.audio.load_thread_buffer_index = 0;
     ds.rows.valid_from_row = ds.rows.valid_to_row = 0;
     ds.rows.display_start_row = 0;
+    ds.rows.complete_frame_sector = 0xffffffff;
     ds.awaiting_first_frame = 1;
     ds.hold_frame = true;
     registered_current_movie = current_movie;
@@ -856,6 +919,32 @@ static void __time_critical_func(handle_reading_video_sectors)() {
     }
 }
 
+// one row per call (like the audio post processing) so we don't hold up scanline generation
+static void __time_critical_func(handle_copying_video_rows)(const struct frame_header *head) {
+    uint row_index = row_wrap_add(ds.video_read.frame_base_row, ds.video_read.frame_row_count);
+    uint from = row_wrap_sub(row_index, MOVIE_ROWS);
+    uint words = row_buffer_words[from];
+    int offset = copied_row_offset(ds.video_read.write_buffer_offset, words,
+                                   row_buffer_offsets[ds.rows.valid_from_row]);
+    if (offset < 0) {
+        return; // wait for the display to free some
+    }
+    ds.video_read.write_buffer_offset = offset;
+    set_owning_row(ds.video_read.write_buffer_offset, words, row_index);
+    __builtin_memcpy(image_data + ds.video_read.write_buffer_offset, image_data + row_buffer_offsets[from], words * 4);
+    row_buffer_offsets[row_index] = ds.video_read.write_buffer_offset;
+    row_buffer_words[row_index] = words;
+    ds.video_read.write_buffer_offset += words;
+    ds.video_read.frame_row_count++;
+    ds.video_read.row_index = row_index;
+    ds.rows.valid_to_row = row_wrap_add(ds.video_read.frame_base_row, ds.video_read.frame_row_count);
+    if (ds.video_read.frame_row_count == MOVIE_ROWS || !row_reused(head, ds.video_read.frame_row_count)) {
+        ds.video_read.sector_base += ds.video_read.copy_sectors;
+        ds.current_sd_read.sector_base = ds.video_read.sector_base;
+        ds.state = NEED_VIDEO_SECTORS;
+    }
+}
+
 static void __time_critical_func(handle_reading_audio_sectors)(const struct frame_header *head) {
     if (sd_scatter_read_complete(NULL)) {
         // todo we have DMA completely capable of reading backwards - seems like a strange thing to expose in any lower level API though
@@ -974,6 +1063,9 @@ static void __attribute__((noinline)) __time_critical_func(sd_state_update)() {
         case READING_VIDEO_SECTORS:
             handle_reading_video_sectors();
             break;
+        case COPYING_VIDEO_ROWS:
+            handle_copying_video_rows(head);
+            break;
         case INIT:
             handle_init(head);
             break;
@@ -1288,6 +1380,14 @@ void __attribute__((noreturn)) __time_critical_func(render_loop)() {
                 }
                 if (first_must_keep_row >= 0) {
                     uint last_displayed_row = row_wrap_add(ds.rows.display_start_row, first_must_keep_row);
+                    if (ds.state == COPYING_VIDEO_ROWS) {
+                        // keep the reused rows until they are copied
+                        uint next_copy_from = row_wrap_sub(row_wrap_add(ds.video_read.frame_base_row,
+                                                                        ds.video_read.frame_row_count), MOVIE_ROWS);
+                        if (row_index_in_range(last_displayed_row, next_copy_from, ds.rows.valid_to_row)) {
+                            last_displayed_row = next_copy_from;
+                        }
+                    }
                     if (row_index_in_range(last_displayed_row, ds.rows.valid_from_row, ds.rows.valid_to_row)) {
                         popcorn_debug("%d zoom %d %d->%d %d %d\n", ds.state, this_hold_frame,
                                       ds.rows.valid_from_row, last_displayed_row, ds.rows.display_start_row,
@@ -0,0 +1,334 @@
+/*
+ * beta99_cutter.c - register writes to beta99 fragments (see
+ * beta99_cutter.h).
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "beta99_cutter.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SID_REGS 0x19
+#define VOICES 3
+
+typedef struct {
+    beta99_ssf_row_t *rows;
+    size_t count;
+    size_t cap;
+    uint64_t start;             /* clock of the note-on */
+    int active;
+    int dirty;                  /* state changed since the last row */
+} fragment_t;
+
+struct beta99_cutter {
+    uint64_t clock;
+    uint8_t regs[SID_REGS];
+    uint32_t written;           /* bit per register */
+
+    beta99_input_t *input;
+    fragment_t frag[VOICES];
+    uint64_t *seen;             /* hashid + 1 per stored fragment, 0 = free slot */
+    int64_t *exact;             /* its hash with exact clocks, per slot */
+    size_t seen_count;
+    size_t seen_cap;            /* power of two */
+    size_t fragments;
+    size_t rows;
+    size_t retimed;
+    unsigned quantum;
+    char *name;
+};
+
+beta99_cutter_t *beta99_cutter_new(const char *name, unsigned clock_quantum) {
+    beta99_cutter_t *c = calloc(1, sizeof *c);
+    if (!c || !(c->name = strdup(name)) || !(c->input = beta99_input_new(name))) {
+        if (c) free(c->name);
+        free(c);
+        perror("beta99_cut: alloc");
+        return NULL;
+    }
+    c->quantum = clock_quantum ? clock_quantum : 1;
+    return c;
+}
+
+void beta99_cutter_free(beta99_cutter_t *c) {
+    if (!c) return;
+    beta99_input_free(c->input);
+    for (int i = 0; i < VOICES; ++i) free(c->frag[i].rows);
+    free(c->seen);
+    free(c->exact);
+    free(c->name);
+    free(c);
+}
+
+const uint8_t *beta99_cutter_regs(const beta99_cutter_t *c) {
+    return c->regs;
+}
+
+static void set_col(beta99_ssf_row_t *row, int col, int64_t value) {
+    row->present |= 1u << col;
+    row->v[col] = value;
+}
+
+static int add_row(beta99_cutter_t *c, int voice) {
+    fragment_t *f = &c->frag[voice];
+    if (f->count == f->cap) {
+        size_t cap = f->cap ? f->cap * 2 : 64;
+        beta99_ssf_row_t *rows = realloc(f->rows, cap * sizeof *rows);
+        if (!rows) {
+            fprintf(stderr, "%s: out of memory\n", c->name);
+            return -1;
+        }
+        f->rows = rows;
+        f->cap = cap;
+    }
+    beta99_ssf_row_t *row = &f->rows[f->count++];
+    memset(row, 0, sizeof *row);
+
+    const uint8_t *r = c->regs;
+    const uint8_t *v = r + voice * 7;
+    set_col(row, BETA99_COL_CLOCK, (int64_t)(c->clock - f->start));
+    for (int b = 0; b < 8; ++b) set_col(row, BETA99_COL_GATE1 + b, (v[4] >> b) & 1);
+    set_col(row, BETA99_COL_FREQ1, v[0] | (v[1] << 8));
+    set_col(row, BETA99_COL_PWDUTY1, v[2] | ((v[3] & 0x0F) << 8));
+    set_col(row, BETA99_COL_ATK1, v[5] >> 4);
+    set_col(row, BETA99_COL_DEC1, v[5] & 0x0F);
+    set_col(row, BETA99_COL_SUS1, v[6] >> 4);
+    set_col(row, BETA99_COL_REL1, v[6] & 0x0F);
+    /* Sync and ring modulation take the modulating voice along, as the
+     * player maps it. */
+    if (v[4] & 0x06) {
+        const uint8_t *m = r + ((voice + 2) % VOICES) * 7;
+        set_col(row, BETA99_COL_FREQ3, m[0] | (m[1] << 8));
+        set_col(row, BETA99_COL_TEST3, (m[4] >> 3) & 1);
+    }
+    int routed = (r[0x17] >> voice) & 1;
+    set_col(row, BETA99_COL_FLT1, routed);
+    /* The shared filter only travels with the voices that go through it. */
+    if (routed) {
+        for (int b = 0; b < 3; ++b) set_col(row, BETA99_COL_FLTLO + b, (r[0x18] >> (4 + b)) & 1);
+        set_col(row, BETA99_COL_FLTEXT, (r[0x17] >> 3) & 1);
+        set_col(row, BETA99_COL_FLTCOFF, (r[0x16] << 3) | (r[0x15] & 0x07));
+        set_col(row, BETA99_COL_FLTRES, r[0x17] >> 4);
+    }
+    set_col(row, BETA99_COL_VOL, r[0x18] & 0x0F);
+    f->dirty = 0;
+    return 0;
+}
+
+/* Hash of the rows (clocks rounded to the quantum), a 64-bit multiply-xor
+ * per column, so equal fragments share a hashid. */
+static int64_t fragment_hash(const fragment_t *f, unsigned quantum) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < f->count; ++i) {
+        const beta99_ssf_row_t *row = &f->rows[i];
+        h = (h ^ row->present) * 0x9e3779b97f4a7c15ull;
+        for (int col = 0; col < BETA99_COL_COUNT; ++col) {
+            uint64_t v = (uint64_t)row->v[col];
+            if (col == BETA99_COL_CLOCK) v = (v + quantum / 2) / quantum;
+            h = (h ^ v) * 0x9e3779b97f4a7c15ull;
+            h ^= h >> 29;
+        }
+    }
+    return (int64_t)(h >> 1);
+}
+
+/* 1 when hashid was stored before, 0 after recording it, -1 when out of
+ * memory. *retimed tells whether the stored fragment's exact hash differs. */
+static int seen_before(beta99_cutter_t *c, int64_t hashid, int64_t exact, int *retimed) {
+    if ((c->seen_count + 1) * 2 > c->seen_cap) {
+        size_t cap = c->seen_cap ? c->seen_cap * 2 : 256;
+        uint64_t *slots = calloc(cap, sizeof *slots);
+        int64_t *exacts = calloc(cap, sizeof *exacts);
+        if (!slots || !exacts) {
+            free(slots);
+            free(exacts);
+            fprintf(stderr, "%s: out of memory\n", c->name);
+            return -1;
+        }
+        for (size_t i = 0; i < c->seen_cap; ++i) {
+            if (!c->seen[i]) continue;
+            size_t j = (size_t)c->seen[i] & (cap - 1);
+            while (slots[j]) j = (j + 1) & (cap - 1);
+            slots[j] = c->seen[i];
+            exacts[j] = c->exact[i];
+        }
+        free(c->seen);
+        free(c->exact);
+        c->seen = slots;
+        c->exact = exacts;
+        c->seen_cap = cap;
+    }
+    uint64_t key = (uint64_t)hashid + 1;
+    size_t j = (size_t)key & (c->seen_cap - 1);
+    while (c->seen[j]) {
+        if (c->seen[j] == key) {
+            *retimed = c->exact[j] != exact;
+            return 1;
+        }
+        j = (j + 1) & (c->seen_cap - 1);
+    }
+    c->seen[j] = key;
+    c->exact[j] = exact;
+    c->seen_count++;
+    *retimed = 0;
+    return 0;
+}
+
+static int close_fragment(beta99_cutter_t *c, int voice) {
+    fragment_t *f = &c->frag[voice];
+    if (!f->active) return 0;
+    f->active = 0;
+    if (f->count == 0) return 0;
+
+    int64_t hashid = fragment_hash(f, c->quantum);
+    int64_t exact = c->quantum > 1 ? fragment_hash(f, 1) : hashid;
+    int retimed = 0;
+    int seen = seen_before(c, hashid, exact, &retimed);
+    if (seen < 0) return -1;
+    c->retimed += (size_t)retimed;
+    if (!seen) {
+        for (size_t i = 0; i < f->count; ++i) {
+            f->rows[i].hashid = hashid;
+            if (beta99_input_add_row(c->input, &f->rows[i]) != 0) return -1;
+        }
+        c->rows += f->count;
+    }
+    if (beta99_input_add_trigger(c->input, (int64_t)f->start, hashid, voice + 1) != 0) {
+        return -1;
+    }
+    c->fragments++;
+    return 0;
+}
+
+int beta99_cutter_write(beta99_cutter_t *c, uint64_t clock, int voice,
+                        uint8_t addr, uint8_t value) {
+    if (addr >= SID_REGS) return 0;
+    if (((c->written >> addr) & 1) && c->regs[addr] == value) return 0;
+    uint8_t old = c->regs[addr];
+    c->clock = clock;
+    c->regs[addr] = value;
+    c->written |= 1u << addr;
+
+    if (addr < 0x15) {
+        voice = addr / 7;
+        int carrier = (voice + 1) % VOICES;
+        if (c->frag[carrier].active && (c->regs[carrier * 7 + 4] & 0x06) &&
+            (addr % 7 < 2 || addr % 7 == 4)) {
+            c->frag[carrier].dirty = 1;
+        }
+        if (!c->frag[voice].active) return 0;
+        if (addr % 7 == 4) return add_row(c, voice);
+        c->frag[voice].dirty = 1;
+        return 0;
+    }
+    if (voice >= 0) {
+        if (voice < VOICES && c->frag[voice].active) c->frag[voice].dirty = 1;
+        return 0;
+    }
+    /* Volume is in every row, the filter only in those of routed voices
+     * (before or after a route change). */
+    unsigned affected = (c->regs[0x17] | (addr == 0x17 ? old : 0)) & 0x07;
+    if (addr == 0x18 && ((old ^ value) & 0x0F)) affected = 0x07;
+    for (int i = 0; i < VOICES; ++i) {
+        if (((affected >> i) & 1) && c->frag[i].active) c->frag[i].dirty = 1;
+    }
+    return 0;
+}
+
+int beta99_cutter_note_on(beta99_cutter_t *c, uint64_t clock, int voice) {
+    if (close_fragment(c, voice) != 0) return -1;
+    c->clock = clock;
+    fragment_t *f = &c->frag[voice];
+    f->active = 1;
+    f->dirty = 1;
+    f->count = 0;
+    f->start = clock;
+    return 0;
+}
+
+int beta99_cutter_flush(beta99_cutter_t *c) {
+    for (int i = 0; i < VOICES; ++i) {
+        if (c->frag[i].active && c->frag[i].dirty && add_row(c, i) != 0) return -1;
+    }
+    return 0;
+}
+
+beta99_bundle_t *beta99_cutter_pack(beta99_cutter_t *c, uint64_t clock, unsigned max_ops,
+                                    beta99_pack_stats_t *stats,
+                                    beta99_cutter_stats_t *cut_stats) {
+    c->clock = clock;
+    if (beta99_cutter_flush(c) != 0) return NULL;
+    for (int i = 0; i < VOICES; ++i) {
+        if (close_fragment(c, i) != 0) return NULL;
+    }
+    if (cut_stats) {
+        cut_stats->fragments = c->fragments;
+        cut_stats->unique = c->seen_count;
+        cut_stats->rows = c->rows;
+        cut_stats->retimed = c->retimed;
+    }
+    return beta99_pack_input(c->input, max_ops, stats);
+}
+
+/* ============ VICE DUMPS ============================== */
+
+static const char *parse_uint(const char *p, uint64_t *out) {
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p < '0' || *p > '9') return NULL;
+    uint64_t v = 0;
+    while (*p >= '0' && *p <= '9') v = v * 10 + (uint64_t)(*p++ - '0');
+    *out = v;
+    return p;
+}
+
+beta99_bundle_t *beta99_cut_dump(const char *path, unsigned clock_quantum, unsigned max_ops,
+                                 beta99_pack_stats_t *stats,
+                                 beta99_cutter_stats_t *cut_stats) {
+    const char *name = path ? path : "<stdin>";
+    FILE *in = path ? fopen(path, "r") : stdin;
+    if (!in) {
+        fprintf(stderr, "beta99_cut: open %s: %s\n", name, strerror(errno));
+        return NULL;
+    }
+    beta99_cutter_t *c = beta99_cutter_new(name, clock_quantum);
+    if (!c) {
+        if (path) fclose(in);
+        return NULL;
+    }
+
+    char *line = NULL;
+    size_t line_cap = 0;
+    uint64_t clock = 0, last = 0;
+    int rc = 0;
+    while (rc == 0 && getline(&line, &line_cap, in) >= 0) {
+        uint64_t delta, addr, value;
+        const char *p = parse_uint(line, &delta);
+        if (!p || !(p = parse_uint(p, &addr)) || !parse_uint(p, &value)) continue;
+        clock += delta;
+        addr &= 0x1F;   /* some dumps carry the full $D400-$D41F */
+        if (addr >= SID_REGS) continue;
+        /* A gap ends the player call: its changes become one row. */
+        if (clock - last > BETA99_DUMP_BURST_CYCLES) rc = beta99_cutter_flush(c);
+        last = clock;
+
+        const uint8_t *regs = beta99_cutter_regs(c);
+        if (addr < 0x15 && addr % 7 == 4 && (value & 1) && !(regs[addr] & 1)) {
+            if (rc == 0) rc = beta99_cutter_note_on(c, clock, (int)addr / 7);
+        }
+        if (rc == 0) rc = beta99_cutter_write(c, clock, -1, (uint8_t)addr, (uint8_t)value);
+    }
+    if (rc == 0 && ferror(in)) {
+        fprintf(stderr, "beta99_cut: read %s: %s\n", name, strerror(errno));
+        rc = -1;
+    }
+    free(line);
+    if (path) fclose(in);
+
+    beta99_bundle_t *b = NULL;
+    if (rc == 0) b = beta99_cutter_pack(c, clock, max_ops, stats, cut_stats);
+    beta99_cutter_free(c);
+    return b;
+}
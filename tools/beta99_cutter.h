@@ -0,0 +1,86 @@
+/*
+ * beta99_cutter.h - cut a stream of SID register writes into beta99 SSFs.
+ *
+ * The writes are applied to a shadow register file. Every note-on starts a
+ * fragment on its voice that lasts until the voice's next note-on. Each
+ * fragment is a list of SSF rows (the full voice state, as desidulate
+ * would log it): one whenever the voice's control register changes, so
+ * the gate off/on of a note-on stays two rows, and one per
+ * beta99_cutter_flush() in which anything else of it changed. The
+ * packer's change detection turns the rows back into the minimal op list.
+ * Identical fragments are stored once and triggered again.
+ *
+ * Used by the tracker export (one flush per engine tick) and by dump2b99,
+ * which reads VICE `-sounddev dump` files directly.
+ */
+#ifndef BETA99_CUTTER_H
+#define BETA99_CUTTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "beta99_packer.h"
+
+typedef struct beta99_cutter beta99_cutter_t;
+
+typedef struct {
+    size_t fragments;       /* note-ons (beta99 triggers) */
+    size_t unique;          /* distinct fragments stored */
+    size_t rows;            /* SSF rows of the stored fragments */
+    size_t retimed;         /* triggers of a stored fragment whose row
+                               clocks differ within the quantum */
+} beta99_cutter_stats_t;
+
+/*
+ * name prefixes error messages. Fragments whose rows agree once their
+ * clocks are rounded to clock_quantum cycles (1 = exact) count as equal,
+ * and the first of them is stored: a player's writes jitter by a few
+ * hundred cycles from call to call. NULL on allocation failure.
+ */
+beta99_cutter_t *beta99_cutter_new(const char *name, unsigned clock_quantum);
+void beta99_cutter_free(beta99_cutter_t *c);
+
+/*
+ * Apply a write at clock (absolute SID cycles, never decreasing). Writes
+ * that leave the register unchanged are ignored. A shared register
+ * (filter, volume: addr >= 0x15) belongs to voice's fragment, or with
+ * voice < 0 to every open fragment it affects. Returns 0, -1 when out of
+ * memory.
+ */
+int beta99_cutter_write(beta99_cutter_t *c, uint64_t clock, int voice,
+                        uint8_t addr, uint8_t value);
+
+/*
+ * Close voice's fragment and open a new one at clock. Writes since the
+ * last row are taken as the new note's setup: the first row of the new
+ * fragment holds them.
+ */
+int beta99_cutter_note_on(beta99_cutter_t *c, uint64_t clock, int voice);
+
+/* Row for every open fragment that changed since its last row. */
+int beta99_cutter_flush(beta99_cutter_t *c);
+
+/* Shadow register file (0x00-0x18). */
+const uint8_t *beta99_cutter_regs(const beta99_cutter_t *c);
+
+/* Close every fragment at clock and pack the bundle (NULL on error). */
+beta99_bundle_t *beta99_cutter_pack(beta99_cutter_t *c, uint64_t clock, unsigned max_ops,
+                                    beta99_pack_stats_t *stats,
+                                    beta99_cutter_stats_t *cut_stats);
+
+/*
+ * Cut a VICE dump (text lines "delta addr value", delta in cycles since
+ * the previous write; NULL = stdin) in one streaming pass: a rising gate
+ * bit is a note-on, and the writes of one player call (no gap over
+ * BETA99_DUMP_BURST_CYCLES) share a row. Fragments are compared with their
+ * clocks rounded to clock_quantum cycles; the default of one PAL frame
+ * matches desidulate's triggers, 1 is exact. NULL after printing the
+ * reason.
+ */
+#define BETA99_DUMP_BURST_CYCLES 1000
+#define BETA99_DUMP_CLOCK_QUANTUM 19656
+beta99_bundle_t *beta99_cut_dump(const char *path, unsigned clock_quantum, unsigned max_ops,
+                                 beta99_pack_stats_t *stats,
+                                 beta99_cutter_stats_t *cut_stats);
+
+#endif /* BETA99_CUTTER_H */
@@ -0,0 +1,284 @@
+/*
+ * beta99_pack - build beta99 (B99F) bundles from desidulate SSF/log CSVs.
+ *
+ * Native replacement for tools/beta99_pack.py (same output, no pandas):
+ *
+ *   beta99_pack --ssf tune.ssf.zst --log tune.log.zst --out tune.b99
+ *
+ * or pack many tunes in parallel. Each TUNE argument names a pair
+ * TUNE.ssf.zst / TUNE.log.zst, or the ssf2col tables TUNE.ssf.ssfc /
+ * TUNE.log.ssfc when they exist (a trailing .ssf.zst, .log.zst, .ssf.ssfc,
+ * .log.ssfc or .b99 on the argument is ignored) and writes TUNE.b99, or
+ * DIR/<name>.b99 with -o:
+ *
+ *   beta99_pack -j 8 -o bundles/ corpus/tune-*.ssf.zst
+ *
+ * With --dict, SSFs go to a shared corpus dictionary (created or extended)
+ * and each tune is written as a B99R bundle of dictionary references.
+ * Tunes are added in argument order, so the indices are reproducible.
+ */
+#define _POSIX_C_SOURCE 200809L
+#define _DARWIN_C_SOURCE 1
+
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "beta99_packer.h"
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+typedef struct {
+    char ssf[PATH_MAX];
+    char log[PATH_MAX];
+    char out[PATH_MAX];
+    beta99_pack_stats_t stats;
+    beta99_bundle_t *bundle;    /* kept for the dictionary pass */
+    int rc;
+} pack_job_t;
+
+typedef struct {
+    pack_job_t *jobs;
+    size_t count;
+    unsigned max_ops;
+    int keep;                   /* hold bundles in memory instead of writing */
+    atomic_size_t next;
+} pack_queue_t;
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s --ssf <tune.ssf.zst|.ssfc> --log <tune.log.zst|.ssfc> --out <tune.b99>\n"
+        "       %s [-j <jobs>] [-o <dir>] <tune>...\n"
+        "Options:\n"
+        "  --max-ops <n>  Split fragments longer than n ops (default %d)\n"
+        "  --dict <file>  Share SSFs through a B99D dictionary; write B99R bundles\n"
+        "  -j <jobs>      Tunes packed in parallel (default: online CPUs)\n"
+        "  -o <dir>       Output directory for <tune>.b99 (created if missing)\n"
+        "  -q             Only report errors\n",
+        prog, prog, BETA99_DEFAULT_MAX_OPS);
+}
+
+static double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void strip_suffix(char *s, const char *suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    if (n > m && strcmp(s + n - m, suffix) == 0) s[n - m] = '\0';
+}
+
+static int job_from_tune(pack_job_t *job, const char *arg, const char *out_dir) {
+    char stem[PATH_MAX];
+    snprintf(stem, sizeof stem, "%s", arg);
+    strip_suffix(stem, ".ssf.zst");
+    strip_suffix(stem, ".log.zst");
+    strip_suffix(stem, ".ssf.ssfc");
+    strip_suffix(stem, ".log.ssfc");
+    strip_suffix(stem, ".b99");
+
+    const char *base = strrchr(stem, '/');
+    base = base ? base + 1 : stem;
+    int n1 = snprintf(job->ssf, sizeof job->ssf, "%s.ssf.ssfc", stem);
+    if (n1 < 0 || (size_t)n1 >= sizeof job->ssf || access(job->ssf, R_OK) != 0) {
+        n1 = snprintf(job->ssf, sizeof job->ssf, "%s.ssf.zst", stem);
+    }
+    int n2 = snprintf(job->log, sizeof job->log, "%s.log.ssfc", stem);
+    if (n2 < 0 || (size_t)n2 >= sizeof job->log || access(job->log, R_OK) != 0) {
+        n2 = snprintf(job->log, sizeof job->log, "%s.log.zst", stem);
+    }
+    int n3 = out_dir ? snprintf(job->out, sizeof job->out, "%s/%s.b99", out_dir, base)
+                     : snprintf(job->out, sizeof job->out, "%s.b99", stem);
+    if (n1 < 0 || n2 < 0 || n3 < 0 || (size_t)n1 >= sizeof job->ssf ||
+        (size_t)n2 >= sizeof job->log || (size_t)n3 >= sizeof job->out) {
+        fprintf(stderr, "beta99_pack: path too long: %s\n", arg);
+        return -1;
+    }
+    return 0;
+}
+
+static void *pack_worker(void *arg) {
+    pack_queue_t *q = arg;
+    for (;;) {
+        size_t i = atomic_fetch_add(&q->next, 1);
+        if (i >= q->count) break;
+        pack_job_t *job = &q->jobs[i];
+        if (q->keep) {
+            job->bundle = beta99_pack(job->ssf, job->log, q->max_ops, &job->stats);
+            job->rc = job->bundle ? 0 : -1;
+        } else {
+            job->rc = beta99_pack_files(job->ssf, job->log, job->out, q->max_ops, &job->stats);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    const char *ssf_path = NULL, *log_path = NULL, *out_path = NULL, *out_dir = NULL;
+    const char *dict_path = NULL;
+    long max_ops = BETA99_DEFAULT_MAX_OPS;
+    long jobs = 0;
+    int quiet = 0;
+
+    static const struct option long_opts[] = {
+        { "ssf", required_argument, NULL, 's' },
+        { "log", required_argument, NULL, 'l' },
+        { "out", required_argument, NULL, 'O' },
+        { "max-ops", required_argument, NULL, 'm' },
+        { "dict", required_argument, NULL, 'd' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "j:o:qh", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 's': ssf_path = optarg; break;
+        case 'l': log_path = optarg; break;
+        case 'O': out_path = optarg; break;
+        case 'd': dict_path = optarg; break;
+        case 'm':
+            max_ops = strtol(optarg, NULL, 10);
+            if (max_ops < 1) max_ops = 1;
+            break;
+        case 'j':
+            jobs = strtol(optarg, NULL, 10);
+            if (jobs < 1) {
+                fprintf(stderr, "beta99_pack: invalid job count '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'o': out_dir = optarg; break;
+        case 'q': quiet = 1; break;
+        case 'h': usage(argv[0]); return 0;
+        default: usage(argv[0]); return 1;
+        }
+    }
+
+    size_t tune_count = (size_t)(argc - optind);
+    int single = (ssf_path || log_path || out_path);
+    if (single && (!ssf_path || !log_path || !out_path || tune_count)) {
+        fprintf(stderr, "beta99_pack: --ssf, --log and --out go together, without tune arguments\n");
+        return 1;
+    }
+    if (!single && tune_count == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (!single && out_dir && mkdir(out_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "beta99_pack: mkdir %s: %s\n", out_dir, strerror(errno));
+        return 1;
+    }
+
+    pack_queue_t q;
+    q.count = single ? 1 : tune_count;
+    q.max_ops = (unsigned)max_ops;
+    q.keep = dict_path != NULL;
+    atomic_init(&q.next, 0);
+    q.jobs = calloc(q.count, sizeof *q.jobs);
+    if (!q.jobs) {
+        perror("beta99_pack: alloc");
+        return 1;
+    }
+    if (single) {
+        snprintf(q.jobs[0].ssf, sizeof q.jobs[0].ssf, "%s", ssf_path);
+        snprintf(q.jobs[0].log, sizeof q.jobs[0].log, "%s", log_path);
+        snprintf(q.jobs[0].out, sizeof q.jobs[0].out, "%s", out_path);
+    } else {
+        for (size_t i = 0; i < tune_count; ++i) {
+            if (job_from_tune(&q.jobs[i], argv[optind + (int)i], out_dir) != 0) {
+                free(q.jobs);
+                return 1;
+            }
+        }
+    }
+
+    if (jobs == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = cpus > 0 ? cpus : 1;
+    }
+    if ((size_t)jobs > q.count) jobs = (long)q.count;
+
+    beta99_dict_t *dict = NULL;
+    if (dict_path) {
+        dict = beta99_dict_load(dict_path);
+        if (!dict) {
+            free(q.jobs);
+            return 1;
+        }
+    }
+    size_t dict_before = dict ? beta99_dict_count(dict) : 0;
+
+    double t0 = monotonic_seconds();
+    pthread_t *threads = calloc((size_t)jobs, sizeof *threads);
+    long started = 0;
+    if (threads) {
+        for (; started < jobs - 1; ++started) {
+            if (pthread_create(&threads[started], NULL, pack_worker, &q) != 0) break;
+        }
+    }
+    pack_worker(&q);
+    for (long i = 0; i < started; ++i) pthread_join(threads[i], NULL);
+    free(threads);
+
+    int failed = 0;
+    size_t rows = 0;
+    size_t reused = 0, bytes_saved = 0;
+    for (size_t i = 0; i < q.count; ++i) {
+        pack_job_t *job = &q.jobs[i];
+        beta99_ref_stats_t ref;
+        if (job->rc == 0 && dict) {
+            job->rc = beta99_bundle_write_ref(job->bundle, dict, job->out, &ref);
+            beta99_bundle_free(job->bundle);
+            job->bundle = NULL;
+        }
+        if (job->rc != 0) {
+            fprintf(stderr, "beta99_pack: failed to pack %s\n", job->ssf);
+            failed++;
+            continue;
+        }
+        rows += job->stats.ssf_rows + job->stats.log_rows;
+        if (dict) {
+            reused += ref.reused;
+            bytes_saved += ref.bytes_saved;
+        }
+        if (quiet) continue;
+        if (dict) {
+            printf("beta99 bundle written to %s | SSFs: %zu (%zu new, %zu shared) | Triggers: %zu\n",
+                   job->out, job->stats.ssf_count, ref.added, ref.reused,
+                   job->stats.trigger_count);
+        } else {
+            printf("beta99 bundle written to %s | SSFs: %zu | Triggers: %zu\n",
+                   job->out, job->stats.ssf_count, job->stats.trigger_count);
+        }
+    }
+    if (dict) {
+        if (beta99_dict_save(dict, dict_path) != 0) {
+            failed++;
+        } else if (!quiet) {
+            printf("beta99 dictionary %s | entries: %zu (+%zu) | shared SSFs: %zu (%zu bytes saved)\n",
+                   dict_path, beta99_dict_count(dict),
+                   beta99_dict_count(dict) - dict_before, reused, bytes_saved);
+        }
+        beta99_dict_free(dict);
+    }
+    double elapsed = monotonic_seconds() - t0;
+    if (!quiet && q.count > 1) {
+        fprintf(stderr, "beta99_pack: %zu tunes, %zu rows in %.2fs with %ld jobs (%.0f rows/s)\n",
+                q.count - (size_t)failed, rows, elapsed, jobs,
+                elapsed > 0 ? (double)rows / elapsed : 0.0);
+    }
+    free(q.jobs);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,1166 @@
+/*
+ * beta99_packer.c - native beta99 bundle builder (see beta99_packer.h).
+ *
+ * Mirrors beta99_pack.py step by step so the bundles are identical:
+ *   - SSF rows are grouped by hashid in first-seen order (an open-addressing
+ *     map instead of pandas groupby) and each group is stably sorted by
+ *     clock;
+ *   - every row is turned into ops with the same change detection, state
+ *     carry-over and masking as _build_ops_for_group();
+ *   - long op lists are split into max_ops chunks, and every log trigger
+ *     fires all chunks of its hashid (first with the clock delta, the rest
+ *     with 0).
+ * The CSVs are streamed through ssf_reader, so only the parsed integer
+ * columns are held in memory; columnar *.ssfc inputs (ssf2col) are read
+ * through ssfcol without any parsing, and beta99_input_* rows are used
+ * as given.
+ */
+#define _POSIX_C_SOURCE 200809L
+#define _DARWIN_C_SOURCE 1
+
+#include "beta99_packer.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ssf_reader.h"
+#include "ssfcol.h"
+
+#define B99_MAGIC "B99F"
+#define B99_VERSION 1
+#define B99_MAX_FIELDS 64
+
+enum {
+    OP_SET_FREQ = 0x01,
+    OP_SET_PW = 0x02,
+    OP_SET_CTRL = 0x03,
+    OP_SET_AD = 0x04,
+    OP_SET_SR = 0x05,
+    OP_SET_MOD_FREQ = 0x06,
+    OP_SET_MOD_TEST = 0x07,
+    OP_SET_FILTER_ROUTE = 0x08,
+    OP_SET_FILTER_EXT = 0x09,
+    OP_SET_FILTER_CUTOFF = 0x0A,
+    OP_SET_FILTER_RES = 0x0B,
+    OP_SET_FILTER_MODE = 0x0C,
+    OP_SET_VOLUME = 0x0D,
+};
+
+const char *const beta99_ssf_columns[BETA99_COL_COUNT] = {
+    "clock",
+    "gate1", "sync1", "ring1", "test1",
+    "tri1", "saw1", "pulse1", "noise1",
+    "fltlo", "fltband", "flthi",
+    "freq1", "pwduty1",
+    "atk1", "dec1", "sus1", "rel1",
+    "freq3", "test3",
+    "flt1", "fltext", "fltcoff", "fltres",
+    "vol",
+};
+
+typedef beta99_ssf_row_t ssf_row_t;
+
+typedef struct {
+    int64_t hashid;
+    size_t rows;                /* rows in the group */
+    size_t first;               /* offset into the grouped row order */
+    size_t chunk_first;         /* first SSF index */
+    size_t chunk_count;
+} group_t;
+
+/* hashid -> group index, linear probing, slots hold index + 1. */
+typedef struct {
+    group_t *groups;
+    size_t count;
+    size_t cap;
+    uint32_t *slots;
+    size_t slot_mask;
+} group_map_t;
+
+typedef struct {
+    int64_t delta;
+    uint8_t opcode;
+    uint8_t len;
+    uint8_t data[2];
+} b99_op_t;
+
+typedef struct {
+    int64_t clock;
+    int64_t hashid;
+    int64_t voice;
+} log_row_t;
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+} byte_buf_t;
+
+typedef struct {
+    const char *name;           /* input named in error messages */
+    ssf_row_t *rows;
+    size_t row_count;
+    size_t row_cap;
+    group_map_t map;
+    size_t *order;              /* row indices grouped and clock-sorted */
+    b99_op_t *ops;
+    size_t op_count;
+    size_t op_cap;
+    log_row_t *log;
+    size_t log_count;
+    size_t log_cap;
+    size_t *ssf_off;            /* start of each SSF entry in out */
+    size_t ssf_off_cap;
+    size_t ssf_count;
+    size_t trigger_count;
+    byte_buf_t out;
+} packer_t;
+
+static uint64_t hashid_slot(int64_t hashid) {
+    uint64_t x = (uint64_t)hashid;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static int group_map_grow(group_map_t *map) {
+    size_t new_size = map->slots ? (map->slot_mask + 1) * 2 : 1024;
+    uint32_t *slots = calloc(new_size, sizeof *slots);
+    if (!slots) return -1;
+    for (size_t i = 0; i < map->count; ++i) {
+        size_t s = (size_t)hashid_slot(map->groups[i].hashid) & (new_size - 1);
+        while (slots[s]) s = (s + 1) & (new_size - 1);
+        slots[s] = (uint32_t)(i + 1);
+    }
+    free(map->slots);
+    map->slots = slots;
+    map->slot_mask = new_size - 1;
+    return 0;
+}
+
+static group_t *group_map_find(const group_map_t *map, int64_t hashid) {
+    if (!map->slots) return NULL;
+    size_t s = (size_t)hashid_slot(hashid) & map->slot_mask;
+    while (map->slots[s]) {
+        group_t *g = &map->groups[map->slots[s] - 1];
+        if (g->hashid == hashid) return g;
+        s = (s + 1) & map->slot_mask;
+    }
+    return NULL;
+}
+
+/* Find or insert; NULL on allocation failure. */
+static group_t *group_map_get(group_map_t *map, int64_t hashid) {
+    group_t *g = group_map_find(map, hashid);
+    if (g) return g;
+    if (!map->slots || (map->count + 1) * 4 > (map->slot_mask + 1) * 3) {
+        if (group_map_grow(map) != 0) return NULL;
+    }
+    if (map->count == map->cap) {
+        size_t cap = map->cap ? map->cap * 2 : 256;
+        group_t *groups = realloc(map->groups, cap * sizeof *groups);
+        if (!groups) return NULL;
+        map->groups = groups;
+        map->cap = cap;
+    }
+    g = &map->groups[map->count];
+    memset(g, 0, sizeof *g);
+    g->hashid = hashid;
+    size_t s = (size_t)hashid_slot(hashid) & map->slot_mask;
+    while (map->slots[s]) s = (s + 1) & map->slot_mask;
+    map->slots[s] = (uint32_t)(++map->count);
+    return g;
+}
+
+static int grow_array(void **ptr, size_t *cap, size_t need, size_t elem) {
+    if (need <= *cap) return 0;
+    size_t cap2 = *cap ? *cap : 1024;
+    while (cap2 < need) cap2 *= 2;
+    void *p = realloc(*ptr, cap2 * elem);
+    if (!p) return -1;
+    *ptr = p;
+    *cap = cap2;
+    return 0;
+}
+
+/*
+ * Parse a cell the way pandas reads it and int() converts it: 0 for an
+ * empty/NaN cell, 1 with *out set otherwise ("12", "12.0", "True").
+ */
+static int parse_cell(const char *s, int64_t *out) {
+    if (!*s || strcmp(s, "nan") == 0 || strcmp(s, "NaN") == 0 ||
+        strcmp(s, "NA") == 0 || strcmp(s, "<NA>") == 0 || strcmp(s, "null") == 0) {
+        return 0;
+    }
+    if (strcmp(s, "True") == 0) {
+        *out = 1;
+        return 1;
+    }
+    if (strcmp(s, "False") == 0) {
+        *out = 0;
+        return 1;
+    }
+    char *end = NULL;
+    errno = 0;
+    long long v = strtoll(s, &end, 10);
+    if (*end == '.' || *end == 'e' || *end == 'E') {
+        *out = (int64_t)strtod(s, NULL);
+        return 1;
+    }
+    *out = (int64_t)v;
+    return 1;
+}
+
+static int find_column(char **fields, int nfields, const char *name) {
+    for (int i = 0; i < nfields; ++i) {
+        if (strcmp(fields[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+static bool is_ssfc_path(const char *path) {
+    uint8_t head[4];
+    FILE *fp = path ? fopen(path, "rb") : NULL;
+    if (!fp) return false;
+    size_t n = fread(head, 1, sizeof head, fp);
+    fclose(fp);
+    return ssfcol_is_ssfc(head, n);
+}
+
+/* Columns of an ssfc table by name; NULL (after a message) if missing. */
+static const ssfcol_column_t *ssfc_column(ssfcol_t *f, const char *path, const char *name,
+                                          bool required) {
+    int i = ssfcol_find(f, name);
+    if (i < 0) {
+        if (required) fprintf(stderr, "beta99_pack: %s: missing column '%s'\n", path, name);
+        return NULL;
+    }
+    return ssfcol_column(f, i);
+}
+
+/* load_ssf() from a columnar table: same rows, no text to parse. */
+static int read_ssf_columnar(const char *path, const int64_t *only_hashid,
+                             beta99_ssf_row_fn fn, void *user) {
+    ssfcol_t f;
+    if (ssfcol_open(&f, path) != 0) return -1;
+    const ssfcol_column_t *hc = ssfc_column(&f, path, "hashid", true);
+    const ssfcol_column_t *col[BETA99_COL_COUNT];
+    int rc = hc ? 0 : -1;
+    for (int c = 0; c < BETA99_COL_COUNT; ++c) {
+        col[c] = ssfc_column(&f, path, beta99_ssf_columns[c], true);
+        if (!col[c]) rc = -1;
+    }
+    /* With a hashid index only the wanted rows are visited. */
+    uint64_t first = 0, count = f.row_count;
+    if (rc == 0 && only_hashid && f.index_count &&
+        !ssfcol_hashid_rows(&f, *only_hashid, &first, &count)) {
+        count = 0;
+    }
+    beta99_ssf_row_t row;
+    for (uint64_t r = first; rc == 0 && r < first + count; ++r) {
+        if (!ssfcol_present(hc, r)) continue;
+        row.hashid = ssfcol_i64(hc, r);
+        if (only_hashid && row.hashid != *only_hashid) continue;
+        row.present = 0;
+        for (int c = 0; c < BETA99_COL_COUNT; ++c) {
+            bool present = ssfcol_present(col[c], r);
+            row.v[c] = present ? ssfcol_i64(col[c], r) : 0;
+            if (present) row.present |= 1u << c;
+        }
+        if (!(row.present & (1u << BETA99_COL_CLOCK))) {
+            fprintf(stderr, "beta99_pack: %s: row %llu has no clock\n", path,
+                    (unsigned long long)r + 1);
+            rc = -1;
+        } else if (fn(user, &row) != 0) {
+            rc = -1;
+        }
+    }
+    ssfcol_close(&f);
+    return rc;
+}
+
+static int load_log_columnar(packer_t *p, const char *path) {
+    ssfcol_t f;
+    if (ssfcol_open(&f, path) != 0) return -1;
+    const ssfcol_column_t *cc = ssfc_column(&f, path, "clock", true);
+    const ssfcol_column_t *hc = ssfc_column(&f, path, "hashid", true);
+    const ssfcol_column_t *vc = ssfc_column(&f, path, "voice", false);
+    int rc = (cc && hc) ? 0 : -1;
+    if (rc == 0 && grow_array((void **)&p->log, &p->log_cap, (size_t)f.row_count,
+                              sizeof *p->log) != 0) {
+        perror("beta99_pack: alloc");
+        rc = -1;
+    }
+    for (uint64_t r = 0; rc == 0 && r < f.row_count; ++r) {
+        if (!ssfcol_present(cc, r) || !ssfcol_present(hc, r)) continue;
+        log_row_t *row = &p->log[p->log_count++];
+        row->clock = ssfcol_i64(cc, r);
+        row->hashid = ssfcol_i64(hc, r);
+        row->voice = (vc && ssfcol_present(vc, r)) ? ssfcol_i64(vc, r) : 0;
+    }
+    ssfcol_close(&f);
+    return rc;
+}
+
+int beta99_ssf_read(const char *path, const int64_t *only_hashid,
+                    beta99_ssf_row_fn fn, void *user) {
+    if (is_ssfc_path(path)) return read_ssf_columnar(path, only_hashid, fn, user);
+    const char *name = path ? path : "<stdin>";
+    ssf_reader_t r;
+    if (ssf_reader_open(&r, path) != 0) return -1;
+
+    char *fields[B99_MAX_FIELDS];
+    int col[BETA99_COL_COUNT];
+    int col_hashid = -1;
+    bool header = false;
+    int rc = 0;
+    size_t rows = 0;
+    size_t len;
+    char *line;
+
+    while ((line = ssf_reader_line(&r, &len)) != NULL) {
+        if (len == 0) continue;
+        int n = ssf_split_csv(line, len, fields, B99_MAX_FIELDS);
+        if (!header) {
+            col_hashid = find_column(fields, n, "hashid");
+            if (col_hashid < 0) {
+                fprintf(stderr, "beta99_pack: %s: missing column 'hashid'\n", name);
+                rc = -1;
+                break;
+            }
+            for (int c = 0; c < BETA99_COL_COUNT; ++c) {
+                col[c] = find_column(fields, n, beta99_ssf_columns[c]);
+                if (col[c] < 0) {
+                    fprintf(stderr, "beta99_pack: %s: missing column '%s'\n",
+                            name, beta99_ssf_columns[c]);
+                    rc = -1;
+                }
+            }
+            if (rc != 0) break;
+            header = true;
+            continue;
+        }
+
+        beta99_ssf_row_t row;
+        if (col_hashid >= n || !parse_cell(fields[col_hashid], &row.hashid)) continue;
+        rows++;
+        if (only_hashid && row.hashid != *only_hashid) continue;
+        row.present = 0;
+        for (int c = 0; c < BETA99_COL_COUNT; ++c) {
+            row.v[c] = 0;
+            if (col[c] < n && parse_cell(fields[col[c]], &row.v[c])) {
+                row.present |= 1u << c;
+            }
+        }
+        if (!(row.present & (1u << BETA99_COL_CLOCK))) {
+            fprintf(stderr, "beta99_pack: %s: row %zu has no clock\n", name, rows);
+            rc = -1;
+            break;
+        }
+        if (fn(user, &row) != 0) {
+            rc = -1;
+            break;
+        }
+    }
+    if (rc == 0 && r.error) rc = -1;
+    if (rc == 0 && !header) {
+        fprintf(stderr, "beta99_pack: %s: empty SSF table\n", name);
+        rc = -1;
+    }
+    ssf_reader_close(&r);
+    return rc;
+}
+
+static int push_row(void *user, const beta99_ssf_row_t *row) {
+    packer_t *p = user;
+    if (grow_array((void **)&p->rows, &p->row_cap, p->row_count + 1, sizeof *p->rows) != 0) {
+        perror("beta99_pack: alloc");
+        return -1;
+    }
+    p->rows[p->row_count++] = *row;
+    return 0;
+}
+
+static int load_ssf(packer_t *p, const char *path) {
+    return beta99_ssf_read(path, NULL, push_row, p);
+}
+
+static int load_log(packer_t *p, const char *path) {
+    if (is_ssfc_path(path)) return load_log_columnar(p, path);
+    ssf_reader_t r;
+    if (ssf_reader_open(&r, path) != 0) return -1;
+
+    char *fields[B99_MAX_FIELDS];
+    int col_clock = -1, col_hashid = -1, col_voice = -1;
+    bool header = false;
+    int rc = 0;
+    size_t len;
+    char *line;
+
+    while ((line = ssf_reader_line(&r, &len)) != NULL) {
+        if (len == 0) continue;
+        int n = ssf_split_csv(line, len, fields, B99_MAX_FIELDS);
+        if (!header) {
+            col_clock = find_column(fields, n, "clock");
+            col_hashid = find_column(fields, n, "hashid");
+            col_voice = find_column(fields, n, "voice");
+            if (col_clock < 0 || col_hashid < 0) {
+                fprintf(stderr, "beta99_pack: %s: log needs 'clock' and 'hashid' columns\n",
+                        path);
+                rc = -1;
+                break;
+            }
+            header = true;
+            continue;
+        }
+        log_row_t row = {0, 0, 0};
+        if (col_clock >= n || col_hashid >= n ||
+            !parse_cell(fields[col_clock], &row.clock) ||
+            !parse_cell(fields[col_hashid], &row.hashid)) {
+            continue;
+        }
+        if (col_voice >= 0 && col_voice < n) parse_cell(fields[col_voice], &row.voice);
+        if (grow_array((void **)&p->log, &p->log_cap, p->log_count + 1, sizeof *p->log) != 0) {
+            perror("beta99_pack: alloc");
+            rc = -1;
+            break;
+        }
+        p->log[p->log_count++] = row;
+    }
+    if (rc == 0 && r.error) rc = -1;
+    ssf_reader_close(&r);
+    return rc;
+}
+
+/* Stable merge sort of idx[0..n) by key[idx]; tmp holds n entries. */
+static void sort_by_clock(size_t *idx, size_t *tmp, size_t n,
+                          const void *base, size_t stride) {
+    if (n < 2) return;
+    bool sorted = true;
+    for (size_t i = 1; i < n && sorted; ++i) {
+        sorted = *(const int64_t *)((const char *)base + idx[i - 1] * stride) <=
+                 *(const int64_t *)((const char *)base + idx[i] * stride);
+    }
+    if (sorted) return;
+    size_t mid = n / 2;
+    sort_by_clock(idx, tmp, mid, base, stride);
+    sort_by_clock(idx + mid, tmp, n - mid, base, stride);
+    size_t a = 0, b = mid, o = 0;
+    while (a < mid && b < n) {
+        int64_t ka = *(const int64_t *)((const char *)base + idx[a] * stride);
+        int64_t kb = *(const int64_t *)((const char *)base + idx[b] * stride);
+        tmp[o++] = (kb < ka) ? idx[b++] : idx[a++];
+    }
+    while (a < mid) tmp[o++] = idx[a++];
+    while (b < n) tmp[o++] = idx[b++];
+    memcpy(idx, tmp, n * sizeof *idx);
+}
+
+static int group_rows(packer_t *p) {
+    for (size_t i = 0; i < p->row_count; ++i) {
+        group_t *g = group_map_get(&p->map, p->rows[i].hashid);
+        if (!g) {
+            perror("beta99_pack: alloc");
+            return -1;
+        }
+        g->rows++;
+    }
+    size_t off = 0;
+    for (size_t gi = 0; gi < p->map.count; ++gi) {
+        p->map.groups[gi].first = off;
+        off += p->map.groups[gi].rows;
+        p->map.groups[gi].rows = 0;
+    }
+    p->order = malloc((p->row_count ? p->row_count : 1) * sizeof *p->order);
+    size_t *tmp = malloc((p->row_count ? p->row_count : 1) * sizeof *tmp);
+    if (!p->order || !tmp) {
+        free(tmp);
+        perror("beta99_pack: alloc");
+        return -1;
+    }
+    for (size_t i = 0; i < p->row_count; ++i) {
+        group_t *g = group_map_find(&p->map, p->rows[i].hashid);
+        p->order[g->first + g->rows++] = i;
+    }
+    for (size_t gi = 0; gi < p->map.count; ++gi) {
+        group_t *g = &p->map.groups[gi];
+        sort_by_clock(p->order + g->first, tmp, g->rows,
+                      &p->rows[0].v[BETA99_COL_CLOCK], sizeof *p->rows);
+    }
+    free(tmp);
+    return 0;
+}
+
+/* Per-group state of _build_ops_for_group(); has_* = "not None". */
+typedef struct {
+    int64_t pending_delta;
+    uint8_t ctrl_bits;
+    uint8_t mode_bits;
+    uint8_t atk, dec, sus, rel;
+    bool has_freq, has_pw, has_ctrl, has_ad, has_sr, has_mod_freq, has_mod_test;
+    bool has_route, has_ext, has_cutoff, has_res, has_mode, has_vol;
+    int64_t last_freq, last_pw, last_mod_freq, last_cutoff, last_res, last_vol;
+    uint8_t last_ctrl, last_ad, last_sr, last_mod_test, last_route, last_ext, last_mode;
+} op_state_t;
+
+static int emit_op(packer_t *p, op_state_t *st, uint8_t opcode, const uint8_t *data, uint8_t len) {
+    if (grow_array((void **)&p->ops, &p->op_cap, p->op_count + 1, sizeof *p->ops) != 0) {
+        perror("beta99_pack: alloc");
+        return -1;
+    }
+    b99_op_t *op = &p->ops[p->op_count++];
+    op->delta = st->pending_delta;
+    op->opcode = opcode;
+    op->len = len;
+    memcpy(op->data, data, len);
+    st->pending_delta = 0;
+    return 0;
+}
+
+static int emit_u16(packer_t *p, op_state_t *st, uint8_t opcode, int64_t value) {
+    uint8_t d[2] = { (uint8_t)(value & 0xff), (uint8_t)((value >> 8) & 0xff) };
+    return emit_op(p, st, opcode, d, 2);
+}
+
+static int emit_u8(packer_t *p, op_state_t *st, uint8_t opcode, uint8_t value) {
+    return emit_op(p, st, opcode, &value, 1);
+}
+
+#define HAS(row, c) (((row)->present >> (c)) & 1u)
+
+static int build_row_ops(packer_t *p, op_state_t *st, const ssf_row_t *row) {
+    const int64_t *v = row->v;
+
+    if (HAS(row, BETA99_COL_FREQ1) && (!st->has_freq || v[BETA99_COL_FREQ1] != st->last_freq)) {
+        if (emit_u16(p, st, OP_SET_FREQ, v[BETA99_COL_FREQ1])) return -1;
+        st->last_freq = v[BETA99_COL_FREQ1];
+        st->has_freq = true;
+    }
+    if (HAS(row, BETA99_COL_PWDUTY1) && (!st->has_pw || v[BETA99_COL_PWDUTY1] != st->last_pw)) {
+        if (emit_u16(p, st, OP_SET_PW, v[BETA99_COL_PWDUTY1])) return -1;
+        st->last_pw = v[BETA99_COL_PWDUTY1];
+        st->has_pw = true;
+    }
+
+    bool ctrl_changed = false;
+    for (int b = 0; b < 8; ++b) {
+        if (!HAS(row, BETA99_COL_GATE1 + b)) continue;
+        if (v[BETA99_COL_GATE1 + b]) st->ctrl_bits |= (uint8_t)(1u << b);
+        else st->ctrl_bits &= (uint8_t)~(1u << b);
+        ctrl_changed = true;
+    }
+    if (ctrl_changed && (!st->has_ctrl || st->ctrl_bits != st->last_ctrl)) {
+        if (emit_u8(p, st, OP_SET_CTRL, st->ctrl_bits)) return -1;
+        st->last_ctrl = st->ctrl_bits;
+        st->has_ctrl = true;
+    }
+
+    if (HAS(row, BETA99_COL_ATK1)) st->atk = (uint8_t)(v[BETA99_COL_ATK1] & 0x0f);
+    if (HAS(row, BETA99_COL_DEC1)) st->dec = (uint8_t)(v[BETA99_COL_DEC1] & 0x0f);
+    if (HAS(row, BETA99_COL_ATK1) || HAS(row, BETA99_COL_DEC1)) {
+        uint8_t ad = (uint8_t)((st->atk << 4) | st->dec);
+        if (!st->has_ad || ad != st->last_ad) {
+            if (emit_u8(p, st, OP_SET_AD, ad)) return -1;
+            st->last_ad = ad;
+            st->has_ad = true;
+        }
+    }
+    if (HAS(row, BETA99_COL_SUS1)) st->sus = (uint8_t)(v[BETA99_COL_SUS1] & 0x0f);
+    if (HAS(row, BETA99_COL_REL1)) st->rel = (uint8_t)(v[BETA99_COL_REL1] & 0x0f);
+    if (HAS(row, BETA99_COL_SUS1) || HAS(row, BETA99_COL_REL1)) {
+        uint8_t sr = (uint8_t)((st->sus << 4) | st->rel);
+        if (!st->has_sr || sr != st->last_sr) {
+            if (emit_u8(p, st, OP_SET_SR, sr)) return -1;
+            st->last_sr = sr;
+            st->has_sr = true;
+        }
+    }
+
+    if (HAS(row, BETA99_COL_FREQ3) &&
+        (!st->has_mod_freq || v[BETA99_COL_FREQ3] != st->last_mod_freq)) {
+        if (emit_u16(p, st, OP_SET_MOD_FREQ, v[BETA99_COL_FREQ3])) return -1;
+        st->last_mod_freq = v[BETA99_COL_FREQ3];
+        st->has_mod_freq = true;
+    }
+    if (HAS(row, BETA99_COL_TEST3)) {
+        uint8_t t = v[BETA99_COL_TEST3] ? 1 : 0;
+        if (!st->has_mod_test || t != st->last_mod_test) {
+            if (emit_u8(p, st, OP_SET_MOD_TEST, t)) return -1;
+            st->last_mod_test = t;
+            st->has_mod_test = true;
+        }
+    }
+    if (HAS(row, BETA99_COL_FLT1)) {
+        uint8_t r = v[BETA99_COL_FLT1] ? 1 : 0;
+        if (!st->has_route || r != st->last_route) {
+            if (emit_u8(p, st, OP_SET_FILTER_ROUTE, r)) return -1;
+            st->last_route = r;
+            st->has_route = true;
+        }
+    }
+    if (HAS(row, BETA99_COL_FLTEXT)) {
+        uint8_t e = v[BETA99_COL_FLTEXT] ? 1 : 0;
+        if (!st->has_ext || e != st->last_ext) {
+            if (emit_u8(p, st, OP_SET_FILTER_EXT, e)) return -1;
+            st->last_ext = e;
+            st->has_ext = true;
+        }
+    }
+    if (HAS(row, BETA99_COL_FLTCOFF) &&
+        (!st->has_cutoff || v[BETA99_COL_FLTCOFF] != st->last_cutoff)) {
+        if (emit_u16(p, st, OP_SET_FILTER_CUTOFF, v[BETA99_COL_FLTCOFF])) return -1;
+        st->last_cutoff = v[BETA99_COL_FLTCOFF];
+        st->has_cutoff = true;
+    }
+    /* The script compares the raw value against the masked one it stored. */
+    if (HAS(row, BETA99_COL_FLTRES) && (!st->has_res || v[BETA99_COL_FLTRES] != st->last_res)) {
+        if (emit_u8(p, st, OP_SET_FILTER_RES, (uint8_t)(v[BETA99_COL_FLTRES] & 0x0f))) return -1;
+        st->last_res = v[BETA99_COL_FLTRES] & 0x0f;
+        st->has_res = true;
+    }
+
+    bool mode_changed = false;
+    for (int b = 0; b < 3; ++b) {
+        if (!HAS(row, BETA99_COL_FLTLO + b)) continue;
+        if (v[BETA99_COL_FLTLO + b]) st->mode_bits |= (uint8_t)(1u << b);
+        else st->mode_bits &= (uint8_t)~(1u << b);
+        mode_changed = true;
+    }
+    if (mode_changed && (!st->has_mode || st->mode_bits != st->last_mode)) {
+        if (emit_u8(p, st, OP_SET_FILTER_MODE, st->mode_bits & 0x07)) return -1;
+        st->last_mode = st->mode_bits;
+        st->has_mode = true;
+    }
+
+    if (HAS(row, BETA99_COL_VOL) && (!st->has_vol || v[BETA99_COL_VOL] != st->last_vol)) {
+        if (emit_u8(p, st, OP_SET_VOLUME, (uint8_t)(v[BETA99_COL_VOL] & 0x0f))) return -1;
+        st->last_vol = v[BETA99_COL_VOL] & 0x0f;
+        st->has_vol = true;
+    }
+    return 0;
+}
+
+static int put_bytes(byte_buf_t *b, const void *data, size_t len) {
+    if (grow_array((void **)&b->data, &b->cap, b->len + len, 1) != 0) {
+        perror("beta99_pack: alloc");
+        return -1;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    return 0;
+}
+
+static int put_le(byte_buf_t *b, uint64_t v, int bytes) {
+    uint8_t tmp[8];
+    for (int i = 0; i < bytes; ++i) tmp[i] = (uint8_t)(v >> (8 * i));
+    return put_bytes(b, tmp, (size_t)bytes);
+}
+
+static int put_ssf(byte_buf_t *b, int64_t hashid, uint64_t duration,
+                   const b99_op_t *ops, size_t count) {
+    if (put_le(b, (uint64_t)hashid, 8) || put_le(b, duration & 0xffffffffu, 4) ||
+        put_le(b, count, 4)) {
+        return -1;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (put_le(b, (uint64_t)ops[i].delta & 0xffffffffu, 4) ||
+            put_le(b, ops[i].opcode, 1) || put_le(b, ops[i].len, 1) ||
+            put_bytes(b, ops[i].data, ops[i].len)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Start of a new SSF entry in p->out. */
+static int mark_ssf(packer_t *p) {
+    if (grow_array((void **)&p->ssf_off, &p->ssf_off_cap, p->ssf_count + 2,
+                   sizeof *p->ssf_off) != 0) {
+        perror("beta99_pack: alloc");
+        return -1;
+    }
+    p->ssf_off[p->ssf_count++] = p->out.len;
+    return 0;
+}
+
+/* Ops for every group, written straight into the SSF table of p->out. */
+static int build_ssfs(packer_t *p, unsigned max_ops) {
+    for (size_t gi = 0; gi < p->map.count; ++gi) {
+        group_t *g = &p->map.groups[gi];
+        op_state_t st;
+        memset(&st, 0, sizeof st);
+        p->op_count = 0;
+        int64_t prev_clock = 0;
+        int64_t duration = 0;
+        for (size_t k = 0; k < g->rows; ++k) {
+            const ssf_row_t *row = &p->rows[p->order[g->first + k]];
+            int64_t clock = row->v[BETA99_COL_CLOCK];
+            st.pending_delta = clock - prev_clock;
+            prev_clock = clock;
+            duration = clock;
+            if (build_row_ops(p, &st, row) != 0) return -1;
+        }
+
+        g->chunk_first = p->ssf_count;
+        if (p->op_count == 0) {
+            if (mark_ssf(p) || put_ssf(&p->out, g->hashid, (uint64_t)duration, NULL, 0)) {
+                return -1;
+            }
+            g->chunk_count = 1;
+        } else {
+            size_t step = (p->op_count <= max_ops) ? p->op_count : max_ops;
+            g->chunk_count = 0;
+            for (size_t start = 0; start < p->op_count; start += step) {
+                size_t n = (p->op_count - start < step) ? p->op_count - start : step;
+                int64_t chunk_duration = 0;
+                for (size_t i = 0; i < n; ++i) chunk_duration += p->ops[start + i].delta;
+                if (mark_ssf(p) ||
+                    put_ssf(&p->out, g->hashid, (uint64_t)chunk_duration,
+                            p->ops + start, n)) {
+                    return -1;
+                }
+                g->chunk_count++;
+            }
+        }
+    }
+    p->ssf_off[p->ssf_count] = p->out.len;
+    return 0;
+}
+
+static int build_triggers(packer_t *p) {
+    size_t *idx = malloc((p->log_count ? p->log_count : 1) * sizeof *idx);
+    size_t *tmp = malloc((p->log_count ? p->log_count : 1) * sizeof *tmp);
+    if (!idx || !tmp) {
+        free(idx);
+        free(tmp);
+        perror("beta99_pack: alloc");
+        return -1;
+    }
+    for (size_t i = 0; i < p->log_count; ++i) idx[i] = i;
+    if (p->log_count) sort_by_clock(idx, tmp, p->log_count, &p->log[0].clock, sizeof *p->log);
+
+    int rc = 0;
+    size_t count = 0;
+    int64_t prev_clock = 0;
+    for (size_t i = 0; i < p->log_count && rc == 0; ++i) {
+        const log_row_t *row = &p->log[idx[i]];
+        int64_t delta = row->clock - prev_clock;
+        prev_clock = row->clock;
+        const group_t *g = group_map_find(&p->map, row->hashid);
+        if (!g) {
+            fprintf(stderr, "beta99_pack: %s: trigger references unknown SSF hash %lld\n",
+                    p->name, (long long)row->hashid);
+            rc = -1;
+            break;
+        }
+        for (size_t c = 0; c < g->chunk_count; ++c) {
+            uint8_t pad = 0;
+            if (put_le(&p->out, (uint64_t)(c == 0 ? delta : 0) & 0xffffffffu, 4) ||
+                put_le(&p->out, (g->chunk_first + c) & 0xffff, 2) ||
+                put_le(&p->out, (uint64_t)row->voice & 0xff, 1) ||
+                put_bytes(&p->out, &pad, 1)) {
+                rc = -1;
+                break;
+            }
+            count++;
+        }
+    }
+    free(idx);
+    free(tmp);
+    p->trigger_count = count;
+    return rc;
+}
+
+static int write_file(const char *path, const void *data, size_t len) {
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        fprintf(stderr, "beta99_pack: open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    size_t w = fwrite(data, 1, len, fp);
+    if (fclose(fp) != 0 || w != len) {
+        fprintf(stderr, "beta99_pack: write %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static void packer_free(packer_t *p) {
+    free(p->rows);
+    free(p->map.groups);
+    free(p->map.slots);
+    free(p->order);
+    free(p->ops);
+    free(p->log);
+    free(p->ssf_off);
+    free(p->out.data);
+}
+
+/* A packed B99F image plus where each SSF entry sits in it. */
+struct beta99_bundle {
+    byte_buf_t out;
+    size_t *ssf_off;            /* ssf_count + 1 offsets, the last is the table end */
+    size_t ssf_count;
+    size_t trigger_count;
+};
+
+/* Group the loaded rows and write the bundle; p keeps its inputs. */
+static beta99_bundle_t *pack_loaded(packer_t *p, unsigned max_ops,
+                                    beta99_pack_stats_t *stats) {
+    if (max_ops == 0) max_ops = 1;
+    if (group_rows(p) != 0) return NULL;
+
+    /* Header counts are patched once the table sizes are known. */
+    uint8_t header[16] = {0};
+    memcpy(header, B99_MAGIC, 4);
+    header[4] = B99_VERSION;
+    if (put_bytes(&p->out, header, sizeof header) != 0 || build_ssfs(p, max_ops) != 0) {
+        return NULL;
+    }
+    if (p->ssf_count > 0xffff) {
+        fprintf(stderr, "beta99_pack: %s: too many SSFs for 16-bit indices (%zu)\n",
+                p->name, p->ssf_count);
+        return NULL;
+    }
+    if (build_triggers(p) != 0) return NULL;
+    for (int i = 0; i < 4; ++i) {
+        p->out.data[8 + i] = (uint8_t)((uint64_t)p->ssf_count >> (8 * i));
+        p->out.data[12 + i] = (uint8_t)((uint64_t)p->trigger_count >> (8 * i));
+    }
+
+    beta99_bundle_t *b = calloc(1, sizeof *b);
+    if (!b) {
+        perror("beta99_pack: alloc");
+        return NULL;
+    }
+    b->out = p->out;
+    b->ssf_off = p->ssf_off;
+    b->ssf_count = p->ssf_count;
+    b->trigger_count = p->trigger_count;
+    memset(&p->out, 0, sizeof p->out);
+    p->ssf_off = NULL;
+
+    if (stats) {
+        stats->ssf_rows = p->row_count;
+        stats->log_rows = p->log_count;
+        stats->ssf_count = b->ssf_count;
+        stats->trigger_count = b->trigger_count;
+        stats->bytes = b->out.len;
+    }
+    return b;
+}
+
+beta99_bundle_t *beta99_pack(const char *ssf_path, const char *log_path,
+                             unsigned max_ops, beta99_pack_stats_t *stats) {
+    packer_t p;
+    memset(&p, 0, sizeof p);
+    p.name = ssf_path;
+
+    beta99_bundle_t *b = NULL;
+    if (load_ssf(&p, ssf_path) == 0 && load_log(&p, log_path) == 0) {
+        b = pack_loaded(&p, max_ops, stats);
+    }
+    packer_free(&p);
+    return b;
+}
+
+struct beta99_input {
+    packer_t p;
+    char *name;
+};
+
+beta99_input_t *beta99_input_new(const char *name) {
+    beta99_input_t *in = calloc(1, sizeof *in);
+    if (!in || !(in->name = strdup(name))) {
+        free(in);
+        perror("beta99_pack: alloc");
+        return NULL;
+    }
+    in->p.name = in->name;
+    return in;
+}
+
+int beta99_input_add_row(beta99_input_t *in, const beta99_ssf_row_t *row) {
+    return push_row(&in->p, row);
+}
+
+int beta99_input_add_trigger(beta99_input_t *in, int64_t clock, int64_t hashid, int voice) {
+    packer_t *p = &in->p;
+    if (grow_array((void **)&p->log, &p->log_cap, p->log_count + 1, sizeof *p->log) != 0) {
+        perror("beta99_pack: alloc");
+        return -1;
+    }
+    log_row_t row = { clock, hashid, voice };
+    p->log[p->log_count++] = row;
+    return 0;
+}
+
+beta99_bundle_t *beta99_pack_input(beta99_input_t *in, unsigned max_ops,
+                                   beta99_pack_stats_t *stats) {
+    return pack_loaded(&in->p, max_ops, stats);
+}
+
+void beta99_input_free(beta99_input_t *in) {
+    if (!in) return;
+    packer_free(&in->p);
+    free(in->name);
+    free(in);
+}
+
+int beta99_bundle_write(const beta99_bundle_t *b, const char *out_path) {
+    return write_file(out_path, b->out.data, b->out.len);
+}
+
+void beta99_bundle_free(beta99_bundle_t *b) {
+    if (!b) return;
+    free(b->out.data);
+    free(b->ssf_off);
+    free(b);
+}
+
+int beta99_pack_files(const char *ssf_path, const char *log_path,
+                      const char *out_path, unsigned max_ops,
+                      beta99_pack_stats_t *stats) {
+    beta99_bundle_t *b = beta99_pack(ssf_path, log_path, max_ops, stats);
+    if (!b) return -1;
+    int rc = beta99_bundle_write(b, out_path);
+    beta99_bundle_free(b);
+    return rc;
+}
+
+/*
+ * SSF dictionary (B99D). Entries are SSF records exactly as they appear in
+ * a bundle, keyed by their bytes: an identical fragment from another tune
+ * maps to the same global index. The file is append-only so indices held
+ * by existing B99R bundles stay valid.
+ */
+struct beta99_dict {
+    byte_buf_t data;            /* concatenated entries */
+    size_t *off;                /* count + 1 offsets into data */
+    size_t count;
+    size_t off_cap;
+    uint64_t *hash;             /* content hash per entry */
+    uint32_t *slots;            /* content hash -> entry index + 1 */
+    size_t slot_mask;
+};
+
+static uint64_t content_hash(const uint8_t *p, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ULL;          /* FNV-1a */
+    for (size_t i = 0; i < len; ++i) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static int dict_grow_slots(beta99_dict_t *d) {
+    size_t new_size = d->slots ? (d->slot_mask + 1) * 2 : 1024;
+    uint32_t *slots = calloc(new_size, sizeof *slots);
+    if (!slots) return -1;
+    for (size_t i = 0; i < d->count; ++i) {
+        size_t s = (size_t)hashid_slot((int64_t)d->hash[i]) & (new_size - 1);
+        while (slots[s]) s = (s + 1) & (new_size - 1);
+        slots[s] = (uint32_t)(i + 1);
+    }
+    free(d->slots);
+    d->slots = slots;
+    d->slot_mask = new_size - 1;
+    return 0;
+}
+
+/* Global index of an entry, adding it if new. -1 on allocation failure. */
+static long dict_intern(beta99_dict_t *d, const uint8_t *entry, size_t len, bool *added) {
+    uint64_t h = content_hash(entry, len);
+    if (d->slots) {
+        size_t s = (size_t)hashid_slot((int64_t)h) & d->slot_mask;
+        while (d->slots[s]) {
+            size_t i = d->slots[s] - 1;
+            if (d->hash[i] == h && d->off[i + 1] - d->off[i] == len &&
+                memcmp(d->data.data + d->off[i], entry, len) == 0) {
+                *added = false;
+                return (long)i;
+            }
+            s = (s + 1) & d->slot_mask;
+        }
+    }
+    if (!d->slots || (d->count + 1) * 4 > (d->slot_mask + 1) * 3) {
+        if (dict_grow_slots(d) != 0) return -1;
+    }
+    if (grow_array((void **)&d->off, &d->off_cap, d->count + 2, sizeof *d->off) != 0) {
+        return -1;
+    }
+    uint64_t *hash = realloc(d->hash, d->off_cap * sizeof *hash);
+    if (!hash) return -1;
+    d->hash = hash;
+    if (put_bytes(&d->data, entry, len) != 0) return -1;
+    d->hash[d->count] = h;
+    d->off[d->count + 1] = d->data.len;
+    size_t s = (size_t)hashid_slot((int64_t)h) & d->slot_mask;
+    while (d->slots[s]) s = (s + 1) & d->slot_mask;
+    d->slots[s] = (uint32_t)(d->count + 1);
+    *added = true;
+    return (long)d->count++;
+}
+
+static uint32_t rd_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+/* Size of the SSF entry at p, or 0 if it runs past end. */
+static size_t ssf_entry_size(const uint8_t *p, const uint8_t *end) {
+    if (end - p < 16) return 0;
+    uint32_t ops = rd_le32(p + 12);
+    const uint8_t *q = p + 16;
+    for (uint32_t i = 0; i < ops; ++i) {
+        if (end - q < 6 || end - q - 6 < q[5]) return 0;
+        q += 6 + q[5];
+    }
+    return (size_t)(q - p);
+}
+
+beta99_dict_t *beta99_dict_load(const char *path) {
+    beta99_dict_t *d = calloc(1, sizeof *d);
+    if (!d) {
+        perror("beta99_pack: alloc");
+        return NULL;
+    }
+    d->off_cap = 1;
+    d->off = calloc(1, sizeof *d->off);
+    if (!d->off) {
+        perror("beta99_pack: alloc");
+        free(d);
+        return NULL;
+    }
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        if (errno == ENOENT) return d;      /* start a new dictionary */
+        fprintf(stderr, "beta99_pack: open %s: %s\n", path, strerror(errno));
+        beta99_dict_free(d);
+        return NULL;
+    }
+    byte_buf_t file = {0};
+    uint8_t chunk[65536];
+    size_t n;
+    int rc = 0;
+    while ((n = fread(chunk, 1, sizeof chunk, fp)) > 0) {
+        if (put_bytes(&file, chunk, n) != 0) {
+            rc = -1;
+            break;
+        }
+    }
+    if (ferror(fp)) rc = -1;
+    fclose(fp);
+
+    const uint8_t *base = file.data;
+    const uint8_t *end = file.data + file.len;
+    uint32_t count = 0;
+    if (rc == 0) {
+        if (file.len < BETA99_DICT_HEADER_SIZE || memcmp(base, BETA99_DICT_MAGIC, 4) != 0 ||
+            (base[4] | (base[5] << 8)) != B99_VERSION) {
+            fprintf(stderr, "beta99_pack: %s is not a B99D dictionary\n", path);
+            rc = -1;
+        } else {
+            count = rd_le32(base + 8);
+            if ((file.len - BETA99_DICT_HEADER_SIZE) / 4 < count) {
+                fprintf(stderr, "beta99_pack: %s: offset table is truncated\n", path);
+                rc = -1;
+            }
+        }
+    }
+    for (uint32_t i = 0; rc == 0 && i < count; ++i) {
+        uint32_t off = rd_le32(base + BETA99_DICT_HEADER_SIZE + 4 * i);
+        size_t size = (off < file.len) ? ssf_entry_size(base + off, end) : 0;
+        bool added = false;
+        if (size == 0) {
+            fprintf(stderr, "beta99_pack: %s: entry %u is truncated\n", path, i);
+            rc = -1;
+        } else if (dict_intern(d, base + off, size, &added) != (long)i || !added) {
+            fprintf(stderr, "beta99_pack: %s: entry %u is a duplicate\n", path, i);
+            rc = -1;
+        }
+    }
+    free(file.data);
+    if (rc != 0) {
+        beta99_dict_free(d);
+        return NULL;
+    }
+    return d;
+}
+
+int beta99_dict_save(const beta99_dict_t *d, const char *path) {
+    byte_buf_t out = {0};
+    size_t table = BETA99_DICT_HEADER_SIZE + 4 * d->count;
+    uint8_t header[BETA99_DICT_HEADER_SIZE] = {0};
+    memcpy(header, BETA99_DICT_MAGIC, 4);
+    header[4] = B99_VERSION;
+    for (int i = 0; i < 4; ++i) header[8 + i] = (uint8_t)((uint64_t)d->count >> (8 * i));
+    int rc = put_bytes(&out, header, sizeof header);
+    if (rc == 0 && table + d->data.len > UINT32_MAX) {
+        fprintf(stderr, "beta99_pack: %s: dictionary exceeds 4 GiB\n", path);
+        rc = -1;
+    }
+    for (size_t i = 0; rc == 0 && i < d->count; ++i) {
+        rc = put_le(&out, table + d->off[i], 4);
+    }
+    if (rc == 0) rc = put_bytes(&out, d->data.data, d->data.len);
+    if (rc == 0) rc = write_file(path, out.data, out.len);
+    free(out.data);
+    return rc;
+}
+
+size_t beta99_dict_count(const beta99_dict_t *d) {
+    return d->count;
+}
+
+void beta99_dict_free(beta99_dict_t *d) {
+    if (!d) return;
+    free(d->data.data);
+    free(d->off);
+    free(d->hash);
+    free(d->slots);
+    free(d);
+}
+
+int beta99_bundle_write_ref(const beta99_bundle_t *b, beta99_dict_t *dict,
+                            const char *out_path, beta99_ref_stats_t *stats) {
+    byte_buf_t out = {0};
+    beta99_ref_stats_t st;
+    memset(&st, 0, sizeof st);
+    int rc = put_bytes(&out, b->out.data, 16);
+    if (rc == 0) memcpy(out.data, BETA99_REF_MAGIC, 4);
+    for (size_t i = 0; rc == 0 && i < b->ssf_count; ++i) {
+        size_t len = b->ssf_off[i + 1] - b->ssf_off[i];
+        bool added = false;
+        long index = dict_intern(dict, b->out.data + b->ssf_off[i], len, &added);
+        if (index < 0) {
+            perror("beta99_pack: alloc");
+            rc = -1;
+            break;
+        }
+        if (added) {
+            st.added++;
+        } else {
+            st.reused++;
+            st.bytes_saved += len;
+        }
+        rc = put_le(&out, (uint64_t)index, 4);
+    }
+    if (rc == 0) {
+        size_t table_end = b->ssf_off[b->ssf_count];
+        rc = put_bytes(&out, b->out.data + table_end, b->out.len - table_end);
+    }
+    if (rc == 0) rc = write_file(out_path, out.data, out.len);
+    if (rc == 0 && stats) {
+        st.bytes = out.len;
+        *stats = st;
+    }
+    free(out.data);
+    return rc;
+}
@@ -0,0 +1,124 @@
+/*
+ * beta99_packer.h - build beta99 (B99F) bundles from desidulate SSF/log CSV.
+ *
+ * Native port of tools/beta99_pack.py: the output is byte-for-byte the
+ * same as the script's. Inputs are plain or zstd CSV (see ssf_reader.h).
+ * Each pack call is self-contained, so several bundles can be packed from
+ * different threads at once.
+ *
+ * A corpus can instead share one SSF dictionary (B99D): each bundle is
+ * then written as B99R, whose SSF table holds u32 dictionary indices in
+ * place of the SSF records. Dictionary calls are not thread-safe.
+ *
+ * Programs that generate SID data themselves (the tracker export) can
+ * skip the CSV and hand the packer SSF rows and triggers in memory.
+ */
+#ifndef BETA99_PACKER_H
+#define BETA99_PACKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BETA99_DEFAULT_MAX_OPS 512
+#define BETA99_REF_MAGIC "B99R"
+#define BETA99_DICT_MAGIC "B99D"
+/* "B99D" u16 version u16 reserved u32 entry_count u32 reserved, followed
+ * by entry_count u32 file offsets and the SSF records themselves. */
+#define BETA99_DICT_HEADER_SIZE 16
+
+typedef struct beta99_bundle beta99_bundle_t;
+typedef struct beta99_dict beta99_dict_t;
+typedef struct beta99_input beta99_input_t;
+
+/* SSF columns the packer reads, named as in the desidulate CSV. The eight
+ * control bits are in register bit order (gate = bit 0 ... noise = bit 7),
+ * the three filter mode bits in lo/band/hi order. */
+enum {
+    BETA99_COL_CLOCK,
+    BETA99_COL_GATE1, BETA99_COL_SYNC1, BETA99_COL_RING1, BETA99_COL_TEST1,
+    BETA99_COL_TRI1, BETA99_COL_SAW1, BETA99_COL_PULSE1, BETA99_COL_NOISE1,
+    BETA99_COL_FLTLO, BETA99_COL_FLTBAND, BETA99_COL_FLTHI,
+    BETA99_COL_FREQ1, BETA99_COL_PWDUTY1,
+    BETA99_COL_ATK1, BETA99_COL_DEC1, BETA99_COL_SUS1, BETA99_COL_REL1,
+    BETA99_COL_FREQ3, BETA99_COL_TEST3,
+    BETA99_COL_FLT1, BETA99_COL_FLTEXT, BETA99_COL_FLTCOFF, BETA99_COL_FLTRES,
+    BETA99_COL_VOL,
+    BETA99_COL_COUNT
+};
+
+extern const char *const beta99_ssf_columns[BETA99_COL_COUNT];
+
+/* One SSF row; clock is relative to the start of the fragment. */
+typedef struct {
+    int64_t hashid;
+    uint32_t present;           /* bit per BETA99_COL_*; clear = empty cell (NaN) */
+    int64_t v[BETA99_COL_COUNT];
+} beta99_ssf_row_t;
+
+/* Return non-zero to stop reading (beta99_ssf_read() then fails). */
+typedef int (*beta99_ssf_row_fn)(void *user, const beta99_ssf_row_t *row);
+
+/*
+ * Stream the rows of an SSF table (CSV, zstd CSV or ssf2col .ssfc; NULL =
+ * stdin) to fn in file order, decoded as the packer reads them. With
+ * only_hashid, other hashids are skipped (an .ssfc index is used to visit
+ * just those rows). Returns 0, or -1 after printing the reason.
+ */
+int beta99_ssf_read(const char *path, const int64_t *only_hashid,
+                    beta99_ssf_row_fn fn, void *user);
+
+typedef struct {
+    size_t ssf_rows;
+    size_t log_rows;
+    size_t ssf_count;       /* SSF entries in the bundle (after chunking) */
+    size_t trigger_count;
+    size_t bytes;           /* bundle size */
+} beta99_pack_stats_t;
+
+typedef struct {
+    size_t added;           /* SSFs new to the dictionary */
+    size_t reused;          /* SSFs already in it */
+    size_t bytes_saved;     /* record bytes not stored again */
+    size_t bytes;           /* B99R bundle size */
+} beta99_ref_stats_t;
+
+/*
+ * Pack ssf_path + log_path into out_path, splitting fragments longer than
+ * max_ops operations. Returns 0, or -1 after printing the reason (prefixed
+ * with the input name) to stderr. stats may be NULL.
+ */
+int beta99_pack_files(const char *ssf_path, const char *log_path,
+                      const char *out_path, unsigned max_ops,
+                      beta99_pack_stats_t *stats);
+
+/* The same in two steps: pack into memory (NULL on error), then write. */
+beta99_bundle_t *beta99_pack(const char *ssf_path, const char *log_path,
+                             unsigned max_ops, beta99_pack_stats_t *stats);
+int beta99_bundle_write(const beta99_bundle_t *b, const char *out_path);
+void beta99_bundle_free(beta99_bundle_t *b);
+
+/*
+ * In-memory input: add the rows of every SSF once (they are grouped and
+ * clock-sorted as for the CSV) and a trigger per use, with the absolute
+ * clock and voice 1-3 of the log, then pack it once. name prefixes error
+ * messages.
+ */
+beta99_input_t *beta99_input_new(const char *name);
+int beta99_input_add_row(beta99_input_t *in, const beta99_ssf_row_t *row);
+int beta99_input_add_trigger(beta99_input_t *in, int64_t clock, int64_t hashid, int voice);
+beta99_bundle_t *beta99_pack_input(beta99_input_t *in, unsigned max_ops,
+                                   beta99_pack_stats_t *stats);
+void beta99_input_free(beta99_input_t *in);
+
+/* Load a dictionary, or start an empty one when path does not exist. */
+beta99_dict_t *beta99_dict_load(const char *path);
+int beta99_dict_save(const beta99_dict_t *dict, const char *path);
+size_t beta99_dict_count(const beta99_dict_t *dict);
+void beta99_dict_free(beta99_dict_t *dict);
+
+/* Add the bundle's SSFs to dict (existing entries are shared) and write
+ * it as a B99R bundle referencing them. */
+int beta99_bundle_write_ref(const beta99_bundle_t *b, beta99_dict_t *dict,
+                            const char *out_path, beta99_ref_stats_t *stats);
+
+#endif /* BETA99_PACKER_H */
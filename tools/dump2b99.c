@@ -0,0 +1,162 @@
+/*
+ * dump2b99 - build beta99 (B99F) bundles straight from VICE SID dumps.
+ *
+ * One native pass replaces vsid dump -> reg2ssf -> CSV -> beta99_pack:
+ *
+ *   vsid -sounddev dump -soundarg tune.sid.dump -warp -limit 300000000 tune.sid
+ *   dump2b99 tune.sid.dump            # writes tune.b99
+ *
+ * Each DUMP argument writes DUMP.b99 with a trailing .sid.dump or .dump
+ * replaced (or DIR/<name>.b99 with -o); --out names the bundle of a single
+ * dump, which may be "-" for stdin. Fragments are cut per voice at every
+ * rising gate bit (beta99_cutter.h), so the bundle differs from a
+ * desidulate one, but it plays the same register writes.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "beta99_cutter.h"
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [options] <tune.sid.dump>...\n"
+        "       %s [options] --out <tune.b99> <tune.sid.dump|->\n"
+        "Options:\n"
+        "  --max-ops <n>  Split fragments longer than n ops (default %d)\n"
+        "  --quantum <n>  Cycles fragment clocks are rounded to when comparing them\n"
+        "                 (default %d, one PAL frame; 1 = exact)\n"
+        "  -o <dir>       Output directory for <tune>.b99 (created if missing)\n"
+        "  -q             Only report errors\n",
+        prog, prog, BETA99_DEFAULT_MAX_OPS, BETA99_DUMP_CLOCK_QUANTUM);
+}
+
+static double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void strip_suffix(char *s, const char *suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    if (n > m && strcmp(s + n - m, suffix) == 0) s[n - m] = '\0';
+}
+
+static int out_path_for(char *out, size_t len, const char *dump, const char *out_dir) {
+    char stem[PATH_MAX];
+    snprintf(stem, sizeof stem, "%s", dump);
+    strip_suffix(stem, ".sid.dump");
+    strip_suffix(stem, ".dump");
+    const char *base = strrchr(stem, '/');
+    base = base ? base + 1 : stem;
+    int n = out_dir ? snprintf(out, len, "%s/%s.b99", out_dir, base)
+                    : snprintf(out, len, "%s.b99", stem);
+    if (n < 0 || (size_t)n >= len) {
+        fprintf(stderr, "dump2b99: path too long: %s\n", dump);
+        return -1;
+    }
+    return 0;
+}
+
+static int convert(const char *dump, const char *out, unsigned quantum, unsigned max_ops,
+                   int quiet) {
+    double t0 = monotonic_seconds();
+    beta99_pack_stats_t stats;
+    beta99_cutter_stats_t cut;
+    beta99_bundle_t *b = beta99_cut_dump(strcmp(dump, "-") == 0 ? NULL : dump,
+                                         quantum, max_ops, &stats, &cut);
+    int rc = (b && beta99_bundle_write(b, out) == 0) ? 0 : -1;
+    beta99_bundle_free(b);
+    if (rc != 0) {
+        fprintf(stderr, "dump2b99: failed to convert %s\n", dump);
+        return -1;
+    }
+    if (!quiet) {
+        printf("beta99 bundle written to %s | SSFs: %zu (%zu fragments, %zu unique) | "
+               "Triggers: %zu | %zu bytes in %.2fs\n",
+               out, stats.ssf_count, cut.fragments, cut.unique, stats.trigger_count,
+               stats.bytes, monotonic_seconds() - t0);
+    }
+    /* Not silenced by -q: the bundle does not play the dump back exactly. */
+    if (cut.retimed) {
+        fprintf(stderr, "dump2b99: %s: %zu triggers replay a fragment with different "
+                "timing (--quantum 1 keeps every timing)\n", dump, cut.retimed);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *out_path = NULL, *out_dir = NULL;
+    long max_ops = BETA99_DEFAULT_MAX_OPS;
+    long quantum = BETA99_DUMP_CLOCK_QUANTUM;
+    int quiet = 0;
+
+    static const struct option long_opts[] = {
+        { "out", required_argument, NULL, 'O' },
+        { "max-ops", required_argument, NULL, 'm' },
+        { "quantum", required_argument, NULL, 'Q' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "o:qh", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'O': out_path = optarg; break;
+        case 'm':
+            max_ops = strtol(optarg, NULL, 10);
+            if (max_ops < 1) max_ops = 1;
+            break;
+        case 'Q':
+            quantum = strtol(optarg, NULL, 10);
+            if (quantum < 1) {
+                fprintf(stderr, "dump2b99: invalid quantum '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'o': out_dir = optarg; break;
+        case 'q': quiet = 1; break;
+        case 'h': usage(argv[0]); return 0;
+        default: usage(argv[0]); return 1;
+        }
+    }
+
+    int count = argc - optind;
+    if (count == 0 || (out_path && (count != 1 || out_dir))) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (out_path) {
+        return convert(argv[optind], out_path, (unsigned)quantum, (unsigned)max_ops, quiet) == 0 ? 0 : 1;
+    }
+
+    if (out_dir && mkdir(out_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "dump2b99: mkdir %s: %s\n", out_dir, strerror(errno));
+        return 1;
+    }
+
+    int failed = 0;
+    for (int i = optind; i < argc; ++i) {
+        char out[PATH_MAX];
+        if (strcmp(argv[i], "-") == 0) {
+            fprintf(stderr, "dump2b99: stdin needs --out\n");
+            failed++;
+            continue;
+        }
+        if (out_path_for(out, sizeof out, argv[i], out_dir) != 0 ||
+            convert(argv[i], out, (unsigned)quantum, (unsigned)max_ops, quiet) != 0) {
+            failed++;
+        }
+    }
+    return failed ? 1 : 0;
+}
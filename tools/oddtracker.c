@@ -1,279 +1,71 @@
 // tracker.c
+// Plays through the picoSid-synth sid_engine (reSID) built for the host:
+// the tracker engine turns rows and tables into SID register writes,
+// rendered in blocks between ticks inside the SDL audio callback.
+// --export <stem> compiles the song to <stem>.bin and <stem>.b99 for the
+// device instead (tracker_export.h).
 #include <SDL2/SDL.h>
 #include <math.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
-typedef int8_t Note; // -1 = none, 0..95 = semitone
+#include "sid_engine.h"
+#include "tracker_engine.h"
+#include "tracker_export.h"
 
-typedef struct {
-    Note    note;
-    uint8_t instr;
-    uint8_t effect;
-    uint8_t effectParam;
-} Cell;
-
-#define NUM_CHANNELS 3
-#define PATTERN_ROWS 64
-
-typedef struct {
-    Cell row[PATTERN_ROWS][NUM_CHANNELS];
-} Pattern;
-
-typedef struct {
-    uint8_t waveform;   // 0=pulse,1=saw,2=tri,3=noise
-    int8_t  transpose;  // semitones
-    uint8_t length;     // ticks
-} WaveStep;
-
-#define WAVETABLE_STEPS 32
-
-typedef struct {
-    WaveStep steps[WAVETABLE_STEPS];
-    uint8_t  length;
-} WaveTable;
-
-typedef struct {
-    uint8_t cutoff;     // 0..255
-    uint8_t resonance;  // 0..255
-    uint8_t length;     // ticks
-} FilterStep;
+// ===================== PLAYER STATE =====================
 
-#define FILTERTABLE_STEPS 32
+#define SID_CHIPS 0x3   // both engine SIDs (6581 left, 8580 right)
 
 typedef struct {
-    FilterStep steps[FILTERTABLE_STEPS];
-    uint8_t    length;
-} FilterTable;
-
-typedef struct {
-    char     name[16];
-    uint8_t  waveTableIndex;
-    uint8_t  filterTableIndex;
-    uint8_t  attack, decay, sustain, release;
-    uint8_t  volume; // 0..64
-} Instrument;
-
-#define MAX_INSTRUMENTS 16
-#define MAX_PATTERNS    16
-#define MAX_ORDERS      64
-
-typedef struct {
-    uint8_t numPatterns;
-    uint8_t numOrders;
-    uint8_t orderList[MAX_ORDERS];
-
-    uint8_t  speed; // ticks per row
-    uint16_t bpm;
-
-    Instrument  instruments[MAX_INSTRUMENTS];
-    uint8_t     numInstruments;
-
-    WaveTable   waveTables[8];
-    FilterTable filterTables[8];
-
-    Pattern     patterns[MAX_PATTERNS];
-} Song;
-
-// ===================== ENGINE STATE =====================
+    EngineState engine;
 
-typedef struct {
     // timing
     double   samplesPerTick;
     double   tickSampleCounter;
-    uint8_t  tick;        // 0..speed-1
-    uint8_t  row;         // 0..PATTERN_ROWS-1
-    uint8_t  order;       // 0..numOrders-1
-
-    // per-channel runtime state
-    struct {
-        Note    note;
-        float   phase;
-        float   freq;
-        uint8_t instrIndex;
-
-        // wave/filter table state
-        uint8_t wavePos;
-        uint8_t waveTickLeft;
-
-        uint8_t filtPos;
-        uint8_t filtTickLeft;
-
-        float   volume; // 0..1
-    } ch[NUM_CHANNELS];
-
-    Song *song;
-    int   songEnd;
-} EngineState;
-
-static EngineState g_engine;
-
-// ============ HELPER: note->frequency =================
-
-static float note_to_freq(Note n) {
-    if (n < 0) return 0.0f;
-    // Let note 60 = C-5 ~ 523.25 Hz for convenience
-    const float base = 523.25f;
-    int delta = (int)n - 60;
-    return base * powf(2.0f, delta / 12.0f);
-}
-
-// ============ ADVANCE WAVE/FILTER TABLES ===============
-
-static void advance_wave_table(EngineState *e, int chIndex) {
-    Song *s = e->song;
-    auto *ch = &e->ch[chIndex];
-    if (ch->instrIndex == 0xFF) return;
-
-    Instrument *inst = &s->instruments[ch->instrIndex];
-    if (inst->waveTableIndex >= 8) return;
-
-    WaveTable *wt = &s->waveTables[inst->waveTableIndex];
-    if (wt->length == 0) return;
-
-    if (ch->waveTickLeft == 0) {
-        ch->wavePos = (ch->wavePos + 1) % wt->length;
-        ch->waveTickLeft = wt->steps[ch->wavePos].length;
-    } else {
-        ch->waveTickLeft--;
-    }
-
-    WaveStep *step = &wt->steps[ch->wavePos];
-    Note n = ch->note;
-    if (n >= 0) n += step->transpose;
-    ch->freq = note_to_freq(n);
-    // waveform selection is ignored in this minimal example
-}
-
-static void advance_filter_table(EngineState *e, int chIndex) {
-    Song *s = e->song;
-    auto *ch = &e->ch[chIndex];
-    if (ch->instrIndex == 0xFF) return;
-
-    Instrument *inst = &s->instruments[ch->instrIndex];
-    if (inst->filterTableIndex >= 8) return;
-
-    FilterTable *ft = &s->filterTables[inst->filterTableIndex];
-    if (ft->length == 0) return;
 
-    if (ch->filtTickLeft == 0) {
-        ch->filtPos = (ch->filtPos + 1) % ft->length;
-        ch->filtTickLeft = ft->steps[ch->filtPos].length;
-    } else {
-        ch->filtTickLeft--;
-    }
-
-    // For now we ignore cutoff/resonance in the synth;
-    // they can later modulate a simple low-pass filter.
-}
+    // audio callback load
+    Uint64 renderTicks;
+    Uint64 renderFrames;
+} PlayerState;
 
-// ============ PROCESS ROW ==============================
+static PlayerState g_player;
 
-static void process_row(EngineState *e) {
-    Song *s = e->song;
-    if (e->order >= s->numOrders) {
-        e->songEnd = 1;
-        return;
-    }
-
-    uint8_t patIndex = s->orderList[e->order];
-    if (patIndex >= s->numPatterns) {
-        e->songEnd = 1;
-        return;
-    }
-
-    Pattern *pat = &s->patterns[patIndex];
-
-    for (int chIndex = 0; chIndex < NUM_CHANNELS; ++chIndex) {
-        Cell *cell = &pat->row[e->row][chIndex];
-        if (cell->note >= 0 && cell->note <= 95 && cell->instr > 0) {
-            // Note on
-            auto *ch = &e->ch[chIndex];
-            ch->note       = cell->note;
-            ch->instrIndex = cell->instr - 1;
-            ch->wavePos    = 0;
-            ch->waveTickLeft = 0;
-            ch->filtPos    = 0;
-            ch->filtTickLeft = 0;
-
-            Instrument *inst = &s->instruments[ch->instrIndex];
-            ch->freq   = note_to_freq(ch->note);
-            ch->volume = inst->volume / 64.0f;
-        }
-
-        // Effects can go here (arpeggio, slide, etc.) based on cell->effect
-    }
-}
-
-// ============ ADVANCE TICK =============================
-
-static void advance_tick(EngineState *e) {
-    Song *s = e->song;
-
-    if (e->tick == 0) {
-        process_row(e);
-    }
-
-    // Advance per-channel tables every tick
-    for (int i = 0; i < NUM_CHANNELS; ++i) {
-        advance_wave_table(e, i);
-        advance_filter_table(e, i);
-    }
-
-    // Next tick
-    e->tick++;
-    if (e->tick >= s->speed) {
-        e->tick = 0;
-        e->row++;
-        if (e->row >= PATTERN_ROWS) {
-            e->row = 0;
-            e->order++;
-            if (e->order >= s->numOrders) {
-                e->songEnd = 1;
-            }
-        }
-    }
+// Applied at once: the callback renders up to each tick, then ticks.
+static void queue_write(void *user, int chIndex, uint8_t addr, uint8_t value) {
+    (void)user; (void)chIndex;
+    sid_engine_queue_event(SID_CHIPS, addr, value, 0);
 }
 
 // ============ AUDIO CALLBACK ===========================
 
 static void audio_callback(void *userdata, Uint8 *stream, int len) {
-    EngineState *e = (EngineState *)userdata;
+    PlayerState *p = (PlayerState *)userdata;
+    EngineState *e = &p->engine;
     int16_t *out = (int16_t *)stream;
     int frames = len / (2 * sizeof(int16_t)); // stereo 16-bit
+    Uint64 t0 = SDL_GetPerformanceCounter();
 
-    for (int i = 0; i < frames; ++i) {
+    p->renderFrames += (Uint64)frames;
+    while (frames > 0) {
+        int run = frames;
         if (!e->songEnd) {
-            e->tickSampleCounter += 1.0;
-            if (e->tickSampleCounter >= e->samplesPerTick) {
-                e->tickSampleCounter -= e->samplesPerTick;
-                advance_tick(e);
+            if (p->tickSampleCounter >= p->samplesPerTick) {
+                p->tickSampleCounter -= p->samplesPerTick;
+                engine_tick(e);
             }
+            // Render up to the next tick in one block
+            int untilTick = (int)ceil(p->samplesPerTick - p->tickSampleCounter);
+            if (untilTick < 1) untilTick = 1;
+            if (untilTick < run) run = untilTick;
+            p->tickSampleCounter += run;
         }
-
-        float mix = 0.0f;
-        for (int chIndex = 0; chIndex < NUM_CHANNELS; ++chIndex) {
-            auto *ch = &e->ch[chIndex];
-            if (ch->freq > 0.0f && ch->volume > 0.0f) {
-                float phaseInc = ch->freq / 44100.0f;
-                ch->phase += phaseInc;
-                if (ch->phase >= 1.0f) ch->phase -= 1.0f;
-
-                // simple pulse wave 50%
-                float sample = (ch->phase < 0.5f ? 1.0f : -1.0f) * ch->volume;
-                mix += sample;
-            }
-        }
-
-        // soft clip
-        if (mix > 1.0f) mix = 1.0f;
-        if (mix < -1.0f) mix = -1.0f;
-
-        int16_t s = (int16_t)(mix * 30000.0f);
-        out[2 * i + 0] = s;
-        out[2 * i + 1] = s;
+        sid_engine_render_block(out, (size_t)run);
+        out += 2 * run;
+        frames -= run;
     }
+    p->renderTicks += SDL_GetPerformanceCounter() - t0;
 }
 
 // ============ TEST SONG SETUP ==========================
@@ -284,6 +76,7 @@ static void build_test_song(Song *s) {
     s->numPatterns = 1;
     s->numOrders   = 1;
     s->orderList[0] = 0;
+    s->patternRows = PATTERN_ROWS;
     s->speed = 6;
     s->bpm   = 125;
 
@@ -345,32 +138,47 @@ static void build_test_song(Song *s) {
 
 // ============ MAIN =====================================
 
+// --export <stem>: write <stem>.bin and <stem>.b99 instead of playing.
+static int export_song(const Song *song, const char *stem) {
+    char binPath[1024], b99Path[1024];
+    snprintf(binPath, sizeof binPath, "%s.bin", stem);
+    snprintf(b99Path, sizeof b99Path, "%s.b99", stem);
+
+    TrackerExportStats st;
+    if (tracker_export(song, binPath, b99Path, &st) != 0) return 1;
+    double songSec = (double)st.cycles / SID_CLOCK_HZ;
+    printf("Exported %s (%llu events) and %s (%zu fragments, %zu unique, %zu bytes)\n",
+           binPath, (unsigned long long)st.events, b99Path, st.fragments,
+           st.uniqueFragments, st.bundleBytes);
+    printf("%llu ticks, %.1f s of music in %.2f ms (%.0fx real time)\n",
+           (unsigned long long)st.ticks, songSec, st.seconds * 1000.0,
+           st.seconds > 0 ? songSec / st.seconds : 0.0);
+    return 0;
+}
+
 int main(int argc, char **argv) {
-    (void)argc; (void)argv;
+    Song song;
+    build_test_song(&song);
+
+    if (argc == 3 && strcmp(argv[1], "--export") == 0) {
+        return export_song(&song, argv[2]);
+    }
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s [--export <stem>]\n", argv[0]);
+        return 1;
+    }
 
     if (SDL_Init(SDL_INIT_AUDIO | SDL_INIT_TIMER) != 0) {
         fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
         return 1;
     }
 
-    Song song;
-    build_test_song(&song);
-
-    EngineState *e = &g_engine;
-    memset(e, 0, sizeof(*e));
-    e->song = &song;
+    PlayerState *p = &g_player;
+    EngineState *e = &p->engine;
+    memset(p, 0, sizeof(*p));
 
-    // Timing: classic tracker tick length = (2.5 * speed) / bpm seconds
-    double tickLenSec = (2.5 * song.speed) / (double)song.bpm; // ProTracker-ish formula
+    double tickLenSec = engine_tick_seconds(&song);
     double sampleRate = 44100.0;
-    e->samplesPerTick = tickLenSec * sampleRate;
-
-    for (int i = 0; i < NUM_CHANNELS; ++i) {
-        e->ch[i].note       = -1;
-        e->ch[i].instrIndex = 0xFF;
-        e->ch[i].phase      = 0.0f;
-        e->ch[i].volume     = 0.0f;
-    }
 
     SDL_AudioSpec want, have;
     SDL_zero(want);
@@ -379,13 +187,18 @@ int main(int argc, char **argv) {
     want.channels = 2;
     want.samples = 512;
     want.callback = audio_callback;
-    want.userdata = e;
+    want.userdata = p;
 
     if (SDL_OpenAudio(&want, &have) < 0) {
         fprintf(stderr, "SDL_OpenAudio failed: %s\n", SDL_GetError());
         SDL_Quit();
         return 1;
     }
+    p->samplesPerTick = tickLenSec * have.freq;
+
+    sid_engine_init((uint32_t)have.freq);
+    sid_engine_set_filter_enabled(true);
+    engine_init(e, &song, queue_write, NULL, p);
 
     SDL_PauseAudio(0);
     printf("Playing test song... press Ctrl+C to quit.\n");
@@ -396,6 +209,11 @@ int main(int argc, char **argv) {
     }
 
     SDL_CloseAudio();
+    if (p->renderFrames) {
+        double renderSec = (double)p->renderTicks / (double)SDL_GetPerformanceFrequency();
+        double audioSec = (double)p->renderFrames / have.freq;
+        printf("Audio callback load: %.1f%% of real time\n", 100.0 * renderSec / audioSec);
+    }
     SDL_Quit();
     return 0;
 }
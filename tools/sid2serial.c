@@ -1,5 +1,7 @@
 #define _POSIX_C_SOURCE 200809L
 #define _DARWIN_C_SOURCE 1
+#define _DEFAULT_SOURCE 1
+#define _XOPEN_SOURCE 700
 
 #include <errno.h>
 #include <fcntl.h>
@@ -20,6 +22,9 @@
 #include <termios.h>
 #include <unistd.h>
 
+#include "beta99_cutter.h"
+#include "beta99_packer.h"
+
 #ifndef DEFAULT_VSID_PATH
 #define DEFAULT_VSID_PATH "tools/vice-3.9/src/vsid"
 #endif
@@ -368,7 +373,7 @@ static int send_frame(int serial_fd, const uint8_t *frame_buf, size_t frame_len)
 static int run_command(char *const argv[])
 {
   pid_t pid;
-  int rc = posix_spawn(&pid, argv[0], NULL, NULL, argv, environ);
+  int rc = posix_spawnp(&pid, argv[0], NULL, NULL, argv, environ);
   if (rc != 0) {
     fprintf(stderr, "sid2serial: failed to spawn %s: %s\n",
             argv[0], strerror(rc));
@@ -515,6 +520,72 @@ static int copy_file(const char *src, const char *dst)
   return (n < 0) ? -1 : 0;
 }
 
+static bool has_suffix(const char *s, const char *suffix)
+{
+  size_t n = strlen(s), m = strlen(suffix);
+  return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+/* reg2ssf names its outputs after the dump: <root>.ssf.zst/.log.zst next
+ * to it (older desidulate keeps the .dump in the name). */
+static int find_reg2ssf_output(const char *workdir, const char *root_name,
+                               const char *dump_path, const char *ext,
+                               char *out, size_t out_len)
+{
+  struct stat st;
+  snprintf(out, out_len, "%s/%s.%s.zst", workdir, root_name, ext);
+  if (stat(out, &st) == 0) return 0;
+  snprintf(out, out_len, "%s.%s.zst", dump_path, ext);
+  if (stat(out, &st) == 0) return 0;
+  fprintf(stderr, "sid2serial: reg2ssf produced no %s/%s.%s.zst\n",
+          workdir, root_name, ext);
+  return -1;
+}
+
+/* -Z <file>.b99: the dump is cut into fragments natively (dump2b99); with
+ * -R it goes through reg2ssf and the packer instead. */
+static int export_beta99(const char *reg2ssf_path, const char *workdir,
+                         const char *root_name, const char *dump_path,
+                         const char *out_path)
+{
+  beta99_pack_stats_t stats;
+  if (!reg2ssf_path) {
+    beta99_cutter_stats_t cut;
+    beta99_bundle_t *b = beta99_cut_dump(dump_path, BETA99_DUMP_CLOCK_QUANTUM,
+                                         BETA99_DEFAULT_MAX_OPS, &stats, &cut);
+    int rc = (b && beta99_bundle_write(b, out_path) == 0) ? 0 : -1;
+    beta99_bundle_free(b);
+    if (rc != 0) {
+      return -1;
+    }
+    fprintf(stderr, "[beta99] exported %s | SSFs: %zu (%zu unique fragments) | Triggers: %zu "
+            "(%zu retimed)\n",
+            out_path, stats.ssf_count, cut.unique, stats.trigger_count, cut.retimed);
+    return 0;
+  }
+
+  char *argv[] = { (char *)reg2ssf_path, (char *)dump_path, NULL };
+  fprintf(stderr, "[beta99] %s %s\n", reg2ssf_path, dump_path);
+  if (run_command(argv) != 0) {
+    return -1;
+  }
+  char ssf_path[PATH_MAX];
+  char log_path[PATH_MAX];
+  if (find_reg2ssf_output(workdir, root_name, dump_path, "ssf",
+                          ssf_path, sizeof ssf_path) != 0 ||
+      find_reg2ssf_output(workdir, root_name, dump_path, "log",
+                          log_path, sizeof log_path) != 0) {
+    return -1;
+  }
+  if (beta99_pack_files(ssf_path, log_path, out_path,
+                        BETA99_DEFAULT_MAX_OPS, &stats) != 0) {
+    return -1;
+  }
+  fprintf(stderr, "[beta99] exported %s | SSFs: %zu | Triggers: %zu\n",
+          out_path, stats.ssf_count, stats.trigger_count);
+  return 0;
+}
+
 static int open_serial_device(const char *path, long baud)
 {
   int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
@@ -692,7 +763,8 @@ static void usage(const char *prog)
 {
   fprintf(stderr,
           "Usage: %s -i <file.sid> [-f <serial>] [-b <baud>] [-n <tune>]\n"
-          "           [-V <vsid>] [-Z <export.bin>] [-l <limit_ms>]\n"
+          "           [-V <vsid>] [-Z <export.bin|bundle.b99>] [-R <reg2ssf>]\n"
+          "           [-l <limit_ms>]\n"
           "During playback: 1/2/3/4 toggle V1/V2/V3/Global filters.\n",
           prog ? prog : "sid2serial");
 }
@@ -703,6 +775,7 @@ int main(int argc, char **argv)
   char serial_dev[PATH_MAX] = {0};
   char vsid_path[PATH_MAX];
   char export_path[PATH_MAX] = {0};
+  const char *reg2ssf_path = NULL;
   char limit_arg[32] = {0};
   char tune_buf[16] = {0};
   long baud = 2000000;
@@ -710,7 +783,7 @@ int main(int argc, char **argv)
 
   strncpy(vsid_path, DEFAULT_VSID_PATH, sizeof vsid_path - 1);
 
-  while ((opt = getopt(argc, argv, "i:f:b:n:V:Z:l:h")) != -1) {
+  while ((opt = getopt(argc, argv, "i:f:b:n:V:Z:R:l:h")) != -1) {
     switch (opt) {
       case 'i':
         sid_file = optarg;
@@ -738,6 +811,9 @@ int main(int argc, char **argv)
         strncpy(export_path, optarg, sizeof export_path - 1);
         export_path[sizeof export_path - 1] = '\0';
         break;
+      case 'R':
+        reg2ssf_path = optarg;
+        break;
       case 'l':
         strncpy(limit_arg, optarg, sizeof limit_arg - 1);
         limit_arg[sizeof limit_arg - 1] = '\0';
@@ -800,7 +876,13 @@ int main(int argc, char **argv)
     goto cleanup;
   }
 
-  if (export_path[0]) {
+  if (export_path[0] && has_suffix(export_path, ".b99")) {
+    if (export_beta99(reg2ssf_path, workdir, root_name, dump_path,
+                      export_path) != 0) {
+      fprintf(stderr, "sid2serial: failed to export %s\n", export_path);
+      goto cleanup;
+    }
+  } else if (export_path[0]) {
     if (copy_file(bin_path, export_path) != 0) {
       fprintf(stderr, "sid2serial: failed to export %s\n", export_path);
       goto cleanup;
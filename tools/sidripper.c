@@ -1,15 +1,22 @@
 // tools/ssf2rip.c
 // Simple "instrument ripper" for desidulate SSF files.
-// Reads CSV from stdin (typically via: zstdcat song.ssf.zst | ssf2rip ...)
-// If -hashid is given, prints a Sid Wizard–style header (multispeed + ADSR)
-// and a per-frame parameter table for that SSF.
-// If -hashid is omitted, just lists all unique hashids and their counts.
+// Reads CSV from the given files (-i or trailing arguments, any number) or
+// stdin, plain or .zst (decompressed in-process when built with
+// -DSSF_HAVE_ZSTD -lzstd), or columnar .ssfc tables from ssf2col (mapped,
+// no parsing; -hashid then reads only the target rows via the index).
+// If -hashid is given (repeatable), prints a Sid Wizard–style header
+// (multispeed + ADSR) and a per-frame parameter table for each SSF, taken
+// from the first file that contains it.
+// If -hashid is omitted, just lists all unique hashids and their counts
+// (plus the number of files each appears in when ripping a corpus).
+// Throughput is reported on stderr.
 //
 // Compile:
-//   clang -Wall -Wextra -O2 -o tools/ssf2rip tools/ssf2rip.c
+//   clang -Wall -Wextra -O2 -DSSF_HAVE_ZSTD -o tools/ssf2rip tools/ssf2rip.c tools/ssfcol.c -lzstd
 //
 // Example:
-//   zstdcat Bromance-Intro.ssf.zst | tools/ssf2rip
+//   tools/ssf2rip -i Bromance-Intro.ssf.zst
+//   tools/ssf2rip *.ssf.zst
 //   zstdcat Bromance-Intro.ssf.zst | tools/ssf2rip -hashid -8316251235258051595
 
 #define _POSIX_C_SOURCE 200809L
@@ -21,16 +28,37 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#include "ssf_reader.h"
+#include "ssfcol.h"
 
-#define MAX_LINE   8192
 #define MAX_FIELDS 64
-#define MAX_HASHIDS 4096
 
 typedef struct {
     long long hashid;
     unsigned long count;
+    unsigned long files;      // number of inputs containing it
+    int last_file;
+    // Parameter-table extraction (-hashid) state
+    bool target;
+    int source_file;          // file the table is taken from, -1 = not seen
+    unsigned int frame_index;
+    FILE *table;              // memstream holding the formatted table
+    char *table_buf;
+    size_t table_len;
 } hashid_entry_t;
 
+// Open-addressing map (linear probing, power-of-two table) from hashid
+// to an entry. Entries keep first-seen order; slots hold index + 1.
+typedef struct {
+    hashid_entry_t *entries;
+    size_t count;
+    size_t cap;
+    uint32_t *slots;
+    size_t slot_mask;
+} hashid_map_t;
+
 typedef struct {
     int idx_hashid;
     int idx_clock;
@@ -61,32 +89,98 @@ typedef struct {
 
 static void usage(const char *prog) {
     fprintf(stderr,
-        "Usage: %s [-hashid <id>]\n"
+        "Usage: %s [-hashid <id>]... [-i <file>]... [file...]\n"
         "\n"
         "Examples:\n"
-        "  zstdcat song.ssf.zst | %s\n"
+        "  %s -i song.ssf.zst\n"
+        "  %s corpus/*.ssf.zst\n"
         "  zstdcat song.ssf.zst | %s -hashid -8316251235258051595\n",
         prog ? prog : "ssf2rip",
         prog ? prog : "ssf2rip",
+        prog ? prog : "ssf2rip",
         prog ? prog : "ssf2rip");
 }
 
-static int split_csv(char *line, char **fields, int max_fields) {
-    int n = 0;
-    char *p = line;
-    while (*p && n < max_fields) {
-        fields[n++] = p;
-        char *comma = strchr(p, ',');
-        if (!comma) break;
-        *comma = '\0';
-        p = comma + 1;
+static uint64_t hashid_slot(long long hashid) {
+    uint64_t x = (uint64_t)hashid;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static int hashid_map_grow(hashid_map_t *map) {
+    size_t new_size = map->slots ? (map->slot_mask + 1) * 2 : 1024;
+    uint32_t *slots = calloc(new_size, sizeof *slots);
+    if (!slots) {
+        perror("ssf2rip: alloc hashid map");
+        return -1;
     }
-    return n;
+    for (size_t i = 0; i < map->count; ++i) {
+        size_t s = (size_t)hashid_slot(map->entries[i].hashid) & (new_size - 1);
+        while (slots[s]) s = (s + 1) & (new_size - 1);
+        slots[s] = (uint32_t)(i + 1);
+    }
+    free(map->slots);
+    map->slots = slots;
+    map->slot_mask = new_size - 1;
+    return 0;
+}
+
+static hashid_entry_t *hashid_map_find(const hashid_map_t *map, long long hashid) {
+    if (!map->slots) return NULL;
+    size_t s = (size_t)hashid_slot(hashid) & map->slot_mask;
+    while (map->slots[s]) {
+        hashid_entry_t *e = &map->entries[map->slots[s] - 1];
+        if (e->hashid == hashid) return e;
+        s = (s + 1) & map->slot_mask;
+    }
+    return NULL;
+}
+
+// Find or insert; NULL on allocation failure.
+static hashid_entry_t *hashid_map_get(hashid_map_t *map, long long hashid) {
+    if (!map->slots || (map->count + 1) * 4 > (map->slot_mask + 1) * 3) {
+        if (hashid_map_grow(map) != 0) return NULL;
+    }
+    size_t s = (size_t)hashid_slot(hashid) & map->slot_mask;
+    while (map->slots[s]) {
+        hashid_entry_t *e = &map->entries[map->slots[s] - 1];
+        if (e->hashid == hashid) return e;
+        s = (s + 1) & map->slot_mask;
+    }
+    if (map->count == map->cap) {
+        size_t new_cap = map->cap ? map->cap * 2 : 256;
+        hashid_entry_t *entries = realloc(map->entries, new_cap * sizeof *entries);
+        if (!entries) {
+            perror("ssf2rip: alloc hashid map");
+            return NULL;
+        }
+        map->entries = entries;
+        map->cap = new_cap;
+    }
+    hashid_entry_t *e = &map->entries[map->count++];
+    memset(e, 0, sizeof *e);
+    e->hashid = hashid;
+    e->last_file = -1;
+    e->source_file = -1;
+    map->slots[s] = (uint32_t)map->count;
+    return e;
+}
+
+static void hashid_map_free(hashid_map_t *map) {
+    for (size_t i = 0; i < map->count; ++i) {
+        if (map->entries[i].table) fclose(map->entries[i].table);
+        free(map->entries[i].table_buf);
+    }
+    free(map->entries);
+    free(map->slots);
+    memset(map, 0, sizeof *map);
 }
 
-static int parse_header(char *line, ssf_columns_t *cols) {
+static int parse_header(char *line, size_t len, ssf_columns_t *cols) {
     char *fields[MAX_FIELDS];
-    int n = split_csv(line, fields, MAX_FIELDS);
+    int n = ssf_split_csv(line, len, fields, MAX_FIELDS);
 
     // Initialize all indices to -1
     memset(cols, -1, sizeof(*cols));
@@ -151,64 +245,134 @@ static long long parse_hashid(const char *s, bool *ok) {
     return v;
 }
 
-int main(int argc, char **argv) {
-    const char *prog = (argc > 0 && argv[0]) ? argv[0] : "ssf2rip";
-    long long target_hashid = 0;
-    bool have_target = false;
+// First row of a target hashid: Sid Wizard-style header, ADSR from this row.
+static void print_table_header(FILE *out, long long hashid, char **fields, int n,
+                               const ssf_columns_t *cols) {
+    int adsr_atk = 0, adsr_dec = 0, adsr_sus = 0, adsr_rel = 0;
+    bool adsr_have = false;
 
-    for (int i = 1; i < argc; ++i) {
-        if (strcmp(argv[i], "-hashid") == 0) {
-            if (i + 1 >= argc) {
-                usage(prog);
-                return 1;
-            }
-            char *end = NULL;
-            errno = 0;
-            target_hashid = strtoll(argv[i + 1], &end, 10);
-            if (errno != 0 || !end || *end != '\0') {
-                fprintf(stderr, "ssf2rip: invalid hashid '%s'\n", argv[i + 1]);
-                return 1;
-            }
-            have_target = true;
-            ++i;
-        } else {
-            usage(prog);
-            return 1;
-        }
+    // Try to grab ADSR from this row
+    const char *a_s = get_field(fields, n, cols->idx_atk1);
+    const char *d_s = get_field(fields, n, cols->idx_dec1);
+    const char *s_s = get_field(fields, n, cols->idx_sus1);
+    const char *r_s = get_field(fields, n, cols->idx_rel1);
+
+    if (a_s && d_s && s_s && r_s &&
+        strcmp(a_s, "<NA>") != 0 &&
+        strcmp(d_s, "<NA>") != 0 &&
+        strcmp(s_s, "<NA>") != 0 &&
+        strcmp(r_s, "<NA>") != 0) {
+        adsr_atk = (int) strtol(a_s, NULL, 10);
+        adsr_dec = (int) strtol(d_s, NULL, 10);
+        adsr_sus = (int) strtol(s_s, NULL, 10);
+        adsr_rel = (int) strtol(r_s, NULL, 10);
+        adsr_have = true;
     }
 
-    char line_buf[MAX_LINE];
+    fprintf(out, "hashid: %lld\n", hashid);
+    fprintf(out, "multispeed: 1\n");
+    if (adsr_have) {
+        fprintf(out, "ADSR: %01X%01X%01X%01X\n",
+                adsr_atk & 0xF,
+                adsr_dec & 0xF,
+                adsr_sus & 0xF,
+                adsr_rel & 0xF);
+    } else {
+        fprintf(out, "ADSR: ????\n");
+    }
+    fprintf(out, "\n");
+    fprintf(out, "frame  clock   gate1  freq1  pwduty1  pulse noise  tri  saw  test sync ring  freq3 test3  flt1 fltcoff fltres fltlo fltband flthi  vol\n");
+    fprintf(out, "-----  ------  -----  -----  -------  ----- ----- ---- ---- ---- ---- ---- ----- ----- ---- ------- ------ ----- ------- ----- ----\n");
+}
+
+static void print_table_row(FILE *out, unsigned int frame_index, char **fields, int n,
+                            const ssf_columns_t *cols) {
+    const char *clock_s   = get_field(fields, n, cols->idx_clock);
+    const char *gate1_s   = get_field(fields, n, cols->idx_gate1);
+    const char *freq1_s   = get_field(fields, n, cols->idx_freq1);
+    const char *pwduty1_s = get_field(fields, n, cols->idx_pwduty1);
+    const char *pulse1_s  = get_field(fields, n, cols->idx_pulse1);
+    const char *noise1_s  = get_field(fields, n, cols->idx_noise1);
+    const char *tri1_s    = get_field(fields, n, cols->idx_tri1);
+    const char *saw1_s    = get_field(fields, n, cols->idx_saw1);
+    const char *test1_s   = get_field(fields, n, cols->idx_test1);
+    const char *sync1_s   = get_field(fields, n, cols->idx_sync1);
+    const char *ring1_s   = get_field(fields, n, cols->idx_ring1);
+    const char *freq3_s   = get_field(fields, n, cols->idx_freq3);
+    const char *test3_s   = get_field(fields, n, cols->idx_test3);
+    const char *flt1_s    = get_field(fields, n, cols->idx_flt1);
+    const char *fltcoff_s = get_field(fields, n, cols->idx_fltcoff);
+    const char *fltres_s  = get_field(fields, n, cols->idx_fltres);
+    const char *fltlo_s   = get_field(fields, n, cols->idx_fltlo);
+    const char *fltband_s = get_field(fields, n, cols->idx_fltband);
+    const char *flthi_s   = get_field(fields, n, cols->idx_flthi);
+    const char *vol_s     = get_field(fields, n, cols->idx_vol);
+
+    // Keep output texty, similar-ish to the ssf2swi "raw table".
+    fprintf(out, "%5u  %6s  %5s  %5s  %7s  %5s %5s %4s %4s %4s %4s %4s %5s %5s %4s %7s %6s %5s %7s %5s %4s\n",
+            frame_index,
+            clock_s,
+            gate1_s,
+            freq1_s,
+            pwduty1_s,
+            pulse1_s,
+            noise1_s,
+            tri1_s,
+            saw1_s,
+            test1_s,
+            sync1_s,
+            ring1_s,
+            freq3_s,
+            test3_s,
+            flt1_s,
+            fltcoff_s,
+            fltres_s,
+            fltlo_s,
+            fltband_s,
+            flthi_s,
+            vol_s);
+}
+
+typedef struct {
+    unsigned long long bytes;
+    unsigned long long rows;
+} rip_totals_t;
+
+// Rip one input. Without targets every hashid is counted; with targets
+// only their rows are formatted (into each entry's table stream).
+static int rip_file(const char *path, int file_index, hashid_map_t *map,
+                    bool have_target, rip_totals_t *totals) {
+    ssf_reader_t reader;
+    if (ssf_reader_open(&reader, path) != 0) {
+        ssf_reader_close(&reader);
+        return -1;
+    }
+    const char *name = path ? path : "stdin";
+    char *line_buf;
+    size_t line_len = 0;
 
     // Read header
-    if (!fgets(line_buf, sizeof line_buf, stdin)) {
-        fprintf(stderr, "ssf2rip: empty input\n");
-        return 1;
+    if (!(line_buf = ssf_reader_line(&reader, &line_len))) {
+        fprintf(stderr, "ssf2rip: %s: empty input\n", name);
+        ssf_reader_close(&reader);
+        return reader.error ? -1 : 0;
     }
-    // strip newline
-    line_buf[strcspn(line_buf, "\r\n")] = '\0';
+    totals->bytes += line_len + 1;
 
     ssf_columns_t cols;
-    if (parse_header(line_buf, &cols) != 0) {
-        return 1;
+    if (parse_header(line_buf, line_len, &cols) != 0) {
+        ssf_reader_close(&reader);
+        return -1;
     }
 
-    // If no target hashid: collect stats and print at end
-    hashid_entry_t hashids[MAX_HASHIDS];
-    int hashid_count = 0;
-
-    bool first_row_for_hash = true;
-    bool found_any = false;
-    unsigned int frame_index = 0;
-    int adsr_atk = 0, adsr_dec = 0, adsr_sus = 0, adsr_rel = 0;
-    bool adsr_have = false;
-
-    while (fgets(line_buf, sizeof line_buf, stdin)) {
-        line_buf[strcspn(line_buf, "\r\n")] = '\0';
+    while ((line_buf = ssf_reader_line(&reader, &line_len))) {
+        totals->bytes += line_len + 1;
         if (line_buf[0] == '\0') continue;
 
         char *fields[MAX_FIELDS];
-        int n = split_csv(line_buf, fields, MAX_FIELDS);
+        int n = ssf_split_csv(line_buf, line_len, fields, MAX_FIELDS);
         if (n <= 1) continue;
+        totals->rows++;
 
         const char *hashid_s = get_field(fields, n, cols.idx_hashid);
         bool ok = false;
@@ -217,139 +381,285 @@ int main(int argc, char **argv) {
 
         if (!have_target) {
             // collect stats
-            int idx = -1;
-            for (int i = 0; i < hashid_count; ++i) {
-                if (hashids[i].hashid == h) {
-                    idx = i;
-                    break;
-                }
+            hashid_entry_t *e = hashid_map_get(map, h);
+            if (!e) {
+                ssf_reader_close(&reader);
+                return -1;
             }
-            if (idx < 0) {
-                if (hashid_count >= MAX_HASHIDS) {
-                    fprintf(stderr,
-                            "ssf2rip: too many unique hashids (max %d)\n",
-                            MAX_HASHIDS);
-                    return 1;
-                }
-                idx = hashid_count++;
-                hashids[idx].hashid = h;
-                hashids[idx].count = 0;
+            e->count++;
+            if (e->last_file != file_index) {
+                e->last_file = file_index;
+                e->files++;
             }
-            hashids[idx].count++;
             continue;
         }
 
-        if (h != target_hashid) {
+        hashid_entry_t *e = hashid_map_find(map, h);
+        if (!e) {
+            continue;
+        }
+        // A table comes from one file; the same SSF elsewhere is a duplicate.
+        if (e->source_file < 0) {
+            e->source_file = file_index;
+            e->table = open_memstream(&e->table_buf, &e->table_len);
+            if (!e->table) {
+                perror("ssf2rip: open_memstream");
+                ssf_reader_close(&reader);
+                return -1;
+            }
+            print_table_header(e->table, h, fields, n, &cols);
+        } else if (e->source_file != file_index) {
             continue;
         }
+        print_table_row(e->table, e->frame_index++, fields, n, &cols);
+    }
+
+    int rc = reader.error ? -1 : 0;
+    ssf_reader_close(&reader);
+    return rc;
+}
+
+static bool is_ssfc_path(const char *path) {
+    uint8_t head[4];
+    FILE *fp = path ? fopen(path, "rb") : NULL;
+    if (!fp) return false;
+    size_t n = fread(head, 1, sizeof head, fp);
+    fclose(fp);
+    return ssfcol_is_ssfc(head, n);
+}
 
-        // First time we encounter this hashid: print header, ADSR etc.
-        if (first_row_for_hash) {
-            first_row_for_hash = false;
-            found_any = true;
-
-            // Try to grab ADSR from this row
-            const char *a_s = get_field(fields, n, cols.idx_atk1);
-            const char *d_s = get_field(fields, n, cols.idx_dec1);
-            const char *s_s = get_field(fields, n, cols.idx_sus1);
-            const char *r_s = get_field(fields, n, cols.idx_rel1);
-
-            if (a_s && d_s && s_s && r_s &&
-                strcmp(a_s, "<NA>") != 0 &&
-                strcmp(d_s, "<NA>") != 0 &&
-                strcmp(s_s, "<NA>") != 0 &&
-                strcmp(r_s, "<NA>") != 0) {
-                adsr_atk = (int) strtol(a_s, NULL, 10);
-                adsr_dec = (int) strtol(d_s, NULL, 10);
-                adsr_sus = (int) strtol(s_s, NULL, 10);
-                adsr_rel = (int) strtol(r_s, NULL, 10);
-                adsr_have = true;
+// One row of an ssfc table as the text cells of the equivalent CSV row.
+static int ssfc_row_fields(ssfcol_t *f, uint64_t row, char (*cells)[32], char **fields) {
+    int n = f->column_count < MAX_FIELDS ? (int)f->column_count : MAX_FIELDS;
+    for (int c = 0; c < n; ++c) {
+        const ssfcol_column_t *col = &f->columns[c];
+        fields[c] = cells[c];
+        if (!ssfcol_present(col, row)) {
+            cells[c][0] = '\0';
+        } else if (col->type == SSFCOL_F64) {
+            snprintf(cells[c], sizeof cells[c], "%g", ssfcol_f64(col, row));
+        } else {
+            snprintf(cells[c], sizeof cells[c], "%lld", (long long)ssfcol_i64(col, row));
+        }
+    }
+    return n;
+}
+
+static void ssfc_table_row(ssfcol_t *f, uint64_t row, hashid_entry_t *e, long long h,
+                           int file_index, const ssf_columns_t *cols) {
+    char cells[MAX_FIELDS][32];
+    char *fields[MAX_FIELDS];
+    int n = ssfc_row_fields(f, row, cells, fields);
+    if (e->source_file < 0) {
+        e->source_file = file_index;
+        print_table_header(e->table, h, fields, n, cols);
+    }
+    print_table_row(e->table, e->frame_index++, fields, n, cols);
+}
+
+// rip_file() for an ssfc table. Counting reads the hashid column alone;
+// targets come straight from the hashid index when the table has one.
+static int rip_ssfc(const char *path, int file_index, hashid_map_t *map,
+                    bool have_target, rip_totals_t *totals) {
+    ssfcol_t f;
+    if (ssfcol_open(&f, path) != 0) return -1;
+    totals->bytes += f.size;
+    totals->rows += f.row_count;
+
+    // Column indices as parse_header() sees them in the CSV header.
+    char header[MAX_FIELDS * (SSFCOL_NAME_MAX + 1)];
+    size_t len = 0;
+    for (uint32_t c = 0; c < f.column_count && c < MAX_FIELDS; ++c) {
+        len += (size_t)snprintf(header + len, sizeof header - len, "%s%s",
+                                c ? "," : "", f.columns[c].name);
+    }
+    ssf_columns_t cols;
+    int rc = parse_header(header, len, &cols);
+    for (uint32_t c = 0; rc == 0 && c < f.column_count && c < MAX_FIELDS; ++c) {
+        // Only the hashid column is needed to count
+        if (!have_target && (int)c != cols.idx_hashid) continue;
+        if (!ssfcol_column(&f, (int)c)) rc = -1;
+    }
+    const ssfcol_column_t *hc = rc == 0 ? &f.columns[cols.idx_hashid] : NULL;
+
+    if (rc == 0 && have_target && f.index_count) {
+        for (size_t i = 0; i < map->count; ++i) {
+            hashid_entry_t *e = &map->entries[i];
+            uint64_t first, count;
+            if (e->source_file >= 0 || !ssfcol_hashid_rows(&f, e->hashid, &first, &count)) {
+                continue;
+            }
+            e->table = open_memstream(&e->table_buf, &e->table_len);
+            if (!e->table) {
+                perror("ssf2rip: open_memstream");
+                rc = -1;
+                break;
             }
+            for (uint64_t r = first; r < first + count; ++r) {
+                ssfc_table_row(&f, r, e, e->hashid, file_index, &cols);
+            }
+        }
+        ssfcol_close(&f);
+        return rc;
+    }
 
-            printf("hashid: %lld\n", target_hashid);
-            printf("multispeed: 1\n");
-            if (adsr_have) {
-                printf("ADSR: %01X%01X%01X%01X\n",
-                       adsr_atk & 0xF,
-                       adsr_dec & 0xF,
-                       adsr_sus & 0xF,
-                       adsr_rel & 0xF);
-            } else {
-                printf("ADSR: ????\n");
+    for (uint64_t r = 0; rc == 0 && r < f.row_count; ++r) {
+        if (!ssfcol_present(hc, r)) continue;
+        long long h = (long long)ssfcol_i64(hc, r);
+        if (!have_target) {
+            hashid_entry_t *e = hashid_map_get(map, h);
+            if (!e) {
+                rc = -1;
+                break;
+            }
+            e->count++;
+            if (e->last_file != file_index) {
+                e->last_file = file_index;
+                e->files++;
+            }
+            continue;
+        }
+        hashid_entry_t *e = hashid_map_find(map, h);
+        if (!e || (e->source_file >= 0 && e->source_file != file_index)) continue;
+        if (!e->table) {
+            e->table = open_memstream(&e->table_buf, &e->table_len);
+            if (!e->table) {
+                perror("ssf2rip: open_memstream");
+                rc = -1;
+                break;
             }
-            printf("\n");
-            printf("frame  clock   gate1  freq1  pwduty1  pulse noise  tri  saw  test sync ring  freq3 test3  flt1 fltcoff fltres fltlo fltband flthi  vol\n");
-            printf("-----  ------  -----  -----  -------  ----- ----- ---- ---- ---- ---- ---- ----- ----- ---- ------- ------ ----- ------- ----- ----\n");
         }
+        ssfc_table_row(&f, r, e, h, file_index, &cols);
+    }
+    ssfcol_close(&f);
+    return rc;
+}
 
-        const char *clock_s   = get_field(fields, n, cols.idx_clock);
-        const char *gate1_s   = get_field(fields, n, cols.idx_gate1);
-        const char *freq1_s   = get_field(fields, n, cols.idx_freq1);
-        const char *pwduty1_s = get_field(fields, n, cols.idx_pwduty1);
-        const char *pulse1_s  = get_field(fields, n, cols.idx_pulse1);
-        const char *noise1_s  = get_field(fields, n, cols.idx_noise1);
-        const char *tri1_s    = get_field(fields, n, cols.idx_tri1);
-        const char *saw1_s    = get_field(fields, n, cols.idx_saw1);
-        const char *test1_s   = get_field(fields, n, cols.idx_test1);
-        const char *sync1_s   = get_field(fields, n, cols.idx_sync1);
-        const char *ring1_s   = get_field(fields, n, cols.idx_ring1);
-        const char *freq3_s   = get_field(fields, n, cols.idx_freq3);
-        const char *test3_s   = get_field(fields, n, cols.idx_test3);
-        const char *flt1_s    = get_field(fields, n, cols.idx_flt1);
-        const char *fltcoff_s = get_field(fields, n, cols.idx_fltcoff);
-        const char *fltres_s  = get_field(fields, n, cols.idx_fltres);
-        const char *fltlo_s   = get_field(fields, n, cols.idx_fltlo);
-        const char *fltband_s = get_field(fields, n, cols.idx_fltband);
-        const char *flthi_s   = get_field(fields, n, cols.idx_flthi);
-        const char *vol_s     = get_field(fields, n, cols.idx_vol);
-
-        // Keep output texty, similar-ish to the ssf2swi "raw table".
-        printf("%5u  %6s  %5s  %5s  %7s  %5s %5s %4s %4s %4s %4s %4s %5s %5s %4s %7s %6s %5s %7s %5s %4s\n",
-               frame_index++,
-               clock_s,
-               gate1_s,
-               freq1_s,
-               pwduty1_s,
-               pulse1_s,
-               noise1_s,
-               tri1_s,
-               saw1_s,
-               test1_s,
-               sync1_s,
-               ring1_s,
-               freq3_s,
-               test3_s,
-               flt1_s,
-               fltcoff_s,
-               fltres_s,
-               fltlo_s,
-               fltband_s,
-               flthi_s,
-               vol_s);
+static double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+    const char *prog = (argc > 0 && argv[0]) ? argv[0] : "ssf2rip";
+    hashid_map_t map;
+    memset(&map, 0, sizeof map);
+    long long *targets = calloc((size_t)argc, sizeof *targets);
+    const char **inputs = calloc((size_t)argc, sizeof *inputs);
+    size_t target_count = 0;
+    size_t input_count = 0;
+    if (!targets || !inputs) {
+        perror("ssf2rip: alloc");
+        return 1;
     }
 
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-i") == 0) {
+            if (i + 1 >= argc) {
+                usage(prog);
+                return 1;
+            }
+            inputs[input_count++] = argv[++i];
+        } else if (strcmp(argv[i], "-hashid") == 0) {
+            if (i + 1 >= argc) {
+                usage(prog);
+                return 1;
+            }
+            char *end = NULL;
+            errno = 0;
+            long long target_hashid = strtoll(argv[i + 1], &end, 10);
+            if (errno != 0 || !end || *end != '\0') {
+                fprintf(stderr, "ssf2rip: invalid hashid '%s'\n", argv[i + 1]);
+                return 1;
+            }
+            hashid_entry_t *e = hashid_map_get(&map, target_hashid);
+            if (!e) return 1;
+            if (!e->target) {
+                e->target = true;
+                targets[target_count++] = target_hashid;
+            }
+            ++i;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            usage(prog);
+            return 1;
+        } else {
+            inputs[input_count++] = argv[i];
+        }
+    }
+    bool have_target = target_count > 0;
+    if (input_count == 0) {
+        inputs[input_count++] = NULL;  // stdin
+    }
+
+    rip_totals_t totals = {0, 0};
+    double t0 = monotonic_seconds();
+    for (size_t f = 0; f < input_count; ++f) {
+        int rc = is_ssfc_path(inputs[f])
+                     ? rip_ssfc(inputs[f], (int)f, &map, have_target, &totals)
+                     : rip_file(inputs[f], (int)f, &map, have_target, &totals);
+        if (rc != 0) {
+            hashid_map_free(&map);
+            return 1;
+        }
+    }
+    double elapsed = monotonic_seconds() - t0;
+    if (elapsed <= 0.0) elapsed = 1e-9;
+    fprintf(stderr,
+            "ssf2rip: %zu file(s), %llu rows, %.1f MB in %.3f s (%.1f MB/s, %.0f rows/s)\n",
+            input_count,
+            totals.rows,
+            (double)totals.bytes / 1e6,
+            elapsed,
+            (double)totals.bytes / 1e6 / elapsed,
+            (double)totals.rows / elapsed);
+
+    int rc = 0;
     if (!have_target) {
         // Just listing hashids mode
-        if (hashid_count == 0) {
+        if (map.count == 0) {
             fprintf(stderr, "ssf2rip: no data rows found\n");
+            hashid_map_free(&map);
             return 1;
         }
-        printf("Found %d unique hashids:\n", hashid_count);
-        printf("hashid,count\n");
-        for (int i = 0; i < hashid_count; ++i) {
-            printf("%lld,%lu\n",
-                   hashids[i].hashid,
-                   hashids[i].count);
+        printf("Found %zu unique hashids:\n", map.count);
+        if (input_count > 1) {
+            printf("hashid,count,files\n");
+        } else {
+            printf("hashid,count\n");
+        }
+        for (size_t i = 0; i < map.count; ++i) {
+            if (input_count > 1) {
+                printf("%lld,%lu,%lu\n",
+                       map.entries[i].hashid,
+                       map.entries[i].count,
+                       map.entries[i].files);
+            } else {
+                printf("%lld,%lu\n",
+                       map.entries[i].hashid,
+                       map.entries[i].count);
+            }
+        }
+    } else {
+        for (size_t t = 0; t < target_count; ++t) {
+            hashid_entry_t *e = hashid_map_find(&map, targets[t]);
+            if (!e->table) {
+                fprintf(stderr,
+                        "ssf2rip: hashid %lld not found in input\n",
+                        targets[t]);
+                rc = 1;
+                continue;
+            }
+            fclose(e->table);
+            e->table = NULL;
+            if (t > 0) printf("\n");
+            if (input_count > 1) printf("file: %s\n", inputs[e->source_file]);
+            fwrite(e->table_buf, 1, e->table_len, stdout);
         }
-        return 0;
-    }
-
-    if (!found_any) {
-        fprintf(stderr,
-                "ssf2rip: hashid %lld not found in input\n",
-                target_hashid);
-        return 1;
     }
 
-    return 0;
+    hashid_map_free(&map);
+    free(targets);
+    free(inputs);
+    return rc;
 }
@@ -1,19 +1,21 @@
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
 #include <ctype.h>
+#include <stdarg.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/select.h>
 #include <sys/time.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
-#include <sys/uio.h>
 #include <termios.h>
+#include <time.h>
 #include <unistd.h>
 
 #define DEFAULT_FIFO "/tmp/sid.tap"
@@ -51,17 +53,16 @@ typedef struct {
     unsigned long long events;
     unsigned long long fifo_bytes;
     unsigned long long serial_bytes;
+    unsigned long long resync_bytes;
 } sidtap_stats_t;
 
-static sidtap_stats_t g_stats = {0, 0, 0, 0};
+static sidtap_stats_t g_stats = {0, 0, 0, 0, 0};
 static struct timeval g_start_time = {0, 0};
 static unsigned long long g_fifo_read_ops = 0;
-static uint8_t g_voice_mute_mask = 0;
-static bool g_filter_enabled = true;
 static int g_keyboard_enabled = 0;
-static int g_serial_fd = -1;
 
 #define PAL_CYCLES_PER_FRAME 19656u
+#define PAL_CLOCK_HZ 985248u
 #define PAL_FRAME_TOLERANCE 512u
 #define PAL_MAX_CYCLE_CARRY (PAL_CYCLES_PER_FRAME * 8u)
 #define PAL_EVENT_DELTA_SANITY (PAL_CYCLES_PER_FRAME * 256u)
@@ -78,12 +79,179 @@ static int g_serial_fd = -1;
 #define SIDDLER_TEXT_COLS 40
 #define SIDDLER_TEXT_ROWS 27
 
+/* Log-linear (HDR-style) histogram: exact below 32, then 32 linear
+ * sub-buckets per power of two, i.e. about 3% relative precision over the
+ * full uint32 range. */
+#define HIST_SUB_BITS 5u
+#define HIST_SUB_COUNT (1u << HIST_SUB_BITS)
+#define HIST_BUCKETS (HIST_SUB_COUNT + (32u - HIST_SUB_BITS) * HIST_SUB_COUNT)
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+    uint32_t min;
+    uint32_t max;
+} histogram_t;
+
+static uint32_t hist_bucket(uint32_t v) {
+    if (v < HIST_SUB_COUNT) return v;
+    uint32_t msb = 31u - (uint32_t)__builtin_clz(v);
+    uint32_t shift = msb - HIST_SUB_BITS;
+    uint32_t mantissa = (v >> shift) & (HIST_SUB_COUNT - 1u);
+    return HIST_SUB_COUNT + shift * HIST_SUB_COUNT + mantissa;
+}
+
+/* Highest value that maps to the bucket. */
+static uint32_t hist_bucket_upper(uint32_t idx) {
+    if (idx < HIST_SUB_COUNT) return idx;
+    uint32_t shift = (idx - HIST_SUB_COUNT) / HIST_SUB_COUNT;
+    uint32_t mantissa = (idx - HIST_SUB_COUNT) % HIST_SUB_COUNT;
+    uint64_t lower = (uint64_t)(HIST_SUB_COUNT + mantissa) << shift;
+    uint64_t upper = lower + ((uint64_t)1 << shift) - 1u;
+    return (upper > UINT32_MAX) ? UINT32_MAX : (uint32_t)upper;
+}
+
+static void hist_record(histogram_t *h, uint32_t v) {
+    h->counts[hist_bucket(v)]++;
+    if (h->total == 0 || v < h->min) h->min = v;
+    if (v > h->max) h->max = v;
+    h->total++;
+    h->sum += v;
+}
+
+/* Value at the given percentile (0-100], clamped to the observed max. */
+static uint32_t hist_percentile(const histogram_t *h, double pct) {
+    if (h->total == 0) return 0;
+    uint64_t rank = (uint64_t)((pct / 100.0) * (double)h->total + 0.999999);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < HIST_BUCKETS; ++i) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint32_t v = hist_bucket_upper(i);
+            return (v > h->max) ? h->max : v;
+        }
+    }
+    return h->max;
+}
+
+static uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000ull;
+}
+
+/* Outgoing bytes are queued per device and written as the descriptor
+ * becomes writable, so a stalled device never blocks FIFO input or the
+ * other devices. Only whole frames are queued; the queue fits the largest
+ * possible frame. */
+#define SERIAL_QUEUE_SIZE (512u * 1024u)
+#define SERIAL_QUEUE_MASK (SERIAL_QUEUE_SIZE - 1u)
+#define MAX_SERIAL_PORTS 8
+#define SERIAL_FRAME_MARKS 1024u
+
+/* Queue offset at which a frame ends, for arrival-to-write latency. */
+typedef struct {
+    size_t end;
+    uint64_t arrival_us;
+} serial_frame_mark_t;
+
+/* Per-device forwarding state. Without -f a single port with fd -1 still
+ * runs the filter and cycle accounting for the monitor. */
+typedef struct {
+    const char *path;
+    int fd;
+    uint8_t queue[SERIAL_QUEUE_SIZE];
+    size_t q_head;
+    size_t q_tail;
+    size_t q_peak;
+    unsigned long long dropped_frames;
+    uint64_t out_hash;        /* FNV-1a of every byte written to the device */
+    unsigned long long out_bytes;
+    serial_frame_mark_t marks[SERIAL_FRAME_MARKS];
+    size_t mark_head;
+    size_t mark_tail;
+    histogram_t latency_hist;
+    uint8_t voice_mute_mask;
+    bool filter_enabled;
+    uint32_t cycle_carry;
+    char line[512];
+    size_t line_len;
+    char screen_lines[SIDDLER_STATUS_SCREEN_COUNT][SIDDLER_TEXT_ROWS][SIDDLER_TEXT_COLS + 1];
+    uint8_t screen_line_valid[SIDDLER_STATUS_SCREEN_COUNT][SIDDLER_TEXT_ROWS];
+} serial_port_t;
+
+static serial_port_t *g_ports = NULL;
+static size_t g_port_count = 0;
+static int g_selected_port = -1;  /* -1: keys act on every device */
+
+/* Complete frames found in the FIFO ring but not yet forwarded. Without
+ * -L they are released as soon as they are found. With -L the regulator
+ * releases them on a real-time schedule derived from their cycle counts,
+ * running at most `lookahead_ms` ahead of playback. While `capacity`
+ * frames are held, FIFO reads pause and the writer is back-pressured. */
+#define REG_DEFAULT_FRAMES 500u
+#define REG_UNREGULATED_FRAMES 4096u
+
+typedef struct {
+    size_t skip;              /* resync bytes in front of the frame */
+    size_t len;
+    uint32_t count;
+    uint32_t frame_no;
+    uint32_t cycles;          /* playback length used for scheduling */
+    uint64_t arrival_us;
+    struct timeval arrival;
+} pending_frame_t;
+
+typedef struct {
+    int enabled;
+    uint32_t lookahead_ms;
+    size_t capacity;
+    pending_frame_t *frames;
+    size_t head;              /* monotonic indices into frames[] */
+    size_t tail;
+    size_t scan;              /* ring position up to which frames are indexed */
+    uint64_t held_cycles;
+    size_t peak;
+    int anchored;
+    uint64_t origin_us;
+    uint64_t released_cycles;
+    unsigned long long underruns;
+} frame_regulator_t;
+
+static frame_regulator_t g_regulator = {0};
+
+static size_t regulator_held(const frame_regulator_t *reg) {
+    return reg->head - reg->tail;
+}
+
+static void regulator_reset(frame_regulator_t *reg) {
+    reg->head = 0;
+    reg->tail = 0;
+    reg->scan = 0;
+    reg->held_cycles = 0;
+    reg->anchored = 0;
+}
+
+/* Playback time, relative to now, of the next frame to be released. */
+static int64_t regulator_ahead_us(const frame_regulator_t *reg, uint64_t now_us) {
+    if (!reg->anchored) return 0;
+    uint64_t due = reg->origin_us + reg->released_cycles * 1000000ull / PAL_CLOCK_HZ;
+    return (int64_t)due - (int64_t)now_us;
+}
+
+static histogram_t g_gap_hist;          /* inter-frame FIFO arrival gap, us */
+static histogram_t g_write_hist;        /* duration of each serial write(), us */
+static histogram_t g_frame_bytes_hist;  /* bytes per forwarded frame */
+static const char *g_hist_dump_path = NULL;
+
 static inline uint32_t clamp_u32(uint64_t value, uint32_t max) {
     return (value > max) ? max : (uint32_t)value;
 }
 
-static bool should_drop_sid_event(uint8_t addr);
-static void send_sid_command(uint8_t opcode, uint8_t param0, uint8_t param1, uint8_t param2);
+static bool should_drop_sid_event(const serial_port_t *port, uint8_t addr);
+static void send_sid_command(serial_port_t *port, uint8_t opcode, uint8_t param0, uint8_t param1, uint8_t param2);
 
 static uint16_t le16_to_host(uint16_t v) {
 #if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
@@ -101,35 +269,12 @@ static uint32_t le32_to_host(uint32_t v) {
 #endif
 }
 
-static uint32_t host_to_le32(uint32_t v) {
-    return le32_to_host(v);
+static uint16_t host_to_le16(uint16_t v) {
+    return le16_to_host(v);
 }
 
-static uint32_t apply_voice_filtering(sid_event_t *events, uint32_t count) {
-    if (!events || count == 0) {
-        return 0;
-    }
-    if (g_voice_mute_mask == 0 && g_filter_enabled) {
-        return count;
-    }
-    uint32_t out = 0;
-    uint64_t pending = 0;
-    for (uint32_t i = 0; i < count; ++i) {
-        uint64_t delta_acc = (uint64_t)events[i].delta + pending;
-        if (delta_acc > UINT32_MAX) {
-            delta_acc = UINT32_MAX;
-        }
-        uint32_t adjusted_delta = (uint32_t)delta_acc;
-        if (should_drop_sid_event(events[i].addr)) {
-            pending = adjusted_delta;
-            continue;
-        }
-        sid_event_t ev = events[i];
-        ev.delta = adjusted_delta;
-        events[out++] = ev;
-        pending = 0;
-    }
-    return out;
+static uint32_t host_to_le32(uint32_t v) {
+    return le32_to_host(v);
 }
 
 static int sid_voice_index_from_addr(uint8_t addr) {
@@ -143,20 +288,20 @@ static bool sid_filter_register(uint8_t addr) {
     return addr >= SID_FILTER_ADDR_MIN && addr <= SID_FILTER_ADDR_MAX;
 }
 
-static bool should_drop_sid_event(uint8_t addr) {
+static bool should_drop_sid_event(const serial_port_t *port, uint8_t addr) {
     uint8_t reg = addr & 0x1Fu;
     int voice = sid_voice_index_from_addr(reg);
-    if (voice >= 0 && (g_voice_mute_mask & (1u << voice))) {
+    if (voice >= 0 && (port->voice_mute_mask & (1u << voice))) {
         return true;
     }
-    if (!g_filter_enabled && sid_filter_register(reg)) {
+    if (!port->filter_enabled && sid_filter_register(reg)) {
         return true;
     }
     return false;
 }
 
-static char voice_state_char(int voice) {
-    return (g_voice_mute_mask & (1u << voice)) ? '-' : (char)('1' + voice);
+static char voice_state_char(const serial_port_t *port, int voice) {
+    return (port->voice_mute_mask & (1u << voice)) ? '-' : (char)('1' + voice);
 }
 
 static void handle_signal(int sig) {
@@ -164,34 +309,272 @@ static void handle_signal(int sig) {
     g_running = 0;
 }
 
-static ssize_t read_exact(int fd, void *buf, size_t len) {
-    uint8_t *p = (uint8_t *)buf;
+/* FIFO input is staged in a ring and frames are parsed in place once they
+ * are complete. The largest possible frame is 10 + 65535 * 6 bytes, so a
+ * 1 MiB ring always has room for at least two of them. */
+#define FIFO_RING_SIZE (1u << 20)
+#define FIFO_RING_MASK (FIFO_RING_SIZE - 1u)
+
+typedef struct {
+    uint8_t data[FIFO_RING_SIZE];
+    size_t head;                 /* bytes written since reset */
+    size_t tail;                 /* bytes consumed since reset */
+    struct timeval last_fill;    /* arrival time of the newest bytes */
+    uint64_t last_fill_us;       /* same, monotonic */
+    int eof;
+} fifo_ring_t;
+
+static fifo_ring_t g_fifo_ring;
+
+static void fifo_ring_reset(fifo_ring_t *r) {
+    r->head = 0;
+    r->tail = 0;
+    r->eof = 0;
+}
+
+static inline size_t fifo_ring_used(const fifo_ring_t *r) {
+    return r->head - r->tail;
+}
+
+static inline uint8_t fifo_ring_u8(const fifo_ring_t *r, size_t off) {
+    return r->data[(r->tail + off) & FIFO_RING_MASK];
+}
+
+static inline uint16_t fifo_ring_le16(const fifo_ring_t *r, size_t off) {
+    return (uint16_t)(fifo_ring_u8(r, off) | ((uint16_t)fifo_ring_u8(r, off + 1) << 8));
+}
+
+static inline uint32_t fifo_ring_le32(const fifo_ring_t *r, size_t off) {
+    return (uint32_t)fifo_ring_u8(r, off) |
+           ((uint32_t)fifo_ring_u8(r, off + 1) << 8) |
+           ((uint32_t)fifo_ring_u8(r, off + 2) << 16) |
+           ((uint32_t)fifo_ring_u8(r, off + 3) << 24);
+}
+
+/* Pull everything the (non-blocking) FIFO currently holds into the ring.
+ * Returns the number of bytes read or -1 on error; EOF sets r->eof. */
+static ssize_t fifo_ring_fill(fifo_ring_t *r, int fd) {
     size_t total = 0;
-    while (total < len) {
-        ssize_t n = read(fd, p + total, len - total);
+    while (fifo_ring_used(r) < FIFO_RING_SIZE) {
+        size_t idx = r->head & FIFO_RING_MASK;
+        size_t chunk = FIFO_RING_SIZE - idx;
+        size_t space = FIFO_RING_SIZE - fifo_ring_used(r);
+        if (chunk > space) chunk = space;
+        ssize_t n = read(fd, r->data + idx, chunk);
         if (n > 0) {
+            r->head += (size_t)n;
             total += (size_t)n;
             g_stats.fifo_bytes += (size_t)n;
             g_fifo_read_ops++;
             continue;
         }
         if (n == 0) {
-            return 0;  // EOF
+            r->eof = 1;
+            break;
         }
         if (errno == EINTR) {
-            if (!g_running) return -1;
+            if (!g_running) break;
             continue;
         }
         if (errno == EAGAIN || errno == EWOULDBLOCK) {
-            usleep(1000);
-            if (!g_running) return -1;
-            continue;
+            break;
         }
         return -1;
     }
+    if (total > 0) {
+        gettimeofday(&r->last_fill, NULL);
+        r->last_fill_us = monotonic_us();
+    }
     return (ssize_t)total;
 }
 
+static inline size_t serial_queue_used(const serial_port_t *p) {
+    return p->q_head - p->q_tail;
+}
+
+static void serial_queue_copy(serial_port_t *p, const void *src, size_t len) {
+    const uint8_t *s = (const uint8_t *)src;
+    while (len > 0) {
+        size_t idx = p->q_head & SERIAL_QUEUE_MASK;
+        size_t chunk = SERIAL_QUEUE_SIZE - idx;
+        if (chunk > len) chunk = len;
+        memcpy(p->queue + idx, s, chunk);
+        p->q_head += chunk;
+        s += chunk;
+        len -= chunk;
+    }
+}
+
+/* Store into the queue at an absolute position at or past q_head, for
+ * building a frame in place before it is published. */
+static inline void serial_queue_put_u8(serial_port_t *p, size_t pos, uint8_t v) {
+    p->queue[pos & SERIAL_QUEUE_MASK] = v;
+}
+
+static inline void serial_queue_put_le32(serial_port_t *p, size_t pos, uint32_t v) {
+    serial_queue_put_u8(p, pos, (uint8_t)v);
+    serial_queue_put_u8(p, pos + 1, (uint8_t)(v >> 8));
+    serial_queue_put_u8(p, pos + 2, (uint8_t)(v >> 16));
+    serial_queue_put_u8(p, pos + 3, (uint8_t)(v >> 24));
+}
+
+/* Book-keeping for a unit that just ended at q_head. A non-zero arrival
+ * time tracks the frame until its last byte is written. */
+static void serial_queue_mark(serial_port_t *p, uint64_t arrival_us) {
+    if (arrival_us && p->mark_head - p->mark_tail < SERIAL_FRAME_MARKS) {
+        serial_frame_mark_t *m = &p->marks[p->mark_head++ % SERIAL_FRAME_MARKS];
+        m->end = p->q_head;
+        m->arrival_us = arrival_us;
+    }
+    if (serial_queue_used(p) > p->q_peak) {
+        p->q_peak = serial_queue_used(p);
+    }
+}
+
+/* Queue a header plus payload as one unit; drops it if it does not fit. */
+static bool serial_queue_push(serial_port_t *p, const void *hdr, size_t hdr_len,
+                              const void *payload, size_t payload_len,
+                              uint64_t arrival_us) {
+    if (SERIAL_QUEUE_SIZE - serial_queue_used(p) < hdr_len + payload_len) {
+        p->dropped_frames++;
+        return false;
+    }
+    serial_queue_copy(p, hdr, hdr_len);
+    serial_queue_copy(p, payload, payload_len);
+    serial_queue_mark(p, arrival_us);
+    return true;
+}
+
+#define FNV64_OFFSET 0xcbf29ce484222325ULL
+
+static uint64_t fnv1a64(uint64_t h, const uint8_t *p, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/* Write as much of the queue as the device accepts without blocking.
+ * Returns -1 on a hard write error. */
+static int serial_flush(serial_port_t *p) {
+    while (p->fd >= 0 && serial_queue_used(p) > 0) {
+        size_t idx = p->q_tail & SERIAL_QUEUE_MASK;
+        size_t chunk = SERIAL_QUEUE_SIZE - idx;
+        if (chunk > serial_queue_used(p)) chunk = serial_queue_used(p);
+        uint64_t t0 = monotonic_us();
+        ssize_t n = write(p->fd, p->queue + idx, chunk);
+        if (n > 0) {
+            uint64_t t1 = monotonic_us();
+            hist_record(&g_write_hist, (uint32_t)clamp_u32(t1 - t0, UINT32_MAX));
+            p->out_hash = fnv1a64(p->out_hash, p->queue + idx, (size_t)n);
+            p->out_bytes += (size_t)n;
+            p->q_tail += (size_t)n;
+            g_stats.serial_bytes += (size_t)n;
+            while (p->mark_tail != p->mark_head &&
+                   p->marks[p->mark_tail % SERIAL_FRAME_MARKS].end <= p->q_tail) {
+                uint64_t arrival = p->marks[p->mark_tail % SERIAL_FRAME_MARKS].arrival_us;
+                hist_record(&p->latency_hist, (uint32_t)clamp_u32(t1 - arrival, UINT32_MAX));
+                p->mark_tail++;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        return -1;
+    }
+    return 0;
+}
+
+/* A device that errors out is dropped; the others keep streaming. */
+static void serial_port_close(serial_port_t *p, const char *why) {
+    if (p->fd < 0) return;
+    fprintf(stderr, "[error] %s went away (%s), no longer forwarding to it\n", p->path, why);
+    close(p->fd);
+    p->fd = -1;
+    p->q_head = p->q_tail = 0;
+    p->mark_head = p->mark_tail = 0;
+}
+
+static size_t serial_ports_open(void) {
+    size_t open_ports = 0;
+    for (size_t i = 0; i < g_port_count; ++i) {
+        if (g_ports[i].fd >= 0) open_ports++;
+    }
+    return open_ports;
+}
+
+/* Find the next complete frame at or after `off` bytes past the ring tail.
+ * Returns its length (0 if more input is needed) and sets *start to the
+ * offset of its magic. */
+static size_t fifo_ring_find_frame(const fifo_ring_t *r, size_t off, size_t *start,
+                                   uint32_t *count, uint32_t *frame_no) {
+    size_t used = fifo_ring_used(r);
+    while (used - off >= sizeof(uint32_t) && fifo_ring_le32(r, off) != SID_MAGIC) {
+        off++;
+    }
+    *start = off;
+    if (used - off < sizeof(sid_header_t)) {
+        return 0;
+    }
+    uint32_t n = fifo_ring_le16(r, off + offsetof(sid_header_t, count));
+    size_t frame_len = sizeof(sid_header_t) + (size_t)n * sizeof(sid_event_t);
+    if (used - off < frame_len) {
+        return 0;
+    }
+    *count = n;
+    *frame_no = fifo_ring_le32(r, off + offsetof(sid_header_t, frame));
+    return frame_len;
+}
+
+static void print_hist_summary(const char *name, int device, const histogram_t *h) {
+    fprintf(stderr,
+            "[hist] metric=%s device=%d count=%llu min=%u mean=%.1f p50=%u p90=%u p99=%u p99.9=%u max=%u\n",
+            name, device, (unsigned long long)h->total, h->min,
+            h->total ? (double)h->sum / (double)h->total : 0.0,
+            hist_percentile(h, 50.0), hist_percentile(h, 90.0),
+            hist_percentile(h, 99.0), hist_percentile(h, 99.9), h->max);
+}
+
+static void dump_hist_buckets(FILE *fp, const char *name, int device, const histogram_t *h) {
+    for (uint32_t i = 0; i < HIST_BUCKETS; ++i) {
+        if (h->counts[i]) {
+            fprintf(fp, "%s,%d,%u,%llu\n", name, device, hist_bucket_upper(i),
+                    (unsigned long long)h->counts[i]);
+        }
+    }
+}
+
+/* One key=value summary line per histogram on stderr; with -H the raw
+ * buckets are also written as CSV (metric,device,upper_bound,count).
+ * Device -1 marks metrics that are not per device. */
+static void print_histograms(void) {
+    print_hist_summary("gap_us", -1, &g_gap_hist);
+    print_hist_summary("write_us", -1, &g_write_hist);
+    print_hist_summary("frame_bytes", -1, &g_frame_bytes_hist);
+    for (size_t i = 0; i < g_port_count; ++i) {
+        if (g_ports[i].path) {
+            print_hist_summary("latency_us", (int)i, &g_ports[i].latency_hist);
+        }
+    }
+    if (!g_hist_dump_path) return;
+    FILE *fp = fopen(g_hist_dump_path, "w");
+    if (!fp) {
+        fprintf(stderr, "[warn] cannot write histogram dump %s: %s\n", g_hist_dump_path, strerror(errno));
+        return;
+    }
+    fprintf(fp, "metric,device,upper_bound,count\n");
+    dump_hist_buckets(fp, "gap_us", -1, &g_gap_hist);
+    dump_hist_buckets(fp, "write_us", -1, &g_write_hist);
+    dump_hist_buckets(fp, "frame_bytes", -1, &g_frame_bytes_hist);
+    for (size_t i = 0; i < g_port_count; ++i) {
+        if (g_ports[i].path) {
+            dump_hist_buckets(fp, "latency_us", (int)i, &g_ports[i].latency_hist);
+        }
+    }
+    fclose(fp);
+}
+
 static void print_stats(void) {
     struct timeval end_time;
     gettimeofday(&end_time, NULL);
@@ -202,9 +585,9 @@ static void print_stats(void) {
         if (elapsed < 1e-6) elapsed = 1e-6;
     }
     fprintf(stderr,
-            "[stats] frames=%llu events=%llu fifo_bytes=%llu serial_bytes=%llu\n",
+            "[stats] frames=%llu events=%llu fifo_bytes=%llu serial_bytes=%llu resync_bytes=%llu\n",
             g_stats.frames, g_stats.events,
-            g_stats.fifo_bytes, g_stats.serial_bytes);
+            g_stats.fifo_bytes, g_stats.serial_bytes, g_stats.resync_bytes);
     if (elapsed > 0.0) {
         double fifo_rate = g_stats.fifo_bytes / elapsed / 1024.0;
         double serial_rate = g_stats.serial_bytes / elapsed / 1024.0;
@@ -212,15 +595,16 @@ static void print_stats(void) {
                 "[stats] duration %.2fs fifo %.2f kB/s serial %.2f kB/s\n",
                 elapsed, fifo_rate, serial_rate);
     }
+    print_histograms();
 }
 
-static void send_sid_command(uint8_t opcode, uint8_t param0, uint8_t param1, uint8_t param2) {
-    if (g_serial_fd < 0) {
+static void send_sid_command(serial_port_t *port, uint8_t opcode, uint8_t param0, uint8_t param1, uint8_t param2) {
+    if (port->fd < 0) {
         return;
     }
     sid_header_t hdr = {
-        .magic = SID_MAGIC,
-        .count = SID_CMD_FRAME_COUNT,
+        .magic = host_to_le32(SID_MAGIC),
+        .count = host_to_le16(SID_CMD_FRAME_COUNT),
         .frame = 0
     };
     sid_command_t cmd = {
@@ -229,18 +613,13 @@ static void send_sid_command(uint8_t opcode, uint8_t param0, uint8_t param1, uin
         .param1 = param1,
         .param2 = param2
     };
-    struct iovec iov[2] = {
-        {.iov_base = &hdr, .iov_len = sizeof hdr},
-        {.iov_base = &cmd, .iov_len = sizeof cmd}
-    };
-    ssize_t wrote = writev(g_serial_fd, iov, 2);
-    if (wrote != (ssize_t)(sizeof hdr + sizeof cmd)) {
-        perror("write control");
+    /* Commands go through the send queue so they never split a frame that
+     * is only partially written. */
+    if (!serial_queue_push(port, &hdr, sizeof hdr, &cmd, sizeof cmd, 0)) {
+        fprintf(stderr, "[warn] %s: serial queue full, control command dropped\n", port->path);
     }
 }
 
-static void send_sid_command(uint8_t opcode, uint8_t param0, uint8_t param1, uint8_t param2);
-
 typedef struct {
     uint64_t frames;
     uint64_t events_total;
@@ -268,32 +647,35 @@ typedef struct {
     uint32_t last_cdc_rate_kbps;
     uint32_t last_cdc_reads;
     struct timeval last_frame_end;
-    struct timeval last_print;
     int have_last_frame_end;
-    int have_last_print;
     size_t last_buffer_now;
     uint32_t last_frame_cycles;
     uint32_t max_frame_cycles;
     uint32_t cycle_overflows;
     uint32_t cycle_underruns;
+    uint32_t last_frame_no;
+    int forwarding;
 } monitor_stats_t;
 
+/* Rendered status text; flushed to stdout only while it is writable so a
+ * slow terminal cannot hold up forwarding. */
+typedef struct {
+    char buf[16384];
+    size_t len;
+    size_t off;
+} status_out_t;
+
 static monitor_stats_t g_monitor = {0};
 static int g_stdout_is_tty = 0;
-static uint32_t g_cycle_carry = 0;
 static uint32_t g_display_screen = 0;
-static char g_screen_lines[SIDDLER_STATUS_SCREEN_COUNT][SIDDLER_TEXT_ROWS][SIDDLER_TEXT_COLS + 1];
-static uint8_t g_screen_line_valid[SIDDLER_STATUS_SCREEN_COUNT][SIDDLER_TEXT_ROWS];
-static char g_serial_line_buffer[512];
-static size_t g_serial_line_len = 0;
 static int g_print_help_hint = 1;
 static struct termios g_stdin_saved_termios;
 static int g_stdin_termios_saved = 0;
 static int g_force_status_refresh = 0;
-static void pump_serial_input(int serial_fd, int show_status);
-static void handle_local_input(int show_status);
-static void render_screen_display(uint32_t screen);
-static void reset_screen_cache(void);
+static status_out_t g_status_out;
+static int g_stdout_saved_flags = -1;
+static void render_screen_display(const serial_port_t *port, uint32_t screen);
+static void reset_screen_cache(serial_port_t *port);
 static void restore_terminal(void);
 
 static inline uint32_t time_diff_us(const struct timeval *start, const struct timeval *end) {
@@ -310,27 +692,87 @@ static inline uint32_t time_diff_us(const struct timeval *start, const struct ti
     return (uint32_t)total;
 }
 
-static void reset_screen_cache(void) {
+static void reset_screen_cache(serial_port_t *port) {
     for (uint32_t s = 0; s < SIDDLER_STATUS_SCREEN_COUNT; ++s) {
         for (int r = 0; r < SIDDLER_TEXT_ROWS; ++r) {
-            memset(g_screen_lines[s][r], ' ', SIDDLER_TEXT_COLS);
-            g_screen_lines[s][r][SIDDLER_TEXT_COLS] = '\0';
-            g_screen_line_valid[s][r] = 0;
+            memset(port->screen_lines[s][r], ' ', SIDDLER_TEXT_COLS);
+            port->screen_lines[s][r][SIDDLER_TEXT_COLS] = '\0';
+            port->screen_line_valid[s][r] = 0;
         }
     }
 }
 
+/* Ports addressed by keyboard commands and the screen mirror. */
+static size_t selected_port_first(void) {
+    return (g_selected_port < 0) ? 0 : (size_t)g_selected_port;
+}
+
+static size_t selected_port_end(void) {
+    return (g_selected_port < 0) ? g_port_count : (size_t)g_selected_port + 1;
+}
+
 static void restore_terminal(void) {
     if (g_stdin_termios_saved) {
         tcsetattr(STDIN_FILENO, TCSANOW, &g_stdin_saved_termios);
         g_stdin_termios_saved = 0;
     }
+    if (g_stdout_saved_flags >= 0) {
+        fcntl(STDOUT_FILENO, F_SETFL, g_stdout_saved_flags);
+        g_stdout_saved_flags = -1;
+    }
+}
+
+static uint64_t monotonic_ms(void) {
+    return monotonic_us() / 1000ull;
 }
 
-static void print_monitor_status(const monitor_stats_t *st, uint32_t frame_no, size_t buffer_now, uint32_t cycle_carry, int forwarding) {
+static int ms_until(uint64_t deadline, uint64_t now) {
+    if (deadline <= now) return 0;
+    uint64_t diff = deadline - now;
+    return (diff > INT32_MAX) ? INT32_MAX : (int)diff;
+}
+
+__attribute__((format(printf, 1, 2)))
+static void status_printf(const char *fmt, ...) {
+    status_out_t *out = &g_status_out;
+    if (out->len >= sizeof out->buf) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(out->buf + out->len, sizeof out->buf - out->len, fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        out->len += (size_t)n;
+        if (out->len > sizeof out->buf - 1) out->len = sizeof out->buf - 1;
+    }
+}
+
+static bool status_pending(void) {
+    return g_status_out.off < g_status_out.len;
+}
+
+static void status_flush(void) {
+    status_out_t *out = &g_status_out;
+    while (out->off < out->len) {
+        ssize_t n = write(STDOUT_FILENO, out->buf + out->off, out->len - out->off);
+        if (n > 0) {
+            out->off += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        out->off = out->len;  /* stdout is gone; drop the status view */
+    }
+    out->len = 0;
+    out->off = 0;
+}
+
+static void print_monitor_status(const monitor_stats_t *st) {
     if (!st) return;
+    uint32_t frame_no = st->last_frame_no;
+    size_t buffer_now = st->last_buffer_now;
+    int forwarding = st->forwarding;
     if (g_stdout_is_tty) {
-        fputs("\033[H\033[2J", stdout);
+        status_printf("\033[H\033[2J");
     }
     uint32_t avg_events = st->frames ? (uint32_t)(st->events_total / st->frames) : 0;
     uint32_t avg_bytes = st->frames ? (uint32_t)(st->bytes_total / st->frames) : 0;
@@ -341,68 +783,101 @@ static void print_monitor_status(const monitor_stats_t *st, uint32_t frame_no, s
     uint32_t avg_cdc_rate = (forwarding && st->frame_time_total_us)
                                 ? (uint32_t)((st->cdc_bytes_total * 1000ull) / st->frame_time_total_us)
                                 : 0;
-    printf("=== SIDTap Status ===\n");
-    printf("Frame %08u  Total %llu  Buffer %zu  FIFO pk %u\n",
-           frame_no,
-           (unsigned long long)st->frames,
-           buffer_now,
-           st->buffer_peak);
-    printf("Events L%u A%u M%u | Bytes L%u A%u M%u\n",
-           st->last_events, avg_events, st->max_events,
-           st->last_bytes, avg_bytes, st->max_bytes);
-    printf("Frameus L%u A%u M%u | Gapus L%u A%u M%u\n",
-           st->last_frame_us, avg_frame_us, st->max_frame_us,
-           st->last_frame_gap_us, avg_frame_gap_us, st->max_frame_gap_us);
-    printf("CDC bytes L%u A%u M%u (%s) | Rate L%u A%u M%u | Reads L%u Tot %llu\n",
-           st->last_cdc_bytes, avg_cdc_bytes, st->max_cdc_bytes,
-           forwarding ? "ON" : "OFF",
-           st->last_cdc_rate_kbps, avg_cdc_rate, st->max_cdc_rate_kbps,
-           st->last_cdc_reads, (unsigned long long)st->cdc_reads_total);
-    printf("Parseus L%u A%u M%u | Cycles L%u M%u Carry %u OF%u UF%u\n",
-           st->last_parse_us, avg_parse_us, st->max_parse_us,
-           st->last_frame_cycles,
-           st->max_frame_cycles,
-           cycle_carry,
-           st->cycle_overflows,
-           st->cycle_underruns);
-    printf("Voices %c%c%c  Filter %s\n",
-           voice_state_char(0),
-           voice_state_char(1),
-           voice_state_char(2),
-           g_filter_enabled ? "ON" : "OFF");
+    status_printf("=== SIDTap Status ===\n");
+    status_printf("Frame %08u  Total %llu  Buffer %zu  FIFO pk %u\n",
+                  frame_no,
+                  (unsigned long long)st->frames,
+                  buffer_now,
+                  st->buffer_peak);
+    status_printf("Events L%u A%u M%u | Bytes L%u A%u M%u\n",
+                  st->last_events, avg_events, st->max_events,
+                  st->last_bytes, avg_bytes, st->max_bytes);
+    status_printf("Frameus L%u A%u M%u | Gapus L%u A%u M%u\n",
+                  st->last_frame_us, avg_frame_us, st->max_frame_us,
+                  st->last_frame_gap_us, avg_frame_gap_us, st->max_frame_gap_us);
+    status_printf("CDC bytes L%u A%u M%u (%s) | Rate L%u A%u M%u | Reads L%u Tot %llu\n",
+                  st->last_cdc_bytes, avg_cdc_bytes, st->max_cdc_bytes,
+                  forwarding ? "ON" : "OFF",
+                  st->last_cdc_rate_kbps, avg_cdc_rate, st->max_cdc_rate_kbps,
+                  st->last_cdc_reads, (unsigned long long)st->cdc_reads_total);
+    status_printf("Parseus L%u A%u M%u | Cycles L%u M%u Carry %u OF%u UF%u\n",
+                  st->last_parse_us, avg_parse_us, st->max_parse_us,
+                  st->last_frame_cycles,
+                  st->max_frame_cycles,
+                  g_ports[0].cycle_carry,
+                  st->cycle_overflows,
+                  st->cycle_underruns);
+    if (g_regulator.enabled) {
+        status_printf("Regulator held %zu/%zu pk %zu (%u ms) | ahead %lld ms / %u | underruns %llu\n",
+                      regulator_held(&g_regulator),
+                      g_regulator.capacity,
+                      g_regulator.peak,
+                      (uint32_t)(g_regulator.held_cycles * 1000ull / PAL_CLOCK_HZ),
+                      (long long)(regulator_ahead_us(&g_regulator, monotonic_us()) / 1000),
+                      g_regulator.lookahead_ms,
+                      g_regulator.underruns);
+    }
+    status_printf("Hist p50/p99/p99.9/max | Gapus %u/%u/%u/%u | Writeus %u/%u/%u/%u | Bytes %u/%u/%u/%u\n",
+                  hist_percentile(&g_gap_hist, 50.0), hist_percentile(&g_gap_hist, 99.0),
+                  hist_percentile(&g_gap_hist, 99.9), g_gap_hist.max,
+                  hist_percentile(&g_write_hist, 50.0), hist_percentile(&g_write_hist, 99.0),
+                  hist_percentile(&g_write_hist, 99.9), g_write_hist.max,
+                  hist_percentile(&g_frame_bytes_hist, 50.0), hist_percentile(&g_frame_bytes_hist, 99.0),
+                  hist_percentile(&g_frame_bytes_hist, 99.9), g_frame_bytes_hist.max);
+    for (size_t i = 0; i < g_port_count; ++i) {
+        const serial_port_t *port = &g_ports[i];
+        const histogram_t *lat = &port->latency_hist;
+        bool selected = g_selected_port < 0 || (size_t)g_selected_port == i;
+        status_printf("%c%zu %-24.24s TxQ %zu pk %zu drop %llu | Voices %c%c%c Filter %s\n",
+                      selected ? '*' : ' ',
+                      i,
+                      port->path ? port->path : "(monitor only)",
+                      serial_queue_used(port),
+                      port->q_peak,
+                      port->dropped_frames,
+                      voice_state_char(port, 0),
+                      voice_state_char(port, 1),
+                      voice_state_char(port, 2),
+                      port->filter_enabled ? "ON" : "OFF");
+        if (port->fd >= 0) {
+            status_printf("   Latus p50 %u p99 %u p99.9 %u max %u (fifo -> serial write)\n",
+                          hist_percentile(lat, 50.0), hist_percentile(lat, 99.0),
+                          hist_percentile(lat, 99.9), lat->max);
+        }
+    }
     if (g_print_help_hint && g_keyboard_enabled) {
-        printf("Keys: n/p screen, 1-3 voices, 0 all, F filter, M mode, q quit, h hide hint.\n");
+        status_printf("Keys: n/p screen, d device, 1-3 voices, 0 all, F filter, M mode, q quit, h hide hint.\n");
     }
-    printf("\n--- Screen %u ---\n", g_display_screen);
-    render_screen_display(g_display_screen);
-    fflush(stdout);
+    size_t shown = selected_port_first();
+    status_printf("\n--- Device %zu Screen %u ---\n", shown, g_display_screen);
+    render_screen_display(&g_ports[shown], g_display_screen);
 }
 
-static void render_screen_display(uint32_t screen) {
+static void render_screen_display(const serial_port_t *port, uint32_t screen) {
     if (screen >= SIDDLER_STATUS_SCREEN_COUNT) {
-        printf("(invalid screen)\n");
+        status_printf("(invalid screen)\n");
         return;
     }
     int valid_rows = 0;
     for (int row = 0; row < SIDDLER_TEXT_ROWS; ++row) {
-        if (g_screen_line_valid[screen][row]) {
+        if (port->screen_line_valid[screen][row]) {
             valid_rows++;
         }
     }
     if (valid_rows == 0) {
-        printf("(screen %u: no data yet)\n", screen);
+        status_printf("(screen %u: no data yet)\n", screen);
         return;
     }
     for (int row = 0; row < SIDDLER_TEXT_ROWS; ++row) {
-        if (g_screen_line_valid[screen][row]) {
-            printf("%.*s\n", SIDDLER_TEXT_COLS, g_screen_lines[screen][row]);
+        if (port->screen_line_valid[screen][row]) {
+            status_printf("%.*s\n", SIDDLER_TEXT_COLS, port->screen_lines[screen][row]);
         } else {
-            printf("~\n");
+            status_printf("~\n");
         }
     }
 }
 
-static void process_serial_line(const char *line) {
+static void process_serial_line(serial_port_t *port, const char *line) {
     if (!line) return;
     if (strncmp(line, "#L ", 3) != 0) {
         return;
@@ -430,62 +905,48 @@ static void process_serial_line(const char *line) {
         if (len > SIDDLER_TEXT_COLS) len = SIDDLER_TEXT_COLS;
         memcpy(new_line, text, len);
     }
-    if (memcmp(g_screen_lines[screen][row], new_line, SIDDLER_TEXT_COLS) != 0) {
-        memcpy(g_screen_lines[screen][row], new_line, SIDDLER_TEXT_COLS);
-        g_screen_lines[screen][row][SIDDLER_TEXT_COLS] = '\0';
-        g_screen_line_valid[screen][row] = 1;
+    if (memcmp(port->screen_lines[screen][row], new_line, SIDDLER_TEXT_COLS) != 0) {
+        memcpy(port->screen_lines[screen][row], new_line, SIDDLER_TEXT_COLS);
+        port->screen_lines[screen][row][SIDDLER_TEXT_COLS] = '\0';
+        port->screen_line_valid[screen][row] = 1;
         g_force_status_refresh = 1;
     }
 }
 
-static void pump_serial_input(int serial_fd, int show_status) {
-    (void) show_status;
-    if (serial_fd < 0) return;
-    while (1) {
-        fd_set rfds;
-        FD_ZERO(&rfds);
-        FD_SET(serial_fd, &rfds);
-        struct timeval tv = {0, 0};
-        int rv = select(serial_fd + 1, &rfds, NULL, NULL, &tv);
-        if (rv <= 0) {
-            break;
+/* Drain whatever the device has sent and feed complete lines to the
+ * screen mirror. Returns -1 once the device is gone. */
+static int pump_serial_input(serial_port_t *port) {
+    char buf[256];
+    while (port->fd >= 0) {
+        ssize_t n = read(port->fd, buf, sizeof buf);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
         }
-        char buf[256];
-        ssize_t n = read(serial_fd, buf, sizeof buf);
-        if (n <= 0) {
-            break;
+        if (n == 0) {
+            return 0;
         }
         for (ssize_t i = 0; i < n; ++i) {
             char ch = buf[i];
             if (ch == '\r') continue;
             if (ch == '\n') {
-                g_serial_line_buffer[g_serial_line_len] = '\0';
-                process_serial_line(g_serial_line_buffer);
-                g_serial_line_len = 0;
+                port->line[port->line_len] = '\0';
+                process_serial_line(port, port->line);
+                port->line_len = 0;
             } else {
-                if (g_serial_line_len + 1 < sizeof g_serial_line_buffer) {
-                    g_serial_line_buffer[g_serial_line_len++] = ch;
+                if (port->line_len + 1 < sizeof port->line) {
+                    port->line[port->line_len++] = ch;
                 } else {
-                    g_serial_line_len = 0;
+                    port->line_len = 0;
                 }
             }
         }
     }
+    return 0;
 }
 
-static void handle_local_input(int show_status) {
-    if (!g_keyboard_enabled) return;
-    fd_set rfds;
-    FD_ZERO(&rfds);
-    FD_SET(STDIN_FILENO, &rfds);
-    struct timeval tv = {0, 0};
-    int rv = select(STDIN_FILENO + 1, &rfds, NULL, NULL, &tv);
-    if (rv <= 0) {
-        return;
-    }
-    char ch;
-    ssize_t n = read(STDIN_FILENO, &ch, 1);
-    if (n <= 0) return;
+static void handle_local_key(char ch, int show_status) {
     int refresh = 0;
     switch (ch) {
         case 'n':
@@ -506,35 +967,58 @@ static void handle_local_input(int show_status) {
         case '2':
         case '3': {
             int voice = ch - '1';
-            if (voice >= 0 && voice < 3) {
-                g_voice_mute_mask ^= (1u << voice);
-                fprintf(stderr, "[info] voice %d %s\n", voice + 1,
-                        (g_voice_mute_mask & (1u << voice)) ? "muted" : "enabled");
-                send_sid_command(SID_CMD_SET_VOICE_MASK, g_voice_mute_mask, 0, 0);
-                refresh = show_status;
+            for (size_t i = selected_port_first(); i < selected_port_end(); ++i) {
+                serial_port_t *port = &g_ports[i];
+                port->voice_mute_mask ^= (1u << voice);
+                fprintf(stderr, "[info] device %zu voice %d %s\n", i, voice + 1,
+                        (port->voice_mute_mask & (1u << voice)) ? "muted" : "enabled");
+                send_sid_command(port, SID_CMD_SET_VOICE_MASK, port->voice_mute_mask, 0, 0);
             }
+            refresh = show_status;
             break;
         }
         case '0':
-            g_voice_mute_mask = 0;
-            fprintf(stderr, "[info] all voices enabled\n");
-            send_sid_command(SID_CMD_SET_VOICE_MASK, g_voice_mute_mask, 0, 0);
+            for (size_t i = selected_port_first(); i < selected_port_end(); ++i) {
+                serial_port_t *port = &g_ports[i];
+                port->voice_mute_mask = 0;
+                fprintf(stderr, "[info] device %zu all voices enabled\n", i);
+                send_sid_command(port, SID_CMD_SET_VOICE_MASK, port->voice_mute_mask, 0, 0);
+            }
             refresh = show_status;
             break;
         case 'f':
         case 'F':
-            g_filter_enabled = !g_filter_enabled;
-            fprintf(stderr, "[info] filter registers %s\n",
-                    g_filter_enabled ? "enabled" : "muted");
-            send_sid_command(SID_CMD_SET_FILTER, g_filter_enabled ? 1u : 0u, 0, 0);
+            for (size_t i = selected_port_first(); i < selected_port_end(); ++i) {
+                serial_port_t *port = &g_ports[i];
+                port->filter_enabled = !port->filter_enabled;
+                fprintf(stderr, "[info] device %zu filter registers %s\n", i,
+                        port->filter_enabled ? "enabled" : "muted");
+                send_sid_command(port, SID_CMD_SET_FILTER, port->filter_enabled ? 1u : 0u, 0, 0);
+            }
             refresh = show_status;
             break;
         case 'm':
         case 'M':
-            fprintf(stderr, "[info] cycling SID model\n");
-            send_sid_command(SID_CMD_CYCLE_MODE, 0, 0, 0);
+            for (size_t i = selected_port_first(); i < selected_port_end(); ++i) {
+                fprintf(stderr, "[info] device %zu cycling SID model\n", i);
+                send_sid_command(&g_ports[i], SID_CMD_CYCLE_MODE, 0, 0, 0);
+            }
             refresh = show_status;
             break;
+        case 'd':
+        case 'D':
+            if (g_port_count > 1) {
+                /* Cycle 0 .. N-1, then back to "all devices". */
+                g_selected_port = (g_selected_port + 1 >= (int)g_port_count) ? -1 : g_selected_port + 1;
+                if (g_selected_port < 0) {
+                    fprintf(stderr, "[info] keys act on all devices\n");
+                } else {
+                    fprintf(stderr, "[info] keys act on device %d (%s)\n",
+                            g_selected_port, g_ports[g_selected_port].path);
+                }
+                refresh = show_status;
+            }
+            break;
         case 'q':
         case 'Q':
             g_running = 0;
@@ -555,6 +1039,17 @@ static void handle_local_input(int show_status) {
     }
 }
 
+static void handle_local_input(int show_status) {
+    if (!g_keyboard_enabled) return;
+    char buf[64];
+    ssize_t n;
+    while ((n = read(STDIN_FILENO, buf, sizeof buf)) > 0) {
+        for (ssize_t i = 0; i < n && g_running; ++i) {
+            handle_local_key(buf[i], show_status);
+        }
+    }
+}
+
 static void monitor_update(monitor_stats_t *st,
                            uint32_t frame_no,
                            uint32_t events,
@@ -562,14 +1057,11 @@ static void monitor_update(monitor_stats_t *st,
                            uint32_t frame_cycles,
                            uint32_t cycle_carry,
                            const struct timeval *frame_start,
+                           uint32_t parse_us,
                            int forwarding,
-                           int fifo_fd,
-                           int show_status) {
+                           int fifo_fd) {
     if (!st) return;
 
-    pump_serial_input(g_serial_fd, show_status);
-    handle_local_input(show_status);
-
     struct timeval now;
     gettimeofday(&now, NULL);
 
@@ -584,6 +1076,8 @@ static void monitor_update(monitor_stats_t *st,
     st->have_last_frame_end = 1;
 
     st->frames++;
+    st->last_frame_no = frame_no;
+    st->forwarding = forwarding;
     st->last_events = events;
     st->events_total += events;
     if (events > st->max_events) st->max_events = events;
@@ -596,9 +1090,9 @@ static void monitor_update(monitor_stats_t *st,
     st->last_frame_us = frame_us;
     if (frame_us > st->max_frame_us) st->max_frame_us = frame_us;
 
-    st->last_parse_us = frame_us;
-    st->parse_time_total_us += frame_us;
-    if (frame_us > st->max_parse_us) st->max_parse_us = frame_us;
+    st->last_parse_us = parse_us;
+    st->parse_time_total_us += parse_us;
+    if (parse_us > st->max_parse_us) st->max_parse_us = parse_us;
 
     if (st->frames > 1) {
         st->last_frame_gap_us = frame_gap_us;
@@ -646,61 +1140,24 @@ static void monitor_update(monitor_stats_t *st,
         }
     }
     st->last_buffer_now = buffer_now;
-
-    if (!show_status) {
-        return;
-    }
-
-    int should_print = 0;
-    if (!st->have_last_print) {
-        should_print = 1;
-    } else {
-        uint32_t since_last = time_diff_us(&st->last_print, &now);
-        if (since_last >= 250000) { // 250 ms
-            should_print = 1;
-        }
-    }
-
-    if (g_force_status_refresh) {
-        should_print = 1;
-        g_force_status_refresh = 0;
-    }
-
-    if (should_print) {
-        print_monitor_status(st, frame_no, buffer_now, cycle_carry, forwarding);
-        st->last_print = now;
-        st->have_last_print = 1;
-    }
 }
+
 static int open_fifo_nonblock(const char *path) {
     int fd = open(path, O_RDONLY | O_NONBLOCK);
     if (fd >= 0) return fd;
     if (errno == ENOENT) {
         if (mkfifo(path, 0666) == 0 || errno == EEXIST) {
-            fd = open(path, O_RDONLY);
+            fd = open(path, O_RDONLY | O_NONBLOCK);
         }
     }
     return fd;
 }
 
-static int open_fifo_blocking(const char *path) {
-    int fd;
-    do {
-        fd = open(path, O_RDONLY);
-    } while (fd < 0 && errno == EINTR && g_running);
-    return fd;
-}
-
 
 static int open_serial(const char *path, speed_t baud) {
     int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
     if (fd < 0) return -1;
 
-    int oflags = fcntl(fd, F_GETFL, 0);
-    if (oflags >= 0) {
-        fcntl(fd, F_SETFL, oflags & ~O_NONBLOCK);
-    }
-
     struct termios tio;
     if (tcgetattr(fd, &tio) == 0) {
         cfmakeraw(&tio);
@@ -722,40 +1179,727 @@ static int open_serial(const char *path, speed_t baud) {
     return fd;
 }
 
+/* Log the events of the complete frame at the ring tail (verbose only). */
+static void log_frame_events(const fifo_ring_t *r, uint32_t count, uint32_t frame_no,
+                             int forwarding, int verbose) {
+    bool frame_delta_warning = false;
+    uint32_t large_delta = 0;
+    uint32_t large_delta_index = 0;
+    size_t off = sizeof(sid_header_t);
+    for (uint32_t i = 0; i < count; ++i, off += sizeof(sid_event_t)) {
+        uint8_t addr = fifo_ring_u8(r, off + offsetof(sid_event_t, addr));
+        uint8_t value = fifo_ring_u8(r, off + offsetof(sid_event_t, value));
+        uint32_t delta = fifo_ring_le32(r, off + offsetof(sid_event_t, delta));
+        if (!frame_delta_warning && delta > PAL_EVENT_DELTA_SANITY) {
+            frame_delta_warning = true;
+            large_delta = delta;
+            large_delta_index = i;
+        }
+        if (verbose > 1) {
+            fprintf(stderr, "  addr=$%02x val=$%02x dt=%u%s\n",
+                    addr & 0x1fu,
+                    value,
+                    delta,
+                    forwarding ? "" : " (not forwarded)");
+        }
+    }
+    if (frame_delta_warning) {
+        fprintf(stderr,
+                "[warn] frame #%u event %u delta %u exceeds sanity limit %u (continuing)\n",
+                frame_no, large_delta_index, large_delta, PAL_EVENT_DELTA_SANITY);
+    }
+}
+
+/* Filter, cycle-clamp and queue the frame at the ring tail for a single
+ * device in one pass. Events go straight from the ring into the device's
+ * send queue; dropped writes fold their delta into the next kept event,
+ * and the header and last delta are patched once the pass is done.
+ * Returns the number of events kept. */
+static uint32_t forward_frame_to_port(serial_port_t *port,
+                                      const fifo_ring_t *r,
+                                      uint32_t frame_no,
+                                      uint32_t count,
+                                      uint64_t arrival_us,
+                                      int verbose,
+                                      uint32_t *frame_cycles_out) {
+    bool filtering = port->voice_mute_mask != 0 || !port->filter_enabled;
+    size_t need = sizeof(sid_header_t) + (size_t)count * sizeof(sid_event_t);
+    bool queued = port->fd >= 0;
+    if (queued && SERIAL_QUEUE_SIZE - serial_queue_used(port) < need) {
+        port->dropped_frames++;
+        queued = false;
+        if (verbose) {
+            fprintf(stderr, "[warn] frame #%u dropped, %s queue full (%zu bytes)\n",
+                    frame_no, port->path, serial_queue_used(port));
+        }
+    }
+
+    uint32_t carry = port->cycle_carry;
+    port->cycle_carry = 0;
+
+    /* The carry from the previous frame rides on the first kept event the
+     * same way a dropped event's delta does. */
+    uint64_t pending = carry;
+    uint64_t spill = 0;
+    uint64_t total_cycles = 0;
+    uint32_t kept = 0;
+    uint32_t last_delta = 0;
+    size_t last_delta_pos = 0;
+    size_t out = port->q_head + sizeof(sid_header_t);
+    size_t in = sizeof(sid_header_t);
+    for (uint32_t i = 0; i < count; ++i, in += sizeof(sid_event_t)) {
+        uint8_t addr = fifo_ring_u8(r, in + offsetof(sid_event_t, addr));
+        uint64_t delta = pending + fifo_ring_le32(r, in + offsetof(sid_event_t, delta));
+        if (filtering && should_drop_sid_event(port, addr)) {
+            pending = delta;
+            continue;
+        }
+        pending = 0;
+        if (delta > UINT32_MAX) {
+            spill += delta - UINT32_MAX;
+            delta = UINT32_MAX;
+        }
+        last_delta = (uint32_t)delta;
+        total_cycles += delta;
+        if (queued) {
+            serial_queue_put_u8(port, out + offsetof(sid_event_t, addr), addr);
+            serial_queue_put_u8(port, out + offsetof(sid_event_t, value),
+                                fifo_ring_u8(r, in + offsetof(sid_event_t, value)));
+            last_delta_pos = out + offsetof(sid_event_t, delta);
+            serial_queue_put_le32(port, last_delta_pos, last_delta);
+            out += sizeof(sid_event_t);
+        }
+        kept++;
+    }
+    if (verbose > 1 && kept != count) {
+        fprintf(stderr, "[info] frame #%u filtered %u -> %u events for %s\n",
+                frame_no, count, kept, port->path ? port->path : "monitor");
+    }
+    if (kept == 0) {
+        total_cycles = carry;
+    }
+    port->cycle_carry = (uint32_t)clamp_u32(spill, PAL_MAX_CYCLE_CARRY);
+
+    uint32_t max_cycles = PAL_CYCLES_PER_FRAME + PAL_FRAME_TOLERANCE;
+    if (kept > 0 && total_cycles > max_cycles) {
+        uint64_t overflow = total_cycles - max_cycles;
+        uint32_t reduction = (overflow > UINT32_MAX) ? UINT32_MAX : (uint32_t)overflow;
+        if (reduction >= last_delta) {
+            reduction = (last_delta > 0) ? (last_delta - 1u) : 0u;
+        }
+        if (reduction > 0) {
+            last_delta -= reduction;
+            if (queued) {
+                serial_queue_put_le32(port, last_delta_pos, last_delta);
+            }
+            total_cycles -= reduction;
+            port->cycle_carry += reduction;
+            if (verbose && reduction >= PAL_OVERFLOW_WARN_THRESHOLD) {
+                fprintf(stderr, "[warn] frame #%u overflow %u cycles, clamped\n",
+                        frame_no, reduction);
+            }
+        } else {
+            if (overflow > 0 && port->cycle_carry < PAL_MAX_CYCLE_CARRY) {
+                uint32_t extra = (overflow > UINT32_MAX) ? UINT32_MAX : (uint32_t)overflow;
+                port->cycle_carry += extra;
+            }
+        }
+    }
+
+    if (total_cycles < PAL_CYCLES_PER_FRAME) {
+        uint32_t deficit = (uint32_t)(PAL_CYCLES_PER_FRAME - total_cycles);
+        port->cycle_carry += deficit;
+    }
+
+    if (port->cycle_carry > PAL_MAX_CYCLE_CARRY) {
+        port->cycle_carry = PAL_MAX_CYCLE_CARRY;
+    }
+
+    /* The header is rebuilt so its count matches the filtered event list. */
+    if (queued) {
+        size_t h = port->q_head;
+        serial_queue_put_le32(port, h + offsetof(sid_header_t, magic), SID_MAGIC);
+        serial_queue_put_u8(port, h + offsetof(sid_header_t, count), (uint8_t)kept);
+        serial_queue_put_u8(port, h + offsetof(sid_header_t, count) + 1, (uint8_t)(kept >> 8));
+        serial_queue_put_le32(port, h + offsetof(sid_header_t, frame), frame_no);
+        port->q_head = out;
+        serial_queue_mark(port, arrival_us);
+    }
+
+    *frame_cycles_out = (total_cycles > UINT32_MAX) ? UINT32_MAX : (uint32_t)total_cycles;
+    return kept;
+}
+
+/* Fan the complete frame at the ring tail out to every device. The
+ * monitor follows the first device. `parse_start_us` is when handling of
+ * this frame began. */
+static void forward_frame(const fifo_ring_t *r,
+                          uint32_t frame_no,
+                          uint32_t count,
+                          const struct timeval *frame_start,
+                          uint64_t arrival_us,
+                          uint64_t parse_start_us,
+                          int fifo_fd,
+                          int verbose) {
+    static uint64_t prev_arrival_us = 0;
+
+    if (prev_arrival_us != 0 && arrival_us >= prev_arrival_us) {
+        hist_record(&g_gap_hist, (uint32_t)clamp_u32(arrival_us - prev_arrival_us, UINT32_MAX));
+    }
+    prev_arrival_us = arrival_us;
+
+    if (verbose) {
+        fprintf(stderr, "[frame] #%u events=%u\n", frame_no, count);
+        log_frame_events(r, count, frame_no, g_ports[0].fd >= 0, verbose);
+    }
+    g_stats.frames++;
+
+    uint32_t kept0 = 0;
+    uint32_t cycles0 = 0;
+    for (size_t i = 0; i < g_port_count; ++i) {
+        uint32_t cycles = 0;
+        uint32_t kept = forward_frame_to_port(&g_ports[i], r, frame_no, count, arrival_us,
+                                              verbose, &cycles);
+        if (i == 0) {
+            kept0 = kept;
+            cycles0 = cycles;
+        }
+    }
+    g_stats.events += kept0;
+
+    uint32_t frame_bytes = (uint32_t)(sizeof(sid_header_t) + kept0 * sizeof(sid_event_t));
+    hist_record(&g_frame_bytes_hist, frame_bytes);
+    uint32_t parse_us = (uint32_t)clamp_u32(monotonic_us() - parse_start_us, UINT32_MAX);
+    monitor_update(&g_monitor,
+                   frame_no,
+                   kept0,
+                   frame_bytes,
+                   cycles0,
+                   g_ports[0].cycle_carry,
+                   frame_start,
+                   parse_us,
+                   g_ports[0].fd >= 0,
+                   fifo_fd);
+}
+
+#define FIFO_OPEN_RETRY_MS 1000
+#define FIFO_IDLE_RETRY_MS 100
+#define STATUS_REFRESH_MS 250
+#define SHUTDOWN_DRAIN_MS 250
+
+typedef struct {
+    const char *path;
+    int fd;
+    int connected;
+    uint64_t retry_ms;
+} fifo_input_t;
+
+static void fifo_input_close(fifo_input_t *in, uint64_t retry_ms) {
+    if (in->fd >= 0) {
+        close(in->fd);
+    }
+    in->fd = -1;
+    in->connected = 0;
+    in->retry_ms = retry_ms;
+}
+
+static void fifo_session_begin(void) {
+    memset(&g_monitor, 0, sizeof(g_monitor));
+    g_monitor.prev_read_ops = g_fifo_read_ops;
+    for (size_t i = 0; i < g_port_count; ++i) {
+        g_ports[i].cycle_carry = 0;
+    }
+    g_print_help_hint = 1;
+}
+
+/* Session capture (-r) and replay (-p). A capture is an 8-byte file
+ * header followed by one record per frame: the le32 host arrival gap in
+ * microseconds since the previous frame, then the frame exactly as it
+ * came off the FIFO (header plus events). */
+#define CAPTURE_MAGIC 0x43525453u  /* "STRC" */
+#define CAPTURE_VERSION 1u
+#define CAPTURE_HEADER_SIZE 8u
+#define REPLAY_DEFAULT_LOOKAHEAD_MS 100u
+
+typedef enum {
+    REPLAY_AS_RECORDED = 0,  /* reproduce the recorded arrival gaps */
+    REPLAY_BY_CYCLES,        /* regulate by the frames' cycle deltas */
+    REPLAY_FAST              /* as fast as the devices accept */
+} replay_timing_t;
+
+typedef struct {
+    FILE *fp;
+    uint64_t prev_arrival_us;
+    unsigned long long frames;
+} capture_out_t;
+
+typedef struct {
+    const char *path;
+    FILE *fp;
+    replay_timing_t timing;
+    int started;
+    int done;
+    int have_gap;
+    uint32_t gap_us;
+    uint64_t origin_us;
+    uint64_t recorded_us;
+    size_t pending_len;       /* frame read from the capture, not yet fed */
+    uint64_t hash;            /* FNV-1a of the frames fed so far */
+    unsigned long long bytes;
+    unsigned long long frames;
+} replay_input_t;
+
+static capture_out_t g_capture = {0};
+
+static void put_le16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int capture_open(capture_out_t *cap, const char *path) {
+    cap->fp = fopen(path, "wb");
+    if (!cap->fp) {
+        return -1;
+    }
+    uint8_t hdr[CAPTURE_HEADER_SIZE];
+    put_le32(hdr, CAPTURE_MAGIC);
+    put_le16(hdr + 4, CAPTURE_VERSION);
+    put_le16(hdr + 6, 0);
+    if (fwrite(hdr, 1, sizeof hdr, cap->fp) != sizeof hdr) {
+        fclose(cap->fp);
+        cap->fp = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static void capture_close(capture_out_t *cap) {
+    if (!cap->fp) return;
+    if (fclose(cap->fp) != 0) {
+        perror("capture");
+    }
+    cap->fp = NULL;
+    fprintf(stderr, "[info] captured %llu frames\n", cap->frames);
+}
+
+/* Append the frame of `len` bytes at the ring tail. */
+static void capture_frame(capture_out_t *cap, const fifo_ring_t *r, size_t len, uint64_t arrival_us) {
+    if (!cap->fp) return;
+    uint32_t gap = 0;
+    if (cap->frames > 0 && arrival_us >= cap->prev_arrival_us) {
+        gap = (uint32_t)clamp_u32(arrival_us - cap->prev_arrival_us, UINT32_MAX);
+    }
+    cap->prev_arrival_us = arrival_us;
+    uint8_t rec[4];
+    put_le32(rec, gap);
+    size_t idx = r->tail & FIFO_RING_MASK;
+    size_t first = FIFO_RING_SIZE - idx;
+    if (first > len) first = len;
+    if (fwrite(rec, 1, sizeof rec, cap->fp) != sizeof rec ||
+        fwrite(r->data + idx, 1, first, cap->fp) != first ||
+        fwrite(r->data, 1, len - first, cap->fp) != len - first) {
+        perror("capture");
+        fclose(cap->fp);
+        cap->fp = NULL;
+        return;
+    }
+    cap->frames++;
+}
+
+/* Cycles a frame stands for: the sum of its deltas when that looks like a
+ * PAL frame, otherwise one nominal frame (empty or clamped frames still
+ * take a frame's worth of time on the device). */
+static uint32_t frame_schedule_cycles(const fifo_ring_t *r, size_t off, uint32_t count) {
+    uint64_t cycles = 0;
+    size_t ev = off + sizeof(sid_header_t) + offsetof(sid_event_t, delta);
+    for (uint32_t i = 0; i < count; ++i, ev += sizeof(sid_event_t)) {
+        cycles += fifo_ring_le32(r, ev);
+    }
+    if (cycles + PAL_FRAME_TOLERANCE < PAL_CYCLES_PER_FRAME ||
+        cycles > PAL_CYCLES_PER_FRAME + PAL_FRAME_TOLERANCE) {
+        return PAL_CYCLES_PER_FRAME;
+    }
+    return (uint32_t)cycles;
+}
+
+/* Index the complete frames that arrived since the last scan. With
+ * nothing held, bytes that cannot start a frame are dropped right away so
+ * a stream without magic cannot fill the ring and stall FIFO reads. */
+static void regulator_scan(frame_regulator_t *reg, fifo_ring_t *r, int verbose) {
+    while (regulator_held(reg) < reg->capacity) {
+        size_t from = reg->scan - r->tail;
+        size_t start = 0;
+        uint32_t count = 0;
+        uint32_t frame_no = 0;
+        size_t len = fifo_ring_find_frame(r, from, &start, &count, &frame_no);
+        if (len == 0) {
+            if (regulator_held(reg) == 0 && start > 0) {
+                if (verbose) {
+                    fprintf(stderr, "[warn] skipped %zu bytes without magic, resync\n", start);
+                }
+                g_stats.resync_bytes += start;
+                r->tail += start;
+                reg->scan = r->tail;
+            }
+            break;
+        }
+        pending_frame_t *pf = &reg->frames[reg->head % reg->capacity];
+        pf->skip = start - from;
+        pf->len = len;
+        pf->count = count;
+        pf->frame_no = frame_no;
+        pf->cycles = reg->enabled ? frame_schedule_cycles(r, start, count) : PAL_CYCLES_PER_FRAME;
+        pf->arrival_us = r->last_fill_us;
+        pf->arrival = r->last_fill;
+        reg->head++;
+        reg->scan = r->tail + start + len;
+        reg->held_cycles += pf->cycles;
+        if (regulator_held(reg) > reg->peak) {
+            reg->peak = regulator_held(reg);
+        }
+    }
+}
+
+/* Forward every indexed frame that is due. Returns the time in ms until
+ * the next one is, or -1 if nothing is waiting. */
+static int regulator_release(frame_regulator_t *reg, fifo_ring_t *r, int fifo_fd, int verbose) {
+    uint64_t lookahead_us = (uint64_t)reg->lookahead_ms * 1000ull;
+    while (regulator_held(reg) > 0 && g_running) {
+        pending_frame_t *pf = &reg->frames[reg->tail % reg->capacity];
+        if (reg->enabled) {
+            uint64_t now_us = monotonic_us();
+            if (!reg->anchored) {
+                reg->anchored = 1;
+                reg->origin_us = now_us;
+                reg->released_cycles = 0;
+            }
+            int64_t ahead = regulator_ahead_us(reg, now_us);
+            if (ahead < 0) {
+                /* The device has run dry: restart the schedule from now
+                 * instead of bursting to catch up. */
+                reg->underruns++;
+                reg->origin_us = now_us - reg->released_cycles * 1000000ull / PAL_CLOCK_HZ;
+            } else if ((uint64_t)ahead > lookahead_us) {
+                return (int)((ahead - (int64_t)lookahead_us + 999) / 1000);
+            }
+        }
+        if (pf->skip && verbose) {
+            fprintf(stderr, "[warn] skipped %zu bytes without magic, resync\n", pf->skip);
+        }
+        g_stats.resync_bytes += pf->skip;
+        r->tail += pf->skip;
+        uint64_t parse_start_us = monotonic_us();
+        capture_frame(&g_capture, r, pf->len, pf->arrival_us);
+        forward_frame(r, pf->frame_no, pf->count, &pf->arrival,
+                      pf->arrival_us, parse_start_us, fifo_fd, verbose);
+        r->tail += pf->len;
+        reg->tail++;
+        reg->held_cycles -= pf->cycles;
+        reg->released_cycles += pf->cycles;
+    }
+    return -1;
+}
+
+/* Read what the FIFO has, index complete frames and handle the writer
+ * going away. Frames already indexed are still played out after EOF.
+ * Returns -1 on a fatal read error. */
+static int service_fifo(fifo_input_t *in, int verbose, uint64_t now) {
+    size_t before = fifo_ring_used(&g_fifo_ring);
+    if (fifo_ring_fill(&g_fifo_ring, in->fd) < 0) {
+        perror("read fifo");
+        return -1;
+    }
+    if (!in->connected && fifo_ring_used(&g_fifo_ring) > before) {
+        in->connected = 1;
+        fifo_session_begin();
+    }
+    regulator_scan(&g_regulator, &g_fifo_ring, verbose);
+    regulator_release(&g_regulator, &g_fifo_ring, in->fd, verbose);
+
+    if (g_fifo_ring.eof) {
+        if (in->connected) {
+            if (verbose) {
+                fprintf(stderr, "[info] fifo writer closed\n");
+            }
+            fifo_input_close(in, now);
+        } else {
+            /* Some platforms report EOF before any writer has attached;
+             * back off instead of spinning on it. */
+            fifo_input_close(in, now + FIFO_IDLE_RETRY_MS);
+        }
+        g_fifo_ring.eof = 0;
+    }
+    return 0;
+}
+
+static int replay_open(replay_input_t *rp) {
+    rp->fp = fopen(rp->path, "rb");
+    if (!rp->fp) {
+        return -1;
+    }
+    uint8_t hdr[CAPTURE_HEADER_SIZE];
+    if (fread(hdr, 1, sizeof hdr, rp->fp) != sizeof hdr || get_le32(hdr) != CAPTURE_MAGIC) {
+        fprintf(stderr, "sidtap2serial: %s is not a sidtap2serial capture\n", rp->path);
+        return -1;
+    }
+    if ((uint16_t)(hdr[4] | (hdr[5] << 8)) != CAPTURE_VERSION) {
+        fprintf(stderr, "sidtap2serial: %s: unsupported capture version %u\n",
+                rp->path, (unsigned)(hdr[4] | (hdr[5] << 8)));
+        return -1;
+    }
+    return 0;
+}
+
+static void fifo_ring_push(fifo_ring_t *r, const uint8_t *src, size_t len) {
+    while (len > 0) {
+        size_t idx = r->head & FIFO_RING_MASK;
+        size_t chunk = FIFO_RING_SIZE - idx;
+        if (chunk > len) chunk = len;
+        memcpy(r->data + idx, src, chunk);
+        r->head += chunk;
+        src += chunk;
+        len -= chunk;
+    }
+}
+
+/* True while every open device has room for more replayed frames. */
+static bool replay_devices_ready(void) {
+    for (size_t i = 0; i < g_port_count; ++i) {
+        if (g_ports[i].fd >= 0 && serial_queue_used(&g_ports[i]) > SERIAL_QUEUE_SIZE / 4) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Bytes that can still be fed without any device dropping a frame. Every
+ * byte in the ring is forwarded at the next release and forwarding never
+ * grows a frame, so the ring must fit in the fullest device queue. */
+static size_t replay_room(void) {
+    size_t room = SERIAL_QUEUE_SIZE;
+    for (size_t i = 0; i < g_port_count; ++i) {
+        if (g_ports[i].fd >= 0) {
+            size_t free_bytes = SERIAL_QUEUE_SIZE - serial_queue_used(&g_ports[i]);
+            if (free_bytes < room) room = free_bytes;
+        }
+    }
+    size_t used = fifo_ring_used(&g_fifo_ring);
+    return room > used ? room - used : 0;
+}
+
+/* Move due frames from the capture into the FIFO ring, where they take
+ * the same path as live input. A frame that would not fit in every
+ * device queue stays pending until they drain. Returns the ms until the
+ * next frame is due, or -1 when not waiting on the clock. */
+static int replay_feed(replay_input_t *rp, int verbose) {
+    static uint8_t frame[sizeof(sid_header_t) + 0xFFFFu * sizeof(sid_event_t)];
+    if (!rp->started) {
+        rp->started = 1;
+        rp->origin_us = monotonic_us();
+        rp->hash = FNV64_OFFSET;
+        fifo_session_begin();
+    }
+    while (!rp->done && g_running &&
+           regulator_held(&g_regulator) < g_regulator.capacity &&
+           FIFO_RING_SIZE - fifo_ring_used(&g_fifo_ring) >= sizeof frame) {
+        if (!rp->pending_len) {
+            if (!rp->have_gap) {
+                uint8_t rec[4];
+                if (fread(rec, 1, sizeof rec, rp->fp) != sizeof rec) {
+                    rp->done = 1;
+                    break;
+                }
+                rp->gap_us = get_le32(rec);
+                rp->have_gap = 1;
+            }
+            uint64_t now_us = monotonic_us();
+            if (rp->timing == REPLAY_AS_RECORDED) {
+                uint64_t due = rp->origin_us + rp->recorded_us + rp->gap_us;
+                if (due > now_us) {
+                    return (int)((due - now_us + 999) / 1000);
+                }
+            } else if (rp->timing == REPLAY_FAST && !replay_devices_ready()) {
+                return -1;
+            }
+            if (fread(frame, 1, sizeof(sid_header_t), rp->fp) != sizeof(sid_header_t) ||
+                get_le32(frame + offsetof(sid_header_t, magic)) != SID_MAGIC) {
+                fprintf(stderr, "[warn] %s: corrupt record after %llu frames, stopping\n",
+                        rp->path, rp->frames);
+                rp->done = 1;
+                break;
+            }
+            size_t count = (size_t)(frame[offsetof(sid_header_t, count)] |
+                                    (frame[offsetof(sid_header_t, count) + 1] << 8));
+            size_t len = sizeof(sid_header_t) + count * sizeof(sid_event_t);
+            if (fread(frame + sizeof(sid_header_t), 1, len - sizeof(sid_header_t), rp->fp) !=
+                len - sizeof(sid_header_t)) {
+                if (verbose) {
+                    fprintf(stderr, "[warn] %s: truncated last frame\n", rp->path);
+                }
+                rp->done = 1;
+                break;
+            }
+            rp->recorded_us += rp->gap_us;
+            rp->have_gap = 0;
+            rp->pending_len = len;
+        }
+        if (rp->pending_len > replay_room()) {
+            return -1;
+        }
+        fifo_ring_push(&g_fifo_ring, frame, rp->pending_len);
+        g_stats.fifo_bytes += rp->pending_len;
+        gettimeofday(&g_fifo_ring.last_fill, NULL);
+        g_fifo_ring.last_fill_us = monotonic_us();
+        rp->hash = fnv1a64(rp->hash, frame, rp->pending_len);
+        rp->bytes += rp->pending_len;
+        rp->pending_len = 0;
+        rp->frames++;
+        regulator_scan(&g_regulator, &g_fifo_ring, verbose);
+    }
+    if (rp->done && rp->fp) {
+        fclose(rp->fp);
+        rp->fp = NULL;
+        if (verbose) {
+            fprintf(stderr, "[info] replay finished after %llu frames\n", rp->frames);
+        }
+    }
+    return -1;
+}
+
+/* After a complete replay, check that each device was sent the capture
+ * byte for byte. Filtering, clamping and key commands legitimately change
+ * the stream; a dropped frame is an error. Returns nonzero on loss. */
+static int replay_report(const replay_input_t *rp) {
+    int rc = 0;
+    for (size_t i = 0; i < g_port_count; ++i) {
+        const serial_port_t *port = &g_ports[i];
+        if (!port->path) continue;
+        if (port->dropped_frames) {
+            fprintf(stderr, "[error] replay: %s dropped %llu frames\n",
+                    port->path, port->dropped_frames);
+            rc = 1;
+        } else if (port->out_bytes == rp->bytes && port->out_hash == rp->hash) {
+            fprintf(stderr, "[info] replay: %s got all %llu capture bytes unchanged\n",
+                    port->path, rp->bytes);
+        } else {
+            fprintf(stderr, "[info] replay: %s got %llu bytes for %llu capture bytes "
+                    "(filtered, clamped or commands sent)\n",
+                    port->path, port->out_bytes, rp->bytes);
+        }
+    }
+    return rc;
+}
+
+/* True once every open device has written out its queue. */
+static bool replay_devices_idle(void) {
+    for (size_t i = 0; i < g_port_count; ++i) {
+        if (g_ports[i].fd >= 0 && serial_queue_used(&g_ports[i]) > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void close_capture(void) {
+    capture_close(&g_capture);
+}
+
 static void print_usage(const char *prog) {
     fprintf(stderr,
-            "Usage: %s [-i <fifo>] [-f <serial_dev>] [-b <baud>] [-v|-vv|-vvv]\n"
+            "Usage: %s [-i <fifo> | -p <capture> [-T <timing>]] [-f <serial_dev>]... [-b <baud>]\n"
+            "          [-r <capture>] [-H <file>] [-L <ms> [-B <n>]] [-v|-vv|-vvv]\n"
             "  -i <fifo>  Input FIFO (default %s)\n"
-            "  -f <dev>   Forward events to serial CDC device\n"
+            "  -r <file>  Record every frame with its host arrival time to a capture file\n"
+            "  -p <file>  Replay a capture instead of reading the FIFO\n"
+            "  -T <mode>  Replay timing: recorded (default), cycles (real time by frame cycles), fast\n"
+            "  -f <dev>   Forward events to serial CDC device (repeat to fan out, max %d)\n"
             "  -b <baud>  Serial baud (default 2000000, ignored for USB CDC)\n"
+            "  -H <file>  Write latency/jitter histogram buckets as CSV on exit\n"
+            "  -L <ms>    Regulate: release frames in real time, at most <ms> ahead of playback\n"
+            "  -B <n>     Frames the regulator may hold before FIFO reads pause (default %u)\n"
             "  -v         Verbose (frame summaries)\n"
             "  -vv        Very verbose (events)\n"
             "  -vvv       Event dump plus hexdump\n"
-            "  -s         Live status view (n/p switch screen, 1-3/0 voices, F filter, M mode, q quit)\n",
-            prog, DEFAULT_FIFO);
+            "  -s         Live status view (n/p switch screen, d device, 1-3/0 voices, F filter, M mode, q quit)\n",
+            prog, DEFAULT_FIFO, MAX_SERIAL_PORTS, REG_DEFAULT_FRAMES);
 }
 
 int main(int argc, char **argv) {
     const char *fifo_path = DEFAULT_FIFO;
-    const char *serial_path = NULL;
+    const char *serial_paths[MAX_SERIAL_PORTS];
+    size_t serial_path_count = 0;
     int verbose = 0;
     int show_status = 0;
     speed_t baud = B2000000;
 
     int opt;
-    while ((opt = getopt(argc, argv, "i:f:b:vhs")) != -1) {
+    uint32_t lookahead_ms = 0;
+    size_t regulator_frames = REG_DEFAULT_FRAMES;
+    const char *capture_path = NULL;
+    replay_input_t replay = {.path = NULL, .timing = REPLAY_AS_RECORDED};
+    while ((opt = getopt(argc, argv, "i:f:b:r:p:T:H:L:B:vhs")) != -1) {
         switch (opt) {
             case 'i':
                 fifo_path = optarg;
                 break;
             case 'f':
-                serial_path = optarg;
+                if (serial_path_count >= MAX_SERIAL_PORTS) {
+                    fprintf(stderr, "sidtap2serial: at most %d -f devices\n", MAX_SERIAL_PORTS);
+                    return 1;
+                }
+                serial_paths[serial_path_count++] = optarg;
                 break;
             case 'b': {
                 long val = strtol(optarg, NULL, 10);
                 baud = (val >= 2000000) ? B2000000 : B115200;
                 break;
             }
+            case 'r':
+                capture_path = optarg;
+                break;
+            case 'p':
+                replay.path = optarg;
+                break;
+            case 'T':
+                if (strcmp(optarg, "recorded") == 0) {
+                    replay.timing = REPLAY_AS_RECORDED;
+                } else if (strcmp(optarg, "cycles") == 0) {
+                    replay.timing = REPLAY_BY_CYCLES;
+                } else if (strcmp(optarg, "fast") == 0) {
+                    replay.timing = REPLAY_FAST;
+                } else {
+                    fprintf(stderr, "sidtap2serial: unknown replay timing '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'H':
+                g_hist_dump_path = optarg;
+                break;
+            case 'L':
+                lookahead_ms = (uint32_t)strtoul(optarg, NULL, 10);
+                if (lookahead_ms == 0) {
+                    fprintf(stderr, "sidtap2serial: -L needs a lookahead > 0 ms\n");
+                    return 1;
+                }
+                break;
+            case 'B':
+                regulator_frames = (size_t)strtoul(optarg, NULL, 10);
+                if (regulator_frames == 0) {
+                    fprintf(stderr, "sidtap2serial: -B needs at least one frame\n");
+                    return 1;
+                }
+                break;
             case 'v':
                 verbose++;
                 break;
@@ -769,7 +1913,34 @@ int main(int argc, char **argv) {
         }
     }
 
-    reset_screen_cache();
+    /* Cycle-timed replay is the regulator; a fast replay must not be. */
+    if (replay.path && replay.timing == REPLAY_BY_CYCLES && lookahead_ms == 0) {
+        lookahead_ms = REPLAY_DEFAULT_LOOKAHEAD_MS;
+    } else if (replay.path && replay.timing == REPLAY_FAST) {
+        lookahead_ms = 0;
+    }
+    g_regulator.enabled = lookahead_ms > 0;
+    g_regulator.lookahead_ms = lookahead_ms;
+    g_regulator.capacity = g_regulator.enabled ? regulator_frames : REG_UNREGULATED_FRAMES;
+    g_regulator.frames = (pending_frame_t *)calloc(g_regulator.capacity, sizeof(pending_frame_t));
+    if (!g_regulator.frames) {
+        fprintf(stderr, "sidtap2serial: out of memory\n");
+        return 1;
+    }
+
+    g_port_count = serial_path_count ? serial_path_count : 1;
+    g_ports = (serial_port_t *)calloc(g_port_count, sizeof(*g_ports));
+    if (!g_ports) {
+        fprintf(stderr, "sidtap2serial: out of memory\n");
+        return 1;
+    }
+    for (size_t i = 0; i < g_port_count; ++i) {
+        g_ports[i].path = serial_path_count ? serial_paths[i] : NULL;
+        g_ports[i].fd = -1;
+        g_ports[i].filter_enabled = true;
+        g_ports[i].out_hash = FNV64_OFFSET;
+        reset_screen_cache(&g_ports[i]);
+    }
 
     if (show_status) {
         g_stdout_is_tty = isatty(STDOUT_FILENO);
@@ -824,261 +1995,211 @@ int main(int argc, char **argv) {
     }
 
     if (g_keyboard_enabled) {
-        fprintf(stderr, "[info] keyboard controls: 1-3 toggle voices, 0 enable all, F filter, M cycle SID mode, q quit.\n");
+        fprintf(stderr, "[info] keyboard controls: 1-3 toggle voices, 0 enable all, F filter, M cycle SID mode, d select device, q quit.\n");
     }
 
-    int serial_fd = -1;
-    if (serial_path) {
-        serial_fd = open_serial(serial_path, baud);
-        if (serial_fd < 0) {
-            perror("open serial");
-            return 1;
+    if (replay.path && replay_open(&replay) < 0) {
+        if (replay.fp == NULL) {
+            fprintf(stderr, "open %s: %s\n", replay.path, strerror(errno));
         }
-        fprintf(stderr, "sidtap2serial: streaming %s -> %s\n", fifo_path, serial_path);
-    } else {
-        fprintf(stderr, "sidtap2serial: watching %s (no forwarding)\n", fifo_path);
+        return 1;
     }
-    g_serial_fd = serial_fd;
-
-    while (g_running) {
-        pump_serial_input(serial_fd, show_status);
-        handle_local_input(show_status);
-
-        int fifo_fd = open_fifo_nonblock(fifo_path);
-        if (fifo_fd < 0) {
-            perror("open fifo");
-            sleep(1);
-            continue;
-        }
-
-        uint8_t flush_buf[256];
-        ssize_t drained = 0;
-        while ((drained = read(fifo_fd, flush_buf, sizeof(flush_buf))) > 0) {
-            if (!g_running) break;
+    if (capture_path) {
+        if (capture_open(&g_capture, capture_path) < 0) {
+            fprintf(stderr, "open %s: %s\n", capture_path, strerror(errno));
+            return 1;
         }
-        close(fifo_fd);
-        if (!g_running) break;
+        atexit(close_capture);
+    }
+    const char *source = replay.path ? replay.path : fifo_path;
 
-        if (verbose) {
-            fprintf(stderr, "[info] waiting for fifo writer...\n");
+    for (size_t i = 0; i < serial_path_count; ++i) {
+        g_ports[i].fd = open_serial(g_ports[i].path, baud);
+        if (g_ports[i].fd < 0) {
+            fprintf(stderr, "open serial %s: %s\n", g_ports[i].path, strerror(errno));
+            return 1;
         }
+        fprintf(stderr, "sidtap2serial: streaming %s -> %s\n", source, g_ports[i].path);
+    }
+    if (serial_path_count == 0) {
+        fprintf(stderr, "sidtap2serial: watching %s (no forwarding)\n", source);
+    }
 
-        fifo_fd = open_fifo_blocking(fifo_path);
-        if (fifo_fd < 0) {
-            if (!g_running) break;
-            perror("open fifo");
-            sleep(1);
-            continue;
+    if (show_status) {
+        int flags = fcntl(STDOUT_FILENO, F_GETFL, 0);
+        if (flags >= 0 && fcntl(STDOUT_FILENO, F_SETFL, flags | O_NONBLOCK) == 0) {
+            g_stdout_saved_flags = flags;
+            if (!g_stdin_termios_saved) {
+                atexit(restore_terminal);
+            }
         }
+    }
 
-        memset(&g_monitor, 0, sizeof(g_monitor));
-        g_monitor.prev_read_ops = g_fifo_read_ops;
-        g_monitor.have_last_frame_end = 0;
-        g_monitor.have_last_print = 0;
-        g_cycle_carry = 0;
-        g_print_help_hint = 1;
-
-        while (g_running) {
-            pump_serial_input(serial_fd, show_status);
-            handle_local_input(show_status);
+    /* One poll() loop services the FIFO, every serial device in both
+     * directions, the keyboard and the status view by readiness. */
+    fifo_input_t fifo = {.path = fifo_path, .fd = -1, .connected = 0, .retry_ms = 0};
+    uint64_t next_status_ms = 0;
 
-            sid_header_t hdr;
-            ssize_t n = read_exact(fifo_fd, &hdr, sizeof(hdr));
-            if (n == 0) {
-                if (verbose) {
-                    fprintf(stderr, "[info] fifo writer closed\n");
+    while (g_running) {
+        uint64_t now = monotonic_ms();
+
+        /* Frames the regulator had no room for are still in the ring
+         * after the writer left; keep indexing them as it drains. */
+        regulator_scan(&g_regulator, &g_fifo_ring, verbose);
+
+        /* A new writer starts a new session, so frames still held from
+         * the previous one are played out first. */
+        if (!replay.path && fifo.fd < 0 && now >= fifo.retry_ms &&
+            regulator_held(&g_regulator) == 0) {
+            fifo.fd = open_fifo_nonblock(fifo.path);
+            if (fifo.fd < 0) {
+                perror("open fifo");
+                fifo.retry_ms = now + FIFO_OPEN_RETRY_MS;
+            } else {
+                size_t leftover = g_fifo_ring.head - g_regulator.scan;
+                if (verbose && leftover > 0) {
+                    fprintf(stderr, "[warn] truncated frame (%zu bytes left at EOF)\n", leftover);
                 }
-                close(fifo_fd);
-                fifo_fd = -1;
-                break;
-            }
-            if (n < 0) {
-                perror("read header");
-                break;
-            }
-
-            uint32_t magic = le32_to_host(hdr.magic);
-            if (magic != SID_MAGIC) {
+                fifo_ring_reset(&g_fifo_ring);
+                regulator_reset(&g_regulator);
                 if (verbose) {
-                    fprintf(stderr, "[warn] bad magic 0x%08x, resync\n", magic);
-                }
-                continue;
-            }
-
-            sid_header_t raw_hdr = hdr;
-            uint32_t count = le16_to_host(hdr.count);
-            uint32_t frame_no = le32_to_host(hdr.frame);
-            struct timeval frame_start;
-            gettimeofday(&frame_start, NULL);
-
-            sid_event_t *events = NULL;
-            if (count > 0) {
-                events = (sid_event_t *)malloc(count * sizeof(*events));
-                if (!events) {
-                    fprintf(stderr, "[error] malloc failed for %u events\n", count);
-                    g_running = 0;
-                    break;
+                    fprintf(stderr, "[info] waiting for fifo writer...\n");
                 }
             }
+        }
 
-            uint32_t processed = 0;
-            bool frame_delta_warning = false;
-            uint32_t large_delta = 0;
-            uint32_t large_delta_index = 0;
-            for (; processed < count && g_running; ++processed) {
-                sid_event_t raw_ev;
-                if (read_exact(fifo_fd, &raw_ev, sizeof(raw_ev)) <= 0) {
-                    g_running = 0;
-                    break;
-                }
-                events[processed] = raw_ev;
-                events[processed].delta = le32_to_host(raw_ev.delta);
-                if (!frame_delta_warning && events[processed].delta > PAL_EVENT_DELTA_SANITY) {
-                    frame_delta_warning = true;
-                    large_delta = events[processed].delta;
-                    large_delta_index = processed;
-                }
-                if (verbose > 1) {
-                    fprintf(stderr, "  addr=$%02x val=$%02x dt=%u%s\n",
-                            events[processed].addr & 0x1fu,
-                            events[processed].value,
-                            events[processed].delta,
-                            serial_fd >= 0 ? "" : " (not forwarded)");
-                }
-            }
+        if (show_status && !status_pending() &&
+            (g_force_status_refresh || now >= next_status_ms)) {
+            print_monitor_status(&g_monitor);
+            g_force_status_refresh = 0;
+            next_status_ms = now + STATUS_REFRESH_MS;
+        }
 
-            if (!g_running) {
-                free(events);
+        int feed_ms = -1;
+        if (replay.path) {
+            feed_ms = replay_feed(&replay, verbose);
+            if (replay.done && regulator_held(&g_regulator) == 0 && replay_devices_idle()) {
                 break;
             }
+        }
+        int release_ms = regulator_release(&g_regulator, &g_fifo_ring, fifo.fd, verbose);
+        if (release_ms < 0 && fifo.fd < 0 && g_regulator.anchored) {
+            g_regulator.anchored = 0;
+        }
 
-            if (processed != count) {
-                if (verbose) {
-                    fprintf(stderr, "[warn] truncated frame #%u (%u/%u events)\n",
-                            frame_no, processed, count);
-                }
-                free(events);
-                continue;
-            }
-
-            if (frame_delta_warning && verbose) {
-                fprintf(stderr,
-                        "[warn] frame #%u event %u delta %u exceeds sanity limit %u (continuing)\n",
-                        frame_no, large_delta_index, large_delta, PAL_EVENT_DELTA_SANITY);
-            }
-
-            uint32_t original_count = count;
-            count = apply_voice_filtering(events, count);
-            if (verbose > 1 && original_count != count) {
-                fprintf(stderr, "[info] frame #%u filtered %u -> %u events\n",
-                        frame_no, original_count, count);
-            }
-            if (verbose) {
-                fprintf(stderr, "[frame] #%u events=%u\n", frame_no, count);
-            }
+        struct pollfd pfds[3 + MAX_SERIAL_PORTS];
+        int serial_idx[MAX_SERIAL_PORTS];
+        nfds_t nfds = 0;
+        int fifo_idx = -1, stdin_idx = -1, stdout_idx = -1;
+        /* Stop reading while the ring or the regulator is full; the
+         * writer then blocks on the FIFO instead of overrunning us. */
+        if (fifo.fd >= 0 && fifo_ring_used(&g_fifo_ring) < FIFO_RING_SIZE &&
+            regulator_held(&g_regulator) < g_regulator.capacity) {
+            fifo_idx = (int)nfds;
+            pfds[nfds++] = (struct pollfd){.fd = fifo.fd, .events = POLLIN};
+        }
+        for (size_t i = 0; i < g_port_count; ++i) {
+            serial_port_t *port = &g_ports[i];
+            serial_idx[i] = -1;
+            if (port->fd < 0) continue;
+            serial_idx[i] = (int)nfds;
+            pfds[nfds++] = (struct pollfd){
+                .fd = port->fd,
+                .events = (short)(POLLIN | (serial_queue_used(port) ? POLLOUT : 0))
+            };
+        }
+        if (g_keyboard_enabled) {
+            stdin_idx = (int)nfds;
+            pfds[nfds++] = (struct pollfd){.fd = STDIN_FILENO, .events = POLLIN};
+        }
+        if (status_pending()) {
+            stdout_idx = (int)nfds;
+            pfds[nfds++] = (struct pollfd){.fd = STDOUT_FILENO, .events = POLLOUT};
+        }
 
-            g_stats.frames++;
-            g_stats.events += count;
+        int timeout = -1;
+        if (show_status) {
+            timeout = ms_until(next_status_ms, now);
+        }
+        if (!replay.path && fifo.fd < 0 && regulator_held(&g_regulator) == 0) {
+            int retry = ms_until(fifo.retry_ms, now);
+            if (timeout < 0 || retry < timeout) timeout = retry;
+        }
+        if (release_ms >= 0 && (timeout < 0 || release_ms < timeout)) {
+            timeout = release_ms;
+        }
+        if (feed_ms >= 0 && (timeout < 0 || feed_ms < timeout)) {
+            timeout = feed_ms;
+        }
+        /* A fast replay waiting only on its own input has nothing to poll. */
+        if (replay.path && !replay.done && !replay.pending_len && feed_ms < 0 &&
+            replay_devices_ready() && regulator_held(&g_regulator) < g_regulator.capacity) {
+            timeout = 0;
+        }
 
-            uint32_t carry = g_cycle_carry;
-            g_cycle_carry = 0;
-            uint64_t total_cycles = carry;
+        int pr = poll(pfds, nfds, timeout);
+        if (pr < 0) {
+            if (errno == EINTR) continue;
+            perror("poll");
+            break;
+        }
+        now = monotonic_ms();
 
-            if (count > 0 && carry > 0) {
-                uint64_t first_delta = (uint64_t)events[0].delta + carry;
-                if (first_delta > UINT32_MAX) {
-                    uint64_t overflow = first_delta - UINT32_MAX;
-                    events[0].delta = UINT32_MAX;
-                    g_cycle_carry += (uint32_t)clamp_u32(overflow, PAL_MAX_CYCLE_CARRY);
-                } else {
-                    events[0].delta = (uint32_t)first_delta;
-                }
+        if (stdin_idx >= 0 && (pfds[stdin_idx].revents & POLLIN)) {
+            handle_local_input(show_status);
+        }
+        for (size_t i = 0; i < g_port_count; ++i) {
+            if (serial_idx[i] < 0) continue;
+            serial_port_t *port = &g_ports[i];
+            short re = pfds[serial_idx[i]].revents;
+            if ((re & POLLIN) && pump_serial_input(port) < 0) {
+                serial_port_close(port, strerror(errno));
+            } else if (re & (POLLERR | POLLHUP | POLLNVAL)) {
+                serial_port_close(port, "hangup");
+            } else if ((re & POLLOUT) && serial_flush(port) < 0) {
+                serial_port_close(port, strerror(errno));
             }
-
-            for (uint32_t i = 0; i < count; ++i) {
-                total_cycles += events[i].delta;
+        }
+        if (fifo_idx >= 0 && pfds[fifo_idx].revents) {
+            if (service_fifo(&fifo, verbose, now) < 0) {
+                break;
             }
-
-            uint32_t max_cycles = PAL_CYCLES_PER_FRAME + PAL_FRAME_TOLERANCE;
-            if (count > 0 && total_cycles > max_cycles) {
-                uint64_t overflow = total_cycles - max_cycles;
-                uint32_t reduction = (overflow > UINT32_MAX) ? UINT32_MAX : (uint32_t)overflow;
-                if (reduction >= events[count - 1].delta) {
-                    reduction = (events[count - 1].delta > 0) ? (events[count - 1].delta - 1u) : 0u;
-                }
-                if (reduction > 0) {
-                    events[count - 1].delta -= reduction;
-                    total_cycles -= reduction;
-                    g_cycle_carry += reduction;
-                    if (verbose && reduction >= PAL_OVERFLOW_WARN_THRESHOLD) {
-                        fprintf(stderr, "[warn] frame #%u overflow %u cycles, clamped\n",
-                                frame_no, reduction);
-                    }
-                } else {
-                    if (overflow > 0 && g_cycle_carry < PAL_MAX_CYCLE_CARRY) {
-                        uint32_t extra = (overflow > UINT32_MAX) ? UINT32_MAX : (uint32_t)overflow;
-                        g_cycle_carry += extra;
-                    }
+            /* Push new frames out right away rather than waiting for the
+             * next POLLOUT round trip. */
+            for (size_t i = 0; i < g_port_count; ++i) {
+                if (serial_flush(&g_ports[i]) < 0) {
+                    serial_port_close(&g_ports[i], strerror(errno));
                 }
             }
+        }
+        if (serial_path_count > 0 && serial_ports_open() == 0) {
+            fprintf(stderr, "[error] no serial device left, exiting\n");
+            break;
+        }
+        if (stdout_idx >= 0 && (pfds[stdout_idx].revents & (POLLOUT | POLLERR | POLLHUP))) {
+            status_flush();
+        }
+    }
 
-            if (total_cycles < PAL_CYCLES_PER_FRAME) {
-                uint32_t deficit = (uint32_t)(PAL_CYCLES_PER_FRAME - total_cycles);
-                g_cycle_carry += deficit;
-            }
-
-            if (g_cycle_carry > PAL_MAX_CYCLE_CARRY) {
-                g_cycle_carry = PAL_MAX_CYCLE_CARRY;
-            }
-
-		if (serial_fd >= 0) {
-			size_t total_bytes = sizeof(raw_hdr) + count * sizeof(sid_event_t);
-			struct iovec iov[2];
-			iov[0].iov_base = &raw_hdr;
-			iov[0].iov_len = sizeof(raw_hdr);
-			int iov_count = 1;
-			if (count > 0) {
-				for (uint32_t i = 0; i < count; ++i) {
-					events[i].delta = host_to_le32(events[i].delta);
-				}
-				iov[1].iov_base = events;
-				iov[1].iov_len = count * sizeof(sid_event_t);
-				iov_count = 2;
-			}
-			ssize_t wrote = writev(serial_fd, iov, iov_count);
-			if (wrote < 0 || (size_t) wrote != total_bytes) {
-				perror("write frame");
-				free(events);
-				g_running = 0;
-				break;
-			}
-			g_stats.serial_bytes += (size_t) wrote;
-		}
-
-            uint32_t frame_bytes = (uint32_t)(sizeof(raw_hdr) + count * sizeof(sid_event_t));
-            uint32_t frame_cycles = (total_cycles > UINT32_MAX) ? UINT32_MAX : (uint32_t)total_cycles;
-            monitor_update(&g_monitor,
-                           frame_no,
-                           count,
-                           frame_bytes,
-                           frame_cycles,
-                           g_cycle_carry,
-                           &frame_start,
-                           serial_fd >= 0,
-                           fifo_fd,
-                           show_status);
-
-            free(events);
-        }
-
-        if (fifo_fd >= 0) {
-            close(fifo_fd);
-        }
-    }
-
-    if (serial_fd >= 0) {
-        close(serial_fd);
-    }
-    g_serial_fd = -1;
+    fifo_input_close(&fifo, 0);
+
+    uint64_t deadline = monotonic_ms() + SHUTDOWN_DRAIN_MS;
+    for (size_t i = 0; i < g_port_count; ++i) {
+        serial_port_t *port = &g_ports[i];
+        while (port->fd >= 0 && serial_queue_used(port) > 0) {
+            uint64_t now = monotonic_ms();
+            if (now >= deadline) break;
+            struct pollfd p = {.fd = port->fd, .events = POLLOUT};
+            if (poll(&p, 1, ms_until(deadline, now)) <= 0) break;
+            if (serial_flush(port) < 0) break;
+        }
+        if (port->fd >= 0) {
+            close(port->fd);
+            port->fd = -1;
+        }
+    }
+    if (replay.path && replay.done && g_running) {
+        return replay_report(&replay);
+    }
     return 0;
 }
@@ -0,0 +1,493 @@
+/*
+ * ssf2col - convert a desidulate SSF or log CSV table to columnar *.ssfc.
+ *
+ *   ssf2col [-z <level>] [-g] <in.ssf.zst|in.csv|-> <out.ssfc>
+ *
+ * Each column is stored as one typed array: the narrowest integer type
+ * that holds every value, or f64 if any cell is fractional. Empty cells
+ * get a validity bitmap. With -z, columns are zstd-compressed when that
+ * makes them smaller. When the rows of each hashid are contiguous (as in
+ * SSF tables), a hashid -> row range index is written; -g first regroups
+ * the rows by hashid (stable, first-seen order) so any table gets one.
+ * Read the result with ssfcol.h.
+ */
+#define _POSIX_C_SOURCE 200809L
+#define _DARWIN_C_SOURCE 1
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ssf_reader.h"
+#include "ssfcol.h"
+
+#define MAX_FIELDS 128
+
+typedef struct {
+    char name[SSFCOL_NAME_MAX + 1];
+    int64_t *iv;
+    double *fv;                 /* set once the column turns fractional */
+    uint8_t *valid;
+    size_t cap;
+    bool has_nulls;
+    int64_t min;
+    int64_t max;
+} column_t;
+
+typedef struct {
+    int64_t hashid;
+    uint64_t first;
+    uint64_t count;
+} index_entry_t;
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [-z <level>] [-g] <in.ssf.zst|in.csv|-> <out.ssfc>\n"
+        "  -z <level>  zstd-compress columns (when smaller)\n"
+        "  -g          regroup rows by hashid so the index can be built\n",
+        prog);
+}
+
+static int column_reserve(column_t *c, size_t rows) {
+    if (rows <= c->cap) return 0;
+    size_t cap = c->cap ? c->cap * 2 : 4096;
+    while (cap < rows) cap *= 2;
+    int64_t *iv = realloc(c->iv, cap * sizeof *iv);
+    if (!iv) return -1;
+    c->iv = iv;
+    if (c->fv) {
+        double *fv = realloc(c->fv, cap * sizeof *fv);
+        if (!fv) return -1;
+        c->fv = fv;
+    }
+    uint8_t *valid = realloc(c->valid, (cap + 7) / 8);
+    if (!valid) return -1;
+    memset(valid + (c->cap + 7) / 8, 0, (cap + 7) / 8 - (c->cap + 7) / 8);
+    c->valid = valid;
+    c->cap = cap;
+    return 0;
+}
+
+static int column_to_float(column_t *c, size_t rows) {
+    c->fv = malloc((c->cap ? c->cap : 1) * sizeof *c->fv);
+    if (!c->fv) return -1;
+    for (size_t i = 0; i < rows; ++i) c->fv[i] = (double)c->iv[i];
+    return 0;
+}
+
+/* Store one cell; -1 on a non-numeric value or allocation failure. */
+static int column_put(column_t *c, size_t row, const char *s) {
+    if (column_reserve(c, row + 1) != 0) {
+        perror("ssf2col: alloc");
+        return -1;
+    }
+    c->iv[row] = 0;
+    if (c->fv) c->fv[row] = 0.0;
+    if (!*s || strcmp(s, "nan") == 0 || strcmp(s, "NaN") == 0 || strcmp(s, "NA") == 0) {
+        c->has_nulls = true;
+        return 0;
+    }
+    c->valid[row >> 3] |= (uint8_t)(1u << (row & 7));
+
+    int64_t iv;
+    double fv;
+    bool is_int = true;
+    char *end = NULL;
+    if (strcmp(s, "True") == 0 || strcmp(s, "False") == 0) {
+        iv = (s[0] == 'T');
+        fv = (double)iv;
+    } else {
+        errno = 0;
+        iv = strtoll(s, &end, 10);
+        if (*end || errno == ERANGE) {
+            is_int = false;
+            fv = strtod(s, &end);
+            if (*end) {
+                fprintf(stderr, "ssf2col: column %s: non-numeric value '%s'\n", c->name, s);
+                return -1;
+            }
+            iv = (int64_t)fv;
+        } else {
+            fv = (double)iv;
+        }
+    }
+    if (!is_int && !c->fv && column_to_float(c, row) != 0) {
+        perror("ssf2col: alloc");
+        return -1;
+    }
+    c->iv[row] = iv;
+    if (c->fv) c->fv[row] = fv;
+    if (iv < c->min) c->min = iv;
+    if (iv > c->max) c->max = iv;
+    return 0;
+}
+
+static uint8_t column_type(const column_t *c) {
+    if (c->fv) return SSFCOL_F64;
+    if (c->min >= INT8_MIN && c->max <= INT8_MAX) return SSFCOL_I8;
+    if (c->min >= INT16_MIN && c->max <= INT16_MAX) return SSFCOL_I16;
+    if (c->min >= INT32_MIN && c->max <= INT32_MAX) return SSFCOL_I32;
+    return SSFCOL_I64;
+}
+
+static size_t type_size(uint8_t type) {
+    switch (type) {
+    case SSFCOL_I8: return 1;
+    case SSFCOL_I16: return 2;
+    case SSFCOL_I32: return 4;
+    default: return 8;
+    }
+}
+
+/* Column values in row order `order`, packed little-endian as `type`. */
+static void column_pack(const column_t *c, uint8_t type, const size_t *order,
+                        size_t rows, uint8_t *out) {
+    size_t ts = type_size(type);
+    for (size_t i = 0; i < rows; ++i) {
+        size_t r = order ? order[i] : i;
+        uint64_t bits;
+        if (type == SSFCOL_F64) {
+            double d = c->fv[r];
+            memcpy(&bits, &d, sizeof bits);
+        } else {
+            bits = (uint64_t)c->iv[r];
+        }
+        for (size_t b = 0; b < ts; ++b) out[i * ts + b] = (uint8_t)(bits >> (8 * b));
+    }
+}
+
+typedef struct {
+    int64_t hashid;
+    uint64_t row;
+} row_key_t;
+
+static int cmp_row_key(const void *a, const void *b) {
+    const row_key_t *x = a, *y = b;
+    if (x->hashid != y->hashid) return (x->hashid > y->hashid) - (x->hashid < y->hashid);
+    return (x->row > y->row) - (x->row < y->row);
+}
+
+/* Group numbers by first row. */
+static int cmp_seen(const void *a, const void *b) {
+    uint64_t x = ((const row_key_t *)a)->row;
+    uint64_t y = ((const row_key_t *)b)->row;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Build the hashid index (sorted by hashid) into *out. If the rows of a
+ * hashid are not contiguous, regroup puts them together in first-seen
+ * order and *order receives the new row order; without regroup no index
+ * is built. Returns the entry count (0 = no index) or -1 on error.
+ */
+static long build_index(const column_t *hc, size_t rows, bool regroup,
+                        size_t **order, index_entry_t **out) {
+    *order = NULL;
+    *out = NULL;
+    row_key_t *keys = malloc((rows ? rows : 1) * sizeof *keys);
+    index_entry_t *groups = malloc((rows ? rows : 1) * sizeof *groups);
+    if (!keys || !groups) {
+        free(keys);
+        free(groups);
+        return -1;
+    }
+    for (size_t r = 0; r < rows; ++r) {
+        keys[r].hashid = hc->iv[r];
+        keys[r].row = r;
+    }
+    qsort(keys, rows, sizeof *keys, cmp_row_key);
+
+    size_t n = 0;
+    bool contiguous = true;
+    for (size_t i = 0; i < rows;) {
+        size_t j = i;
+        while (j < rows && keys[j].hashid == keys[i].hashid) j++;
+        groups[n].hashid = keys[i].hashid;
+        groups[n].first = keys[i].row;
+        groups[n].count = j - i;
+        if (keys[j - 1].row - keys[i].row + 1 != j - i) contiguous = false;
+        n++;
+        i = j;
+    }
+
+    if (!contiguous) {
+        if (!regroup) {
+            free(keys);
+            free(groups);
+            return 0;
+        }
+        size_t *ord = malloc((rows ? rows : 1) * sizeof *ord);
+        row_key_t *seen = malloc((n ? n : 1) * sizeof *seen);
+        if (!ord || !seen) {
+            free(ord);
+            free(seen);
+            free(keys);
+            free(groups);
+            return -1;
+        }
+        /* groups[] is in hashid order, like the runs of keys[]; lay the
+         * groups out by their first row, each keeping its row order. */
+        for (size_t g = 0; g < n; ++g) {
+            seen[g].hashid = (int64_t)g;        /* group number */
+            seen[g].row = groups[g].first;
+        }
+        qsort(seen, n, sizeof *seen, cmp_seen);
+        size_t *run = malloc((n ? n : 1) * sizeof *run);
+        if (!run) {
+            free(ord);
+            free(seen);
+            free(keys);
+            free(groups);
+            return -1;
+        }
+        for (size_t g = 0, k = 0; g < n; k += groups[g].count, ++g) run[g] = k;
+        uint64_t next = 0;
+        for (size_t i = 0; i < n; ++i) {
+            size_t g = (size_t)seen[i].hashid;
+            for (uint64_t k = 0; k < groups[g].count; ++k) {
+                ord[next + k] = keys[run[g] + k].row;
+            }
+            groups[g].first = next;
+            next += groups[g].count;
+        }
+        free(run);
+        free(seen);
+        *order = ord;
+    }
+    free(keys);
+    *out = groups;
+    return (long)n;
+}
+
+static int write_pad(FILE *fp, uint64_t *pos) {
+    static const uint8_t zeros[8] = {0};
+    size_t pad = (size_t)((8 - (*pos & 7)) & 7);
+    if (pad && fwrite(zeros, 1, pad, fp) != pad) return -1;
+    *pos += pad;
+    return 0;
+}
+
+static void put_le(uint8_t *p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+int main(int argc, char **argv) {
+    int level = 0;
+    bool regroup = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "z:gh")) != -1) {
+        switch (opt) {
+        case 'z':
+            level = atoi(optarg);
+            if (level < 1) level = 1;
+            break;
+        case 'g': regroup = true; break;
+        case 'h': usage(argv[0]); return 0;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (argc - optind != 2) {
+        usage(argv[0]);
+        return 1;
+    }
+#ifndef SSF_HAVE_ZSTD
+    if (level) {
+        fprintf(stderr, "ssf2col: -z needs a build with zstd support\n");
+        return 1;
+    }
+#endif
+    const char *in_path = argv[optind];
+    const char *out_path = argv[optind + 1];
+
+    ssf_reader_t r;
+    if (ssf_reader_open(&r, in_path) != 0) return 1;
+
+    column_t *cols = NULL;
+    int ncols = 0;
+    size_t rows = 0;
+    char *fields[MAX_FIELDS];
+    char *line;
+    size_t len;
+    int rc = 0;
+    while ((line = ssf_reader_line(&r, &len)) != NULL) {
+        if (len == 0) continue;
+        int n = ssf_split_csv(line, len, fields, MAX_FIELDS);
+        if (!cols) {
+            ncols = n;
+            cols = calloc((size_t)ncols, sizeof *cols);
+            if (!cols) {
+                perror("ssf2col: alloc");
+                rc = 1;
+                break;
+            }
+            for (int c = 0; c < ncols; ++c) {
+                snprintf(cols[c].name, sizeof cols[c].name, "%s", fields[c]);
+                cols[c].min = INT64_MAX;
+                cols[c].max = INT64_MIN;
+            }
+            continue;
+        }
+        for (int c = 0; c < ncols && rc == 0; ++c) {
+            if (column_put(&cols[c], rows, c < n ? fields[c] : "") != 0) rc = 1;
+        }
+        if (rc) break;
+        rows++;
+    }
+    if (r.error) rc = 1;
+    ssf_reader_close(&r);
+    if (!cols && rc == 0) {
+        fprintf(stderr, "ssf2col: %s: empty table\n", in_path);
+        rc = 1;
+    }
+    if (rc) goto done;
+
+    size_t *order = NULL;
+    index_entry_t *index = NULL;
+    long index_count = 0;
+    int hc = -1;
+    for (int c = 0; c < ncols; ++c) {
+        if (strcmp(cols[c].name, "hashid") == 0) hc = c;
+    }
+    if (hc >= 0 && !cols[hc].has_nulls && !cols[hc].fv) {
+        index_count = build_index(&cols[hc], rows, regroup, &order, &index);
+        if (index_count < 0) {
+            perror("ssf2col: alloc");
+            rc = 1;
+            goto done;
+        }
+        if (index_count == 0 && rows) {
+            fprintf(stderr, "ssf2col: hashid rows are not contiguous; no index (use -g)\n");
+        }
+    }
+
+    FILE *fp = fopen(out_path, "wb");
+    if (!fp) {
+        fprintf(stderr, "ssf2col: open %s: %s\n", out_path, strerror(errno));
+        rc = 1;
+        goto done_index;
+    }
+
+    /* Directory is rewritten once the data offsets are known. */
+    size_t dir_size = SSFCOL_HEADER_SIZE + (size_t)ncols * SSFCOL_COLUMN_SIZE;
+    uint8_t *dir = calloc(1, dir_size);
+    uint8_t *packed = NULL;
+    if (!dir) {
+        perror("ssf2col: alloc");
+        rc = 1;
+        fclose(fp);
+        goto done_index;
+    }
+    uint64_t pos = dir_size;
+    if (fwrite(dir, 1, dir_size, fp) != dir_size) rc = 1;
+    size_t bitmap_size = (rows + 7) / 8;
+    uint8_t *bitmap = malloc(bitmap_size ? bitmap_size : 1);
+    uint64_t stored_total = 0;
+    for (int c = 0; c < ncols && rc == 0; ++c) {
+        column_t *col = &cols[c];
+        uint8_t type = column_type(col);
+        size_t raw_size = rows * type_size(type);
+        free(packed);
+        packed = malloc(raw_size ? raw_size : 1);
+        if (!packed || !bitmap) {
+            perror("ssf2col: alloc");
+            rc = 1;
+            break;
+        }
+        column_pack(col, type, order, rows, packed);
+
+        const uint8_t *data = packed;
+        size_t data_size = raw_size;
+        uint8_t encoding = SSFCOL_RAW;
+#ifdef SSF_HAVE_ZSTD
+        void *z = NULL;
+        if (level && raw_size) {
+            size_t bound = ZSTD_compressBound(raw_size);
+            z = malloc(bound);
+            size_t zn = z ? ZSTD_compress(z, bound, packed, raw_size, level) : 0;
+            if (z && !ZSTD_isError(zn) && zn < raw_size) {
+                data = z;
+                data_size = zn;
+                encoding = SSFCOL_ZSTD;
+            }
+        }
+#endif
+        uint64_t data_offset = pos;
+        if (fwrite(data, 1, data_size, fp) != data_size) rc = 1;
+        pos += data_size;
+        stored_total += data_size;
+#ifdef SSF_HAVE_ZSTD
+        free(z);
+#endif
+        uint64_t null_offset = 0;
+        if (rc == 0 && col->has_nulls) {
+            memset(bitmap, 0, bitmap_size);
+            for (size_t i = 0; i < rows; ++i) {
+                size_t src = order ? order[i] : i;
+                if ((col->valid[src >> 3] >> (src & 7)) & 1u) {
+                    bitmap[i >> 3] |= (uint8_t)(1u << (i & 7));
+                }
+            }
+            if (write_pad(fp, &pos) != 0) rc = 1;
+            null_offset = pos;
+            if (fwrite(bitmap, 1, bitmap_size, fp) != bitmap_size) rc = 1;
+            pos += bitmap_size;
+        }
+        if (write_pad(fp, &pos) != 0) rc = 1;
+
+        uint8_t *e = dir + SSFCOL_HEADER_SIZE + (size_t)c * SSFCOL_COLUMN_SIZE;
+        memcpy(e, col->name, strlen(col->name));
+        e[40] = type;
+        e[41] = encoding;
+        e[42] = col->has_nulls ? SSFCOL_COLUMN_HAS_NULLS : 0;
+        put_le(e + 48, data_offset, 8);
+        put_le(e + 56, data_size, 8);
+        put_le(e + 64, raw_size, 8);
+        put_le(e + 72, null_offset, 8);
+    }
+    free(packed);
+    free(bitmap);
+
+    uint64_t index_offset = pos;
+    for (long i = 0; i < index_count && rc == 0; ++i) {
+        uint8_t e[SSFCOL_INDEX_ENTRY_SIZE];
+        put_le(e, (uint64_t)index[i].hashid, 8);
+        put_le(e + 8, index[i].first, 8);
+        put_le(e + 16, index[i].count, 8);
+        if (fwrite(e, 1, sizeof e, fp) != sizeof e) rc = 1;
+        pos += sizeof e;
+    }
+
+    memcpy(dir, SSFCOL_MAGIC, 4);
+    put_le(dir + 4, SSFCOL_VERSION, 2);
+    put_le(dir + 8, (uint64_t)ncols, 4);
+    put_le(dir + 12, (uint64_t)index_count, 4);
+    put_le(dir + 16, rows, 8);
+    put_le(dir + 24, index_offset, 8);
+    if (rc == 0 && (fseek(fp, 0, SEEK_SET) != 0 || fwrite(dir, 1, dir_size, fp) != dir_size)) {
+        rc = 1;
+    }
+    if (fclose(fp) != 0) rc = 1;
+    free(dir);
+    if (rc) {
+        fprintf(stderr, "ssf2col: write %s: %s\n", out_path, strerror(errno));
+    } else {
+        fprintf(stderr, "ssf2col: %s -> %s | rows: %zu | columns: %d | index: %ld | %llu bytes\n",
+                in_path, out_path, rows, ncols, index_count, (unsigned long long)pos);
+    }
+
+done_index:
+    free(order);
+    free(index);
+done:
+    for (int c = 0; c < ncols; ++c) {
+        free(cols[c].iv);
+        free(cols[c].fv);
+        free(cols[c].valid);
+    }
+    free(cols);
+    return rc;
+}
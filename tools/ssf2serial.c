@@ -1,5 +1,6 @@
 #define _POSIX_C_SOURCE 200809L
 #define _DARWIN_C_SOURCE 1
+#define _DEFAULT_SOURCE 1
 
 #include <errno.h>
 #include <fcntl.h>
@@ -17,6 +18,8 @@
 #include <time.h>
 #include <unistd.h>
 
+#include "beta99_packer.h"
+
 #ifndef SID_CLOCK_HZ_DOUBLE
 #define SID_CLOCK_HZ_DOUBLE 985248.0
 #endif
@@ -343,31 +346,147 @@ static int open_serial_device(const char *path, long baud)
   return fd;
 }
 
-/* ----- Simple SSF parsing and conversion to SID-style .bin ----- */
+/* ----- SSF rows to SID register events ----- */
+
+#define SID_REGS 0x19
 
+/*
+ * Per-hashid decoder. Rows are read as the beta99 packer reads them: an
+ * empty cell keeps the previous value, control and filter-mode bits are
+ * tracked one by one. `want` is the register file the rows describe so
+ * far; `sent` shadows what the event stream has written, so a row only
+ * costs the registers it actually changes.
+ */
 typedef struct {
-  int64_t hashid;
-  int64_t last_cycle;
-  int     have_last;
+  int64_t  hashid;
+  int64_t  last_cycle;
+  int      have_last;
+  uint32_t pending;            /* cycles not yet carried by an event */
+  uint8_t  want[SID_REGS];
+  uint32_t want_mask;          /* registers some column has described */
+  uint8_t  sent[SID_REGS];
+  uint32_t sent_mask;
 } hash_state_t;
 
+/* Growable .bin image for one fragment */
+typedef struct {
+  uint8_t *data;
+  size_t   len;
+  size_t   cap;
+} event_buf_t;
+
+typedef struct {
+  hash_state_t state;
+  event_buf_t  bin;
+  uint64_t     rows;
+} fragment_t;
+
+/*
+ * All fragments of an SSF file, built in one pass. Fragments keep the
+ * order in which their hashid first appears; `slots` is an open-addressing
+ * table (linear probing, power-of-two size) of fragment index + 1, 0 = empty.
+ */
+typedef struct {
+  fragment_t *frags;
+  size_t      count;
+  size_t      cap;
+  uint32_t   *slots;
+  size_t      slot_mask;
+  int         voice;        /* 0..2: registers the fragments are played on */
+  uint64_t    rows;
+} ssf_index_t;
+
+static uint64_t hash_slot(int64_t hashid)
+{
+  uint64_t x = (uint64_t)hashid;
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  return x;
+}
+
+static int index_grow_slots(ssf_index_t *ix)
+{
+  size_t new_size = ix->slots ? (ix->slot_mask + 1) * 2 : 1024;
+  uint32_t *slots = calloc(new_size, sizeof *slots);
+  if (!slots) {
+    perror("ssf2serial: alloc hash index");
+    return -1;
+  }
+  for (size_t i = 0; i < ix->count; ++i) {
+    size_t s = (size_t)hash_slot(ix->frags[i].state.hashid) & (new_size - 1);
+    while (slots[s]) s = (s + 1) & (new_size - 1);
+    slots[s] = (uint32_t)(i + 1);
+  }
+  free(ix->slots);
+  ix->slots = slots;
+  ix->slot_mask = new_size - 1;
+  return 0;
+}
+
+/* Find the fragment for a hashid, creating it on first sight */
+static fragment_t *index_fragment(ssf_index_t *ix, int64_t hashid)
+{
+  if (!ix->slots || (ix->count + 1) * 4 > (ix->slot_mask + 1) * 3) {
+    if (index_grow_slots(ix) != 0) return NULL;
+  }
+  size_t s = (size_t)hash_slot(hashid) & ix->slot_mask;
+  while (ix->slots[s]) {
+    fragment_t *f = &ix->frags[ix->slots[s] - 1];
+    if (f->state.hashid == hashid) return f;
+    s = (s + 1) & ix->slot_mask;
+  }
+  if (ix->count == ix->cap) {
+    size_t new_cap = ix->cap ? ix->cap * 2 : 128;
+    fragment_t *frags = realloc(ix->frags, new_cap * sizeof *frags);
+    if (!frags) {
+      perror("ssf2serial: realloc fragment list");
+      return NULL;
+    }
+    ix->frags = frags;
+    ix->cap = new_cap;
+  }
+  fragment_t *f = &ix->frags[ix->count++];
+  memset(f, 0, sizeof *f);
+  f->state.hashid = hashid;
+  ix->slots[s] = (uint32_t)ix->count;
+  return f;
+}
+
+static void index_free(ssf_index_t *ix)
+{
+  for (size_t i = 0; i < ix->count; ++i) {
+    free(ix->frags[i].bin.data);
+  }
+  free(ix->frags);
+  free(ix->slots);
+  memset(ix, 0, sizeof *ix);
+}
+
 /* Emit one 4-byte event: delta (16-bit LE), addr, value */
-static int emit_event(FILE *out, uint16_t delta, uint8_t addr, uint8_t value)
+static int emit_event(event_buf_t *out, uint16_t delta, uint8_t addr, uint8_t value)
 {
-  uint8_t buf[4];
+  if (out->len + 4 > out->cap) {
+    size_t new_cap = out->cap ? out->cap * 2 : 4096;
+    uint8_t *data = realloc(out->data, new_cap);
+    if (!data) {
+      perror("ssf2serial: realloc bin");
+      return -1;
+    }
+    out->data = data;
+    out->cap = new_cap;
+  }
+  uint8_t *buf = out->data + out->len;
   buf[0] = (uint8_t)(delta & 0xFF);
   buf[1] = (uint8_t)((delta >> 8) & 0xFF);
   buf[2] = addr;
   buf[3] = value;
-  if (fwrite(buf, 1, sizeof buf, out) != sizeof buf) {
-    perror("ssf2serial: write bin");
-    return -1;
-  }
+  out->len += 4;
   return 0;
 }
 
 /* Emit a pure delay (split into 0xFFFF chunks if needed) */
-static int emit_delay(FILE *out, uint32_t delta)
+static int emit_delay(event_buf_t *out, uint32_t delta)
 {
   while (delta > 0xFFFFu) {
     if (emit_event(out, 0xFFFFu, SID_DELAY_ADDR, 0) != 0) {
@@ -383,267 +502,242 @@ static int emit_delay(FILE *out, uint32_t delta)
   return 0;
 }
 
-/*
- * Very rough mapping from SSF columns to SID voice registers.
- * SSF line (CSV) example:
- *   hash, chip, cycle, 0, freq, pw, gate, ..., ..., ..., ..., ..., ..., ..., 19511, hash2, ..., ...
- *
- * We use:
- *   col 0: hashid (int64)
- *   col 1: chip index (0..2)
- *   col 2: absolute cycle
- *   col 4: freq (int, 0..65535)
- *   col 5: pw   (int, 0..4095)
- *   col 6: gate (0/1)
- */
-static int process_ssf_line_for_hash(FILE *bin_out,
-                                     const char *line,
-                                     int64_t target_hash,
-                                     hash_state_t *state)
+/* Register write carrying the pending delay; only delays over 16 bits
+ * need separate delay events. */
+static int emit_write(fragment_t *frag, uint8_t addr, uint8_t value)
 {
-  /* We need a scratch copy for strtok */
-  char buf[1024];
-  size_t len = strlen(line);
-  if (len >= sizeof buf) {
-    /* Too long, skip */
-    return 0;
+  hash_state_t *st = &frag->state;
+  uint32_t delta = st->pending;
+  st->pending = 0;
+  if (delta > 0xFFFFu) {
+    if (emit_delay(&frag->bin, delta - 0xFFFFu) != 0) {
+      return -1;
+    }
+    delta = 0xFFFFu;
   }
-  memcpy(buf, line, len + 1);
+  st->sent[addr] = value;
+  st->sent_mask |= 1u << addr;
+  return emit_event(&frag->bin, (uint16_t)delta, addr, value);
+}
 
-  char *saveptr = NULL;
-  char *fields[32];
-  int field_count = 0;
+static void set_reg(hash_state_t *st, int addr, uint8_t value)
+{
+  st->want[addr] = value;
+  st->want_mask |= 1u << addr;
+}
 
-  char *tok = strtok_r(buf, ",\r\n", &saveptr);
-  while (tok && field_count < (int)(sizeof fields / sizeof fields[0])) {
-    fields[field_count++] = tok;
-    tok = strtok_r(NULL, ",\r\n", &saveptr);
+static void set_reg_bits(hash_state_t *st, int addr, uint8_t mask, uint8_t bits)
+{
+  set_reg(st, addr, (uint8_t)((st->want[addr] & ~mask) | (bits & mask)));
+}
+
+#define HAS(row, c) (((row)->present >> (c)) & 1u)
+
+/*
+ * Apply one row's columns to the register file, with the beta99 player's
+ * mapping: the voice's own registers, freq3/test3 on the voice that
+ * modulates it (voice 3 for voice 1, and so on), the filter route bit of
+ * the voice, and the shared filter/volume registers.
+ */
+static void decode_row(hash_state_t *st, int voice, const beta99_ssf_row_t *row)
+{
+  const int64_t *v = row->v;
+  int base = voice * 7;
+  int mod_base = ((voice + 2) % 3) * 7;
+  uint8_t route = (uint8_t)(1u << voice);
+
+  if (HAS(row, BETA99_COL_FREQ1)) {
+    set_reg(st, base + 0, (uint8_t)(v[BETA99_COL_FREQ1] & 0xFF));
+    set_reg(st, base + 1, (uint8_t)((v[BETA99_COL_FREQ1] >> 8) & 0xFF));
+  }
+  if (HAS(row, BETA99_COL_PWDUTY1)) {
+    set_reg(st, base + 2, (uint8_t)(v[BETA99_COL_PWDUTY1] & 0xFF));
+    set_reg(st, base + 3, (uint8_t)((v[BETA99_COL_PWDUTY1] >> 8) & 0x0F));
+  }
+  for (int b = 0; b < 8; ++b) {
+    if (HAS(row, BETA99_COL_GATE1 + b)) {
+      set_reg_bits(st, base + 4, (uint8_t)(1u << b), v[BETA99_COL_GATE1 + b] ? 0xFF : 0x00);
+    }
   }
-  if (field_count < 3) {
-    return 0;
+  if (HAS(row, BETA99_COL_ATK1)) {
+    set_reg_bits(st, base + 5, 0xF0, (uint8_t)((v[BETA99_COL_ATK1] & 0x0F) << 4));
   }
-
-  /* Parse hashid */
-  char *endp = NULL;
-  int64_t hash = strtoll(fields[0], &endp, 10);
-  if (endp == fields[0]) {
-    return 0;
+  if (HAS(row, BETA99_COL_DEC1)) {
+    set_reg_bits(st, base + 5, 0x0F, (uint8_t)(v[BETA99_COL_DEC1] & 0x0F));
   }
-
-  if (hash != target_hash) {
-    return 0;
+  if (HAS(row, BETA99_COL_SUS1)) {
+    set_reg_bits(st, base + 6, 0xF0, (uint8_t)((v[BETA99_COL_SUS1] & 0x0F) << 4));
   }
-
-  /* Parse cycle */
-  if (!fields[2][0]) {
-    return 0;
+  if (HAS(row, BETA99_COL_REL1)) {
+    set_reg_bits(st, base + 6, 0x0F, (uint8_t)(v[BETA99_COL_REL1] & 0x0F));
   }
-  int64_t cycle = strtoll(fields[2], &endp, 10);
-  if (endp == fields[2]) {
-    return 0;
+  if (HAS(row, BETA99_COL_FREQ3)) {
+    set_reg(st, mod_base + 0, (uint8_t)(v[BETA99_COL_FREQ3] & 0xFF));
+    set_reg(st, mod_base + 1, (uint8_t)((v[BETA99_COL_FREQ3] >> 8) & 0xFF));
   }
-
-  /* Compute delta cycles */
-  uint32_t delta = 0;
-  if (state->have_last) {
-    if (cycle <= state->last_cycle) {
-      delta = 0;
-    } else {
-      int64_t diff = cycle - state->last_cycle;
-      if (diff > 0xFFFFFFFFLL) diff = 0xFFFFFFFFLL;
-      delta = (uint32_t)diff;
-    }
-  } else {
-    delta = 0;
-    state->have_last = 1;
+  if (HAS(row, BETA99_COL_TEST3)) {
+    set_reg_bits(st, mod_base + 4, 0x08, v[BETA99_COL_TEST3] ? 0x08 : 0x00);
   }
-  state->last_cycle = cycle;
-
-  /* Emit delay first */
-  if (emit_delay(bin_out, delta) != 0) {
-    return -1;
+  if (HAS(row, BETA99_COL_FLTCOFF)) {
+    set_reg(st, 0x15, (uint8_t)(v[BETA99_COL_FLTCOFF] & 0x07));
+    set_reg(st, 0x16, (uint8_t)((v[BETA99_COL_FLTCOFF] >> 3) & 0xFF));
   }
-
-  /* Now emit some SID register writes from SSF columns (best-effort guess) */
-  int chip_index = 0;
-  if (field_count > 1 && fields[1][0]) {
-    chip_index = (int)strtol(fields[1], NULL, 10);
-    if (chip_index < 0) chip_index = 0;
-    if (chip_index > 2) chip_index = 2;
+  if (HAS(row, BETA99_COL_FLT1)) {
+    set_reg_bits(st, 0x17, route, v[BETA99_COL_FLT1] ? route : 0x00);
   }
-
-  long freq = 0;
-  long pw = 0;
-  int gate = 0;
-
-  if (field_count > 4 && fields[4][0]) {
-    freq = strtol(fields[4], NULL, 10);
-    if (freq < 0) freq = 0;
-    if (freq > 65535) freq = 65535;
+  if (HAS(row, BETA99_COL_FLTEXT)) {
+    set_reg_bits(st, 0x17, 0x08, v[BETA99_COL_FLTEXT] ? 0x08 : 0x00);
   }
-  if (field_count > 5 && fields[5][0]) {
-    pw = strtol(fields[5], NULL, 10);
-    if (pw < 0) pw = 0;
-    if (pw > 4095) pw = 4095;
+  if (HAS(row, BETA99_COL_FLTRES)) {
+    set_reg_bits(st, 0x17, 0xF0, (uint8_t)((v[BETA99_COL_FLTRES] & 0x0F) << 4));
   }
-  if (field_count > 6 && fields[6][0]) {
-    gate = (int)strtol(fields[6], NULL, 10);
-    if (gate != 0) gate = 1;
+  for (int b = 0; b < 3; ++b) {
+    if (HAS(row, BETA99_COL_FLTLO + b)) {
+      set_reg_bits(st, 0x18, (uint8_t)(0x10u << b), v[BETA99_COL_FLTLO + b] ? 0xFF : 0x00);
+    }
+  }
+  if (HAS(row, BETA99_COL_VOL)) {
+    set_reg_bits(st, 0x18, 0x0F, (uint8_t)(v[BETA99_COL_VOL] & 0x0F));
   }
-
-  uint8_t freq_lo = (uint8_t)(freq & 0xFF);
-  uint8_t freq_hi = (uint8_t)((freq >> 8) & 0xFF);
-
-  uint8_t pw_lo = (uint8_t)(pw & 0xFF);
-  uint8_t pw_hi = (uint8_t)((pw >> 8) & 0x0F); /* 12-bit PW */
-
-  /* Very rough control: gate + triangle waveform */
-  uint8_t ctrl = (gate ? 0x01 : 0x00) | 0x10;
-
-  /* Dummy ADSR */
-  uint8_t attack_decay = 0xF9;       /* A=F, D=9 */
-  uint8_t sustain_release = 0xF6;    /* S=F, R=6 */
-
-  int base = chip_index * 7;
-
-  /* Write FREQ_LO/HIGH, PW_LO/HIGH, CTRL, ADSR. All with delta=0 */
-  if (emit_event(bin_out, 0, (uint8_t)(base + 0), freq_lo) != 0) return -1;
-  if (emit_event(bin_out, 0, (uint8_t)(base + 1), freq_hi) != 0) return -1;
-  if (emit_event(bin_out, 0, (uint8_t)(base + 2), pw_lo)   != 0) return -1;
-  if (emit_event(bin_out, 0, (uint8_t)(base + 3), pw_hi)   != 0) return -1;
-  if (emit_event(bin_out, 0, (uint8_t)(base + 4), ctrl)    != 0) return -1;
-  if (emit_event(bin_out, 0, (uint8_t)(base + 5), attack_decay) != 0) return -1;
-  if (emit_event(bin_out, 0, (uint8_t)(base + 6), sustain_release) != 0) return -1;
-
-  return 1; /* event(s) generated */
 }
 
-/* Convert all lines for a given hashid into a .bin file */
-static int build_bin_for_hash(const char *ssf_path,
-                              int64_t hashid,
-                              const char *bin_path)
+static int index_row(void *user, const beta99_ssf_row_t *row)
 {
-  FILE *in = fopen(ssf_path, "r");
-  if (!in) {
-    perror("ssf2serial: open ssf");
+  ssf_index_t *ix = user;
+  if (!g_running) {
     return -1;
   }
-  FILE *out = fopen(bin_path, "wb");
-  if (!out) {
-    perror("ssf2serial: open bin");
-    fclose(in);
+  fragment_t *frag = index_fragment(ix, row->hashid);
+  if (!frag) {
     return -1;
   }
-
-  char *line = NULL;
-  size_t cap = 0;
-  ssize_t n;
-  uint64_t events = 0;
-  hash_state_t st = { .hashid = hashid, .last_cycle = 0, .have_last = 0 };
-
-  while ((n = getline(&line, &cap, in)) != -1 && g_running) {
-    int r = process_ssf_line_for_hash(out, line, hashid, &st);
-    if (r < 0) {
-      free(line);
-      fclose(in);
-      fclose(out);
+  hash_state_t *st = &frag->state;
+  ix->rows++;
+  frag->rows++;
+
+  /* Rows of a hashid are clock-ordered; a step back counts as 0 */
+  int64_t cycle = row->v[BETA99_COL_CLOCK];
+  if (st->have_last && cycle > st->last_cycle) {
+    int64_t diff = cycle - st->last_cycle;
+    uint64_t pending = (uint64_t)st->pending + (uint64_t)diff;
+    st->pending = pending > 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)pending;
+  }
+  st->have_last = 1;
+  st->last_cycle = cycle;
+
+  decode_row(st, ix->voice, row);
+
+  /*
+   * Changed registers only. Envelope before control, so a gate-on in the
+   * same row starts with its own ADSR; the shared registers go last.
+   */
+  static const uint8_t voice_order[] = { 0, 1, 2, 3, 5, 6, 4 };
+  uint8_t order[SID_REGS];
+  int n = 0;
+  int base = ix->voice * 7;
+  int mod_base = ((ix->voice + 2) % 3) * 7;
+  for (size_t i = 0; i < sizeof voice_order; ++i) order[n++] = (uint8_t)(base + voice_order[i]);
+  order[n++] = (uint8_t)(mod_base + 0);
+  order[n++] = (uint8_t)(mod_base + 1);
+  order[n++] = (uint8_t)(mod_base + 4);
+  for (uint8_t addr = 0x15; addr <= 0x18; ++addr) order[n++] = addr;
+
+  for (int i = 0; i < n; ++i) {
+    uint8_t addr = order[i];
+    uint32_t bit = 1u << addr;
+    if (!(st->want_mask & bit)) {
+      continue;
+    }
+    if ((st->sent_mask & bit) && st->sent[addr] == st->want[addr]) {
+      continue;
+    }
+    if (emit_write(frag, addr, st->want[addr]) != 0) {
       return -1;
     }
-    if (r > 0) events += (uint64_t)r;
   }
-
-  free(line);
-  fclose(in);
-  fclose(out);
-
-  fprintf(stderr, "[ssf] hashid %lld -> %s (%llu events)\n",
-          (long long)hashid,
-          bin_path,
-          (unsigned long long)events);
   return 0;
 }
 
-/* Dynamic list for hashids */
-typedef struct {
-  int64_t *data;
-  size_t   count;
-  size_t   cap;
-} hash_list_t;
-
-/* Collect all unique hashids from the SSF file (dynamic grow) */
-static int collect_hashids(const char *ssf_path,
-                           hash_list_t *list)
+/*
+ * Read the SSF table once (CSV, zstd CSV or .ssfc), turning every row
+ * into its hashid's events as it streams past. The time after a
+ * fragment's last write is kept as a trailing delay.
+ */
+static int build_index(const char *ssf_path, const int64_t *only_hashid, ssf_index_t *ix)
 {
-  list->data  = NULL;
-  list->count = 0;
-  list->cap   = 0;
-
-  FILE *in = fopen(ssf_path, "r");
-  if (!in) {
-    perror("ssf2serial: open ssf");
+  if (beta99_ssf_read(ssf_path, only_hashid, index_row, ix) != 0) {
     return -1;
   }
-
-  char *line = NULL;
-  size_t cap = 0;
-  ssize_t n;
-
-  while ((n = getline(&line, &cap, in)) != -1 && g_running) {
-    if (n <= 0) continue;
-    char *p = line;
-    while (*p == ' ' || *p == '\t') p++;
-    if (!*p || *p == '#') continue;
-
-    char *endp = NULL;
-    int64_t hash = strtoll(p, &endp, 10);
-    if (endp == p) continue;
-
-    /* check if already present */
-    bool found = false;
-    for (size_t i = 0; i < list->count; ++i) {
-      if (list->data[i] == hash) {
-        found = true;
-        break;
-      }
-    }
-    if (!found) {
-      if (list->count == list->cap) {
-        size_t new_cap = list->cap ? list->cap * 2 : 128;
-        int64_t *new_data = realloc(list->data, new_cap * sizeof(int64_t));
-        if (!new_data) {
-          perror("ssf2serial: realloc hash list");
-          free(line);
-          fclose(in);
-          return -1;
-        }
-        list->data = new_data;
-        list->cap  = new_cap;
-      }
-      list->data[list->count++] = hash;
+  size_t bytes = 0;
+  for (size_t i = 0; i < ix->count; ++i) {
+    fragment_t *frag = &ix->frags[i];
+    if (emit_delay(&frag->bin, frag->state.pending) != 0) {
+      return -1;
     }
+    frag->state.pending = 0;
+    bytes += frag->bin.len;
+  }
+  fprintf(stderr, "[ssf] %llu rows, %zu unique hashids -> %zu events (%zu bytes)\n",
+          (unsigned long long)ix->rows, ix->count, bytes / DUMP_EVENT_SIZE, bytes);
+  return 0;
+}
+
+/* Write one fragment's .bin image */
+static int write_fragment_bin(const fragment_t *frag, const char *bin_path)
+{
+  FILE *out = fopen(bin_path, "wb");
+  if (!out) {
+    perror("ssf2serial: open bin");
+    return -1;
+  }
+  if (frag->bin.len && fwrite(frag->bin.data, 1, frag->bin.len, out) != frag->bin.len) {
+    perror("ssf2serial: write bin");
+    fclose(out);
+    return -1;
+  }
+  if (fclose(out) != 0) {
+    perror("ssf2serial: write bin");
+    return -1;
   }
 
-  free(line);
-  fclose(in);
-  fprintf(stderr, "[ssf] found %zu unique hashids\n", list->count);
+  fprintf(stderr, "[ssf] hashid %lld -> %s (%llu rows, %zu events)\n",
+          (long long)frag->state.hashid,
+          bin_path,
+          (unsigned long long)frag->rows,
+          frag->bin.len / DUMP_EVENT_SIZE);
   return 0;
 }
 
 static void usage(const char *prog)
 {
   fprintf(stderr,
-          "Usage: %s -f <serial> [-b <baud>] [-h <hashid>]\n"
+          "Usage: %s [-i <ssf>] -f <serial> [-b <baud>] [-h <hashid>] [-v <voice>]\n"
+          "       %s [-i <ssf>] -o <dir> [-h <hashid>] [-v <voice>]\n"
           "\n"
-          "Reads SSF CSV from stdin (e.g. via zstdcat) and streams\n"
-          "SID-style events to the Pico. If -h is omitted, all\n"
+          "Reads SSF CSV from <ssf> or stdin, plain or zstd-compressed%s, or an\n"
+          "ssf2col table (.ssfc), and streams\n"
+          "SID-style events to the Pico: the registers each row changes, on\n"
+          "voice <voice> (1-3, default 1). If -h is omitted, all\n"
           "hashids are played in sequence with 1s delay between.\n"
+          "With -o the .bin of every hashid (or just -h) is written\n"
+          "to <dir>/hash_<hashid>.bin instead of being streamed.\n"
           "\n"
           "Example (single hash):\n"
-          "  zstdcat tune.ssf.zst | %s -h -8316251235258051595 \\\n"
+          "  %s -i tune.ssf.zst -h -8316251235258051595 \\\n"
           "      -f /dev/cu.usbmodem00011 -b 2000000\n"
           "\n"
           "Example (all hashids):\n"
-          "  zstdcat tune.ssf.zst | %s -f /dev/cu.usbmodem00011 -b 2000000\n",
+          "  zstdcat tune.ssf.zst | %s -f /dev/cu.usbmodem00011 -b 2000000\n"
+          "\n"
+          "Example (export all hashids):\n"
+          "  %s -i tune.ssf.zst -o /tmp/tune-bins\n",
+          prog ? prog : "ssf2serial",
+          prog ? prog : "ssf2serial",
+#ifdef SSF_HAVE_ZSTD
+          "",
+#else
+          " (zstd needs zstdcat in this build)",
+#endif
           prog ? prog : "ssf2serial",
           prog ? prog : "ssf2serial",
           prog ? prog : "ssf2serial");
@@ -652,12 +746,15 @@ static void usage(const char *prog)
 int main(int argc, char **argv)
 {
   const char *serial_dev = NULL;
+  const char *export_dir = NULL;
+  const char *ssf_path = NULL;
   long baud = 2000000;
   int64_t target_hashid = 0;
   int have_hashid = 0;
+  long voice = 1;
 
   int opt;
-  while ((opt = getopt(argc, argv, "f:b:h:")) != -1) {
+  while ((opt = getopt(argc, argv, "i:f:b:h:o:v:")) != -1) {
     switch (opt) {
       case 'f':
         serial_dev = optarg;
@@ -673,25 +770,30 @@ int main(int argc, char **argv)
         target_hashid = strtoll(optarg, NULL, 10);
         have_hashid = 1;
         break;
+      case 'o':
+        export_dir = optarg;
+        break;
+      case 'i':
+        ssf_path = optarg;
+        break;
+      case 'v':
+        voice = strtol(optarg, NULL, 10);
+        if (voice < 1 || voice > 3) {
+          fprintf(stderr, "Invalid voice '%s' (1-3)\n", optarg);
+          return 1;
+        }
+        break;
       default:
         usage(argv[0]);
         return 1;
     }
   }
 
-  if (!serial_dev) {
+  if (!serial_dev && !export_dir) {
     usage(argv[0]);
     return 1;
   }
 
-  /* Workdir for temporary files */
-  char workdir_template[] = "/tmp/ssf2serial-XXXXXX";
-  char *workdir = mkdtemp(workdir_template);
-  if (!workdir) {
-    perror("ssf2serial: mkdtemp");
-    return 1;
-  }
-
   /* Install signal handlers */
   struct sigaction sa;
   memset(&sa, 0, sizeof sa);
@@ -699,92 +801,88 @@ int main(int argc, char **argv)
   sigaction(SIGINT, &sa, NULL);
   sigaction(SIGTERM, &sa, NULL);
 
-  /* Save stdin to an SSF temp file so we can re-read it */
-  char ssf_path[PATH_MAX];
-  snprintf(ssf_path, sizeof ssf_path, "%s/input.ssf", workdir);
-
-  FILE *ssf_out = fopen(ssf_path, "wb");
-  if (!ssf_out) {
-    perror("ssf2serial: open ssf temp");
+  /* One pass over the input groups every row by hashid */
+  ssf_index_t index;
+  memset(&index, 0, sizeof index);
+  index.voice = (int)voice - 1;
+  if (build_index(ssf_path, have_hashid ? &target_hashid : NULL, &index) != 0) {
+    index_free(&index);
+    return 1;
+  }
+  if (!index.count) {
+    if (have_hashid) {
+      fprintf(stderr, "ssf2serial: hashid %lld not found in input\n",
+              (long long)target_hashid);
+    } else {
+      fprintf(stderr, "ssf2serial: no hashids found in input\n");
+    }
+    index_free(&index);
     return 1;
   }
 
-  uint8_t buf[4096];
-  ssize_t n;
-  while ((n = read(STDIN_FILENO, buf, sizeof buf)) > 0) {
-    if (fwrite(buf, 1, (size_t)n, ssf_out) != (size_t)n) {
-      perror("ssf2serial: write ssf temp");
-      fclose(ssf_out);
+  if (export_dir) {
+    if (mkdir(export_dir, 0755) != 0 && errno != EEXIST) {
+      perror("ssf2serial: mkdir");
+      index_free(&index);
       return 1;
     }
+    int rc = 0;
+    for (size_t i = 0; i < index.count && g_running; ++i) {
+      char bin_path[PATH_MAX];
+      snprintf(bin_path, sizeof bin_path, "%s/hash_%lld.bin",
+               export_dir, (long long)index.frags[i].state.hashid);
+      if (write_fragment_bin(&index.frags[i], bin_path) != 0) {
+        rc = 1;
+        break;
+      }
+    }
+    index_free(&index);
+    return rc;
   }
-  fclose(ssf_out);
 
-  /* Open serial */
-  int serial_fd = open_serial_device(serial_dev, baud);
-  if (serial_fd < 0) {
+  /* Workdir for temporary files */
+  char workdir_template[] = "/tmp/ssf2serial-XXXXXX";
+  char *workdir = mkdtemp(workdir_template);
+  if (!workdir) {
+    perror("ssf2serial: mkdtemp");
+    index_free(&index);
     return 1;
   }
 
+  /* Open serial */
+  int serial_fd = open_serial_device(serial_dev, baud);
   int rc = 0;
+  if (serial_fd < 0) {
+    rc = 1;
+    goto cleanup;
+  }
 
-  if (have_hashid) {
-    /* Single-hash mode */
+  /* Play every fragment (just the -h one in single-hash mode) in order */
+  for (size_t i = 0; i < index.count && g_running; ++i) {
     char bin_path[PATH_MAX];
-    snprintf(bin_path, sizeof bin_path, "%s/hash_%lld.bin",
-             workdir, (long long)target_hashid);
+    snprintf(bin_path, sizeof bin_path, "%s/hash_%zu.bin", workdir, i);
 
-    if (build_bin_for_hash(ssf_path, target_hashid, bin_path) != 0) {
+    if (write_fragment_bin(&index.frags[i], bin_path) != 0) {
       rc = 1;
       goto cleanup;
     }
 
-    if (interactive_stream_bin(serial_fd, bin_path, true) != 0) {
+    bool wait_ready_flag = (i == 0);
+    if (interactive_stream_bin(serial_fd, bin_path, wait_ready_flag) != 0) {
       rc = 1;
       goto cleanup;
     }
-  } else {
-    /* Multi-hash mode: collect all hashids and play them in sequence */
-    hash_list_t list;
-    if (collect_hashids(ssf_path, &list) != 0) {
-      rc = 1;
-      goto cleanup;
-    }
-    if (!list.count) {
-      fprintf(stderr, "ssf2serial: no hashids found in input\n");
-      free(list.data);
-      rc = 1;
-      goto cleanup;
-    }
-
-    for (size_t i = 0; i < list.count && g_running; ++i) {
-      int64_t h = list.data[i];
-      char bin_path[PATH_MAX];
-      snprintf(bin_path, sizeof bin_path, "%s/hash_%zu.bin", workdir, i);
-
-      if (build_bin_for_hash(ssf_path, h, bin_path) != 0) {
-        rc = 1;
-        free(list.data);
-        goto cleanup;
-      }
+    unlink(bin_path);
 
-      bool wait_ready_flag = (i == 0);
-      if (interactive_stream_bin(serial_fd, bin_path, wait_ready_flag) != 0) {
-        rc = 1;
-        free(list.data);
-        goto cleanup;
-      }
-
-      if (i + 1 < list.count) {
-        fprintf(stderr, "[ssf] waiting 1 second before next hashid...\n");
-        usleep(300000);   // 100 ms        
-        //  sleep(1);
-      }
+    if (i + 1 < index.count) {
+      fprintf(stderr, "[ssf] waiting 1 second before next hashid...\n");
+      usleep(300000);   // 100 ms        
+      //  sleep(1);
     }
-    free(list.data);
   }
 
 cleanup:
+  index_free(&index);
   if (serial_fd >= 0) {
     close(serial_fd);
   }
@@ -0,0 +1,218 @@
+/*
+ * ssf_reader.h - buffered line reader and CSV splitter for SSF/log CSV.
+ *
+ * Shared by ssf2serial and sidripper. Input is a path or stdin; zstd
+ * frames (*.ssf.zst, *.log.zst) are detected by their magic and
+ * decompressed in-process when built with SSF_HAVE_ZSTD (link -lzstd),
+ * so no zstdcat subprocess or pipe is needed. Plain CSV is read as is.
+ *
+ * Lines are returned in place from one large buffer and split by
+ * overwriting the commas, so neither step copies the data.
+ */
+#ifndef SSF_READER_H
+#define SSF_READER_H
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef SSF_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define SSF_READ_BUF_SIZE (1u << 20)
+#define SSF_ZSTD_MAGIC 0xFD2FB528u
+
+typedef struct {
+    FILE *fp;
+    int owns_fp;
+    int compressed;
+    int eof;            /* no more input to fill from */
+    int error;
+    char *buf;          /* decompressed text; one spare byte for '\0' */
+    size_t cap;
+    size_t pos;         /* start of the next line */
+    size_t len;         /* bytes of text in buf */
+#ifdef SSF_HAVE_ZSTD
+    ZSTD_DStream *zds;
+    uint8_t *zin;
+    size_t zin_cap;
+    ZSTD_inBuffer in;
+#endif
+} ssf_reader_t;
+
+/* Raw bytes from the file into dst; 0 at end of file. */
+static size_t ssf_reader_read_raw(ssf_reader_t *r, void *dst, size_t cap) {
+    size_t n = fread(dst, 1, cap, r->fp);
+    if (n == 0 && ferror(r->fp)) {
+        perror("ssf: read");
+        r->error = 1;
+    }
+    return n;
+}
+
+/* Append decompressed (or plain) text to r->buf. Returns bytes added. */
+static size_t ssf_reader_fill(ssf_reader_t *r) {
+    size_t space = r->cap - r->len;
+    if (r->eof || space == 0) return 0;
+    if (!r->compressed) {
+        size_t n = ssf_reader_read_raw(r, r->buf + r->len, space);
+        if (n == 0) r->eof = 1;
+        r->len += n;
+        return n;
+    }
+#ifdef SSF_HAVE_ZSTD
+    ZSTD_outBuffer out = { r->buf + r->len, space, 0 };
+    while (out.pos == 0) {
+        if (r->in.pos == r->in.size) {
+            size_t n = ssf_reader_read_raw(r, r->zin, r->zin_cap);
+            if (n == 0) {
+                r->eof = 1;
+                break;
+            }
+            r->in.src = r->zin;
+            r->in.size = n;
+            r->in.pos = 0;
+        }
+        size_t rc = ZSTD_decompressStream(r->zds, &out, &r->in);
+        if (ZSTD_isError(rc)) {
+            fprintf(stderr, "ssf: zstd: %s\n", ZSTD_getErrorName(rc));
+            r->error = 1;
+            r->eof = 1;
+            break;
+        }
+    }
+    r->len += out.pos;
+    return out.pos;
+#else
+    return 0;
+#endif
+}
+
+/* Open `path` ("-" or NULL for stdin). Returns 0 or -1 with a message. */
+static int ssf_reader_open(ssf_reader_t *r, const char *path) {
+    memset(r, 0, sizeof *r);
+    if (!path || strcmp(path, "-") == 0) {
+        r->fp = stdin;
+    } else {
+        r->fp = fopen(path, "rb");
+        if (!r->fp) {
+            fprintf(stderr, "ssf: open %s: %s\n", path, strerror(errno));
+            return -1;
+        }
+        r->owns_fp = 1;
+    }
+    r->cap = SSF_READ_BUF_SIZE;
+    r->buf = malloc(r->cap + 1);
+    if (!r->buf) {
+        perror("ssf: alloc");
+        return -1;
+    }
+
+    uint8_t magic[4];
+    size_t got = ssf_reader_read_raw(r, magic, sizeof magic);
+    uint32_t m = (uint32_t)magic[0] | ((uint32_t)magic[1] << 8) |
+                 ((uint32_t)magic[2] << 16) | ((uint32_t)magic[3] << 24);
+    if (got == sizeof magic && m == SSF_ZSTD_MAGIC) {
+#ifdef SSF_HAVE_ZSTD
+        r->compressed = 1;
+        r->zin_cap = ZSTD_DStreamInSize() * 16;
+        r->zin = malloc(r->zin_cap);
+        r->zds = ZSTD_createDStream();
+        if (!r->zin || !r->zds) {
+            perror("ssf: alloc");
+            return -1;
+        }
+        ZSTD_initDStream(r->zds);
+        memcpy(r->zin, magic, sizeof magic);
+        r->in.src = r->zin;
+        r->in.size = sizeof magic;
+        r->in.pos = 0;
+#else
+        fprintf(stderr,
+                "ssf: %s is zstd-compressed but this build has no zstd support;\n"
+                "     rebuild with libzstd or pipe it through zstdcat\n",
+                path ? path : "stdin");
+        return -1;
+#endif
+    } else {
+        memcpy(r->buf, magic, got);
+        r->len = got;
+    }
+    return 0;
+}
+
+static void ssf_reader_close(ssf_reader_t *r) {
+    if (r->owns_fp && r->fp) fclose(r->fp);
+#ifdef SSF_HAVE_ZSTD
+    if (r->zds) ZSTD_freeDStream(r->zds);
+    free(r->zin);
+#endif
+    free(r->buf);
+    memset(r, 0, sizeof *r);
+}
+
+/*
+ * Next line, NUL-terminated in place with the "\r\n"/"\n" removed, or
+ * NULL at end of input (check r->error). The pointer stays valid until
+ * the next call. Lines longer than the buffer grow it.
+ */
+static char *ssf_reader_line(ssf_reader_t *r, size_t *out_len) {
+    size_t scanned = r->pos;
+    for (;;) {
+        char *nl = memchr(r->buf + scanned, '\n', r->len - scanned);
+        if (nl || (r->eof && r->len > r->pos)) {
+            char *line = r->buf + r->pos;
+            size_t end = nl ? (size_t)(nl - r->buf) : r->len;
+            r->pos = nl ? end + 1 : r->len;
+            if (end > (size_t)(line - r->buf) && r->buf[end - 1] == '\r') end--;
+            r->buf[end] = '\0';
+            if (out_len) *out_len = end - (size_t)(line - r->buf);
+            return line;
+        }
+        if (r->eof) return NULL;
+
+        /* Keep the partial line and make room behind it. */
+        size_t keep = r->len - r->pos;
+        if (r->pos > 0) {
+            memmove(r->buf, r->buf + r->pos, keep);
+            r->pos = 0;
+            r->len = keep;
+        } else if (r->len == r->cap) {
+            char *grown = realloc(r->buf, r->cap * 2 + 1);
+            if (!grown) {
+                perror("ssf: alloc");
+                r->error = 1;
+                return NULL;
+            }
+            r->buf = grown;
+            r->cap *= 2;
+        }
+        scanned = keep;
+        ssf_reader_fill(r);
+        if (r->error) return NULL;
+    }
+}
+
+/*
+ * Split a CSV line in place: each comma becomes '\0' and fields[] points
+ * at the pieces. Empty cells stay as empty strings, so column indices
+ * match the header. Returns the number of fields (at most max_fields).
+ */
+static int ssf_split_csv(char *line, size_t len, char **fields, int max_fields) {
+    int n = 0;
+    char *p = line;
+    char *end = line + len;
+    while (n < max_fields) {
+        fields[n++] = p;
+        char *comma = memchr(p, ',', (size_t)(end - p));
+        if (!comma) break;
+        *comma = '\0';
+        p = comma + 1;
+    }
+    return n;
+}
+
+#endif /* SSF_READER_H */
@@ -0,0 +1,188 @@
+/*
+ * ssfcol.c - mmap reader for *.ssfc columnar tables (see ssfcol.h).
+ *
+ * Build with -DSSF_HAVE_ZSTD -lzstd to read zstd-compressed columns; raw
+ * columns are used straight from the mapping.
+ */
+#define _POSIX_C_SOURCE 200809L
+#define _DARWIN_C_SOURCE 1
+
+#include "ssfcol.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef SSF_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+static uint16_t rd16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t rd32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+static uint64_t rd64(const uint8_t *p) {
+    return (uint64_t)rd32(p) | ((uint64_t)rd32(p + 4) << 32);
+}
+
+static size_t type_size(uint8_t type) {
+    switch (type) {
+    case SSFCOL_I8: return 1;
+    case SSFCOL_I16: return 2;
+    case SSFCOL_I32: return 4;
+    case SSFCOL_I64: return 8;
+    case SSFCOL_F64: return 8;
+    default: return 0;
+    }
+}
+
+/* [off, off + len) inside the file. */
+static bool in_file(const ssfcol_t *f, uint64_t off, uint64_t len) {
+    return off <= f->size && len <= f->size - off;
+}
+
+bool ssfcol_is_ssfc(const void *head, size_t len) {
+    return len >= 4 && memcmp(head, SSFCOL_MAGIC, 4) == 0;
+}
+
+static int fail(ssfcol_t *f, const char *path, const char *why) {
+    fprintf(stderr, "ssfcol: %s: %s\n", path, why);
+    ssfcol_close(f);
+    return -1;
+}
+
+int ssfcol_open(ssfcol_t *f, const char *path) {
+    memset(f, 0, sizeof *f);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "ssfcol: open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < SSFCOL_HEADER_SIZE) {
+        close(fd);
+        fprintf(stderr, "ssfcol: %s: not an ssfc file\n", path);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "ssfcol: mmap %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    f->base = map;
+    f->size = (size_t)st.st_size;
+
+    const uint8_t *h = f->base;
+    if (!ssfcol_is_ssfc(h, f->size) || rd16(h + 4) != SSFCOL_VERSION) {
+        return fail(f, path, "not an ssfc file");
+    }
+    f->column_count = rd32(h + 8);
+    f->index_count = rd32(h + 12);
+    f->row_count = rd64(h + 16);
+    uint64_t index_offset = rd64(h + 24);
+    if (!in_file(f, SSFCOL_HEADER_SIZE, (uint64_t)f->column_count * SSFCOL_COLUMN_SIZE) ||
+        !in_file(f, index_offset, (uint64_t)f->index_count * SSFCOL_INDEX_ENTRY_SIZE)) {
+        return fail(f, path, "truncated header");
+    }
+    f->index = f->index_count ? f->base + index_offset : NULL;
+
+    f->columns = calloc(f->column_count ? f->column_count : 1, sizeof *f->columns);
+    if (!f->columns) return fail(f, path, "out of memory");
+    for (uint32_t i = 0; i < f->column_count; ++i) {
+        const uint8_t *e = h + SSFCOL_HEADER_SIZE + (size_t)i * SSFCOL_COLUMN_SIZE;
+        ssfcol_column_t *c = &f->columns[i];
+        memcpy(c->name, e, SSFCOL_NAME_MAX);
+        c->name[SSFCOL_NAME_MAX] = '\0';
+        c->type = e[40];
+        c->encoding = e[41];
+        c->flags = e[42];
+        c->data_offset = rd64(e + 48);
+        c->data_size = rd64(e + 56);
+        c->raw_size = rd64(e + 64);
+        c->null_offset = rd64(e + 72);
+        size_t ts = type_size(c->type);
+        if (ts == 0 || c->raw_size != f->row_count * ts ||
+            (c->encoding != SSFCOL_RAW && c->encoding != SSFCOL_ZSTD) ||
+            (c->encoding == SSFCOL_RAW && c->data_size != c->raw_size) ||
+            !in_file(f, c->data_offset, c->data_size) ||
+            ((c->flags & SSFCOL_COLUMN_HAS_NULLS) &&
+             !in_file(f, c->null_offset, (f->row_count + 7) / 8))) {
+            return fail(f, path, "bad column directory");
+        }
+        if (c->flags & SSFCOL_COLUMN_HAS_NULLS) c->valid = f->base + c->null_offset;
+        if (c->encoding == SSFCOL_RAW) c->data = f->base + c->data_offset;
+    }
+    return 0;
+}
+
+void ssfcol_close(ssfcol_t *f) {
+    if (f->columns) {
+        for (uint32_t i = 0; i < f->column_count; ++i) free(f->columns[i].owned);
+        free(f->columns);
+    }
+    if (f->base) munmap((void *)f->base, f->size);
+    memset(f, 0, sizeof *f);
+}
+
+int ssfcol_find(const ssfcol_t *f, const char *name) {
+    for (uint32_t i = 0; i < f->column_count; ++i) {
+        if (strcmp(f->columns[i].name, name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+const ssfcol_column_t *ssfcol_column(ssfcol_t *f, int index) {
+    if (index < 0 || (uint32_t)index >= f->column_count) return NULL;
+    ssfcol_column_t *c = &f->columns[index];
+    if (c->data) return c;
+#ifdef SSF_HAVE_ZSTD
+    c->owned = malloc(c->raw_size ? c->raw_size : 1);
+    if (!c->owned) {
+        perror("ssfcol: alloc");
+        return NULL;
+    }
+    size_t n = ZSTD_decompress(c->owned, c->raw_size, f->base + c->data_offset,
+                               c->data_size);
+    if (ZSTD_isError(n) || n != c->raw_size) {
+        fprintf(stderr, "ssfcol: column %s: bad zstd data\n", c->name);
+        free(c->owned);
+        c->owned = NULL;
+        return NULL;
+    }
+    c->data = c->owned;
+    return c;
+#else
+    fprintf(stderr, "ssfcol: column %s is zstd-compressed but this build has no zstd support\n",
+            c->name);
+    return NULL;
+#endif
+}
+
+bool ssfcol_hashid_rows(const ssfcol_t *f, int64_t hashid,
+                        uint64_t *first, uint64_t *count) {
+    size_t lo = 0, hi = f->index_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const uint8_t *e = f->index + mid * SSFCOL_INDEX_ENTRY_SIZE;
+        int64_t h = (int64_t)rd64(e);
+        if (h == hashid) {
+            *first = rd64(e + 8);
+            *count = rd64(e + 16);
+            return *first <= f->row_count && *count <= f->row_count - *first;
+        }
+        if (h < hashid) lo = mid + 1;
+        else hi = mid;
+    }
+    return false;
+}
@@ -0,0 +1,115 @@
+/*
+ * ssfcol.h - columnar binary form of desidulate SSF/log tables (*.ssfc).
+ *
+ * ssf2col converts a CSV table once; readers mmap the result and use the
+ * typed column arrays directly instead of parsing text. Layout
+ * (little-endian, every section 8-byte aligned):
+ *
+ *   header     "SSFC" u16 version u16 flags u32 column_count u32 index_count
+ *              u64 row_count u64 index_offset                      (32 bytes)
+ *   columns    column_count directory entries                      (80 bytes)
+ *              char name[40] u8 type u8 encoding u8 flags u8 pad u32 reserved
+ *              u64 data_offset u64 data_size u64 raw_size u64 null_offset
+ *   data       per column: row_count values of the column type, raw or as
+ *              one zstd frame (encoding 1), plus a validity bitmap
+ *              (bit set = value present) when the column has empty cells
+ *   index      index_count entries sorted by hashid:
+ *              i64 hashid u64 first_row u64 row_count
+ *
+ * The hashid index exists when the rows of each hashid are contiguous
+ * (desidulate SSF tables are; ssf2col -g regroups other tables).
+ */
+#ifndef SSFCOL_H
+#define SSFCOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SSFCOL_MAGIC "SSFC"
+#define SSFCOL_VERSION 1
+#define SSFCOL_HEADER_SIZE 32
+#define SSFCOL_COLUMN_SIZE 80
+#define SSFCOL_INDEX_ENTRY_SIZE 24
+#define SSFCOL_NAME_MAX 40
+
+enum {
+    SSFCOL_I8 = 1,
+    SSFCOL_I16 = 2,
+    SSFCOL_I32 = 3,
+    SSFCOL_I64 = 4,
+    SSFCOL_F64 = 5,
+};
+
+enum {
+    SSFCOL_RAW = 0,
+    SSFCOL_ZSTD = 1,
+};
+
+#define SSFCOL_COLUMN_HAS_NULLS 0x01
+
+typedef struct {
+    char name[SSFCOL_NAME_MAX + 1];
+    uint8_t type;
+    uint8_t encoding;
+    uint8_t flags;
+    const void *data;           /* row_count values; NULL until loaded */
+    const uint8_t *valid;       /* validity bitmap, NULL = no empty cells */
+    uint64_t data_offset;
+    uint64_t data_size;
+    uint64_t raw_size;
+    uint64_t null_offset;
+    void *owned;                /* decompressed copy of a zstd column */
+} ssfcol_column_t;
+
+typedef struct {
+    const uint8_t *base;        /* the mapped file */
+    size_t size;
+    uint64_t row_count;
+    uint32_t column_count;
+    uint32_t index_count;
+    const uint8_t *index;
+    ssfcol_column_t *columns;
+} ssfcol_t;
+
+/* True when the first bytes of a file are an ssfc header. */
+bool ssfcol_is_ssfc(const void *head, size_t len);
+
+/* Map and validate path. Returns 0, or -1 after printing the reason. */
+int ssfcol_open(ssfcol_t *f, const char *path);
+void ssfcol_close(ssfcol_t *f);
+
+/* Column by name, or -1. */
+int ssfcol_find(const ssfcol_t *f, const char *name);
+
+/* Column with its data ready (zstd columns are decompressed on first use);
+ * NULL on error. */
+const ssfcol_column_t *ssfcol_column(ssfcol_t *f, int index);
+
+static inline bool ssfcol_present(const ssfcol_column_t *c, uint64_t row) {
+    return !c->valid || ((c->valid[row >> 3] >> (row & 7)) & 1u);
+}
+
+/* Value as int64 (floats are truncated like Python's int()). Check
+ * ssfcol_present() first; empty cells read as 0. */
+static inline int64_t ssfcol_i64(const ssfcol_column_t *c, uint64_t row) {
+    switch (c->type) {
+    case SSFCOL_I8: return ((const int8_t *)c->data)[row];
+    case SSFCOL_I16: return ((const int16_t *)c->data)[row];
+    case SSFCOL_I32: return ((const int32_t *)c->data)[row];
+    case SSFCOL_I64: return ((const int64_t *)c->data)[row];
+    case SSFCOL_F64: return (int64_t)((const double *)c->data)[row];
+    default: return 0;
+    }
+}
+
+static inline double ssfcol_f64(const ssfcol_column_t *c, uint64_t row) {
+    return c->type == SSFCOL_F64 ? ((const double *)c->data)[row]
+                                 : (double)ssfcol_i64(c, row);
+}
+
+/* Rows of hashid via the index: true with [*first, *first + *count). */
+bool ssfcol_hashid_rows(const ssfcol_t *f, int64_t hashid,
+                        uint64_t *first, uint64_t *count);
+
+#endif /* SSFCOL_H */
@@ -14,32 +14,37 @@
 // - Instrument digit per cell: keys '0'..'9'.
 // - Backspace deletes the note ('---') in current cell.
 // - Right side shows current cell instrument as I=xx and dummy W/F tables.
+// - Space plays the pattern in follow mode (the cursor tracks the
+//   playing row at tick rate); Ctrl-L repaints the screen.
+// - Only changed screen cells are redrawn (see "screen model").
+// - E exports the pattern for the device: <stem>.bin and <stem>.b99
+//   (stem from the command line, default "termtracker"), compiled by the
+//   shared tracker engine. Instrument digit d plays instrument d+1 of a
+//   built-in set.
 
 #define _POSIX_C_SOURCE 200809L
+#define _DARWIN_C_SOURCE 1
 
 #include <ctype.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <termios.h>
+#include <time.h>
 #include <unistd.h>
 #include <errno.h>
 
-#define NUM_CHANNELS   3
-#define PATTERN_ROWS   16
+#include "tracker_engine.h"
+#include "tracker_export.h"
 
-typedef int8_t Note; // -1 = empty, 0..95 = semitone C-0..B-7
-
-typedef struct {
-    Note    note;          // -1 means "---"
-    uint8_t instr;         // 0..9 for now
-    char    cmd[4];        // 3-char command + null (e.g. "C01", "---")
-} Cell;
-
-typedef struct {
-    Cell cell[PATTERN_ROWS][NUM_CHANNELS];
-} Pattern;
+// Rows shown and played; cells use the engine's Cell with instr = the
+// digit 0..9 and effect/effectParam for the 3-char command ("C01").
+#define EDIT_ROWS      16
 
 typedef struct {
     int cursorRow;     // 0..15
@@ -51,6 +56,9 @@ typedef struct {
 
 static struct termios g_orig_termios;
 static Pattern g_pattern;
+static Song g_song;          // g_pattern as the engine plays it
+static const char *g_export_stem = "termtracker";
+static char g_status[128];
 
 // --------- terminal raw mode helpers -------------------
 
@@ -124,27 +132,114 @@ static Note note_from_key(char c, int octave) {
 // --------- pattern init --------------------------------
 
 static void init_pattern(Pattern *p) {
+    memset(p, 0, sizeof(*p));
     for (int r = 0; r < PATTERN_ROWS; ++r) {
         for (int c = 0; c < NUM_CHANNELS; ++c) {
-            p->cell[r][c].note  = -1;
-            p->cell[r][c].instr = 0;
-            strcpy(p->cell[r][c].cmd, "---");
+            p->row[r][c].note  = -1;
         }
     }
 
     // Example: put C-2 0 C01 on row 0, chan 0 to match your sample.
-    p->cell[0][0].note  = 2 + 12 * 2; // C-2? (we'll just pick some semitone ~C-2-ish)
-    p->cell[0][0].instr = 0;
-    strcpy(p->cell[0][0].cmd, "C01");
+    p->row[0][0].note  = 2 + 12 * 2; // C-2? (we'll just pick some semitone ~C-2-ish)
+    p->row[0][0].instr = 0;
+    p->row[0][0].effect = 'C';
+    p->row[0][0].effectParam = 0x01;
 }
 
-// --------- helpers -------------------------------------
+static void cmd_to_string(const Cell *cell, char out[4]) {
+    if (!cell->effect) {
+        strcpy(out, "---");
+        return;
+    }
+    snprintf(out, 4, "%c%02X", cell->effect, cell->effectParam);
+}
+
+// --------- export --------------------------------------
+
+// Digit d -> instrument d+1: four plain waveforms, then variations.
+static void build_song(Song *s, const Pattern *p) {
+    memset(s, 0, sizeof(*s));
+    s->numPatterns = 1;
+    s->numOrders   = 1;
+    s->orderList[0] = 0;
+    s->patternRows = EDIT_ROWS;
+    s->speed = 6;
+    s->bpm   = 125;
+
+    for (int w = 0; w < 4; ++w) {
+        s->waveTables[w].length = 1;
+        s->waveTables[w].steps[0].waveform = (uint8_t)w;
+    }
+    // Major arpeggio on pulse
+    WaveTable *arp = &s->waveTables[4];
+    arp->length = 3;
+    arp->steps[1].transpose = 4;
+    arp->steps[2].transpose = 7;
+    for (int i = 0; i < 3; ++i) arp->steps[i].length = 1;
+
+    FilterTable *ft = &s->filterTables[0];
+    ft->length = 1;
+    ft->steps[0].cutoff = 128;
+    ft->steps[0].resonance = 64;
+    ft->steps[0].length = 1;
+
+    static const struct {
+        const char *name;
+        uint8_t wave, filter, a, d, s, r, vol;
+    } kInstruments[10] = {
+        { "Pulse",    0, 8, 2, 4, 40, 4, 48 },
+        { "Saw",      1, 8, 0, 6, 32, 6, 48 },
+        { "Tri",      2, 8, 1, 5, 56, 5, 56 },
+        { "Noise",    3, 8, 0, 5,  0, 3, 64 },
+        { "Arp",      4, 8, 0, 4, 48, 4, 40 },
+        { "FiltSaw",  1, 0, 0, 8, 48, 8, 56 },
+        { "FiltPul",  0, 0, 4, 4, 40, 6, 48 },
+        { "PadTri",   2, 8, 9, 9, 64, 9, 48 },
+        { "Pluck",    1, 8, 0, 3,  0, 2, 64 },
+        { "Hat",      3, 8, 0, 2,  0, 1, 40 },
+    };
+    s->numInstruments = 10;
+    for (int i = 0; i < 10; ++i) {
+        Instrument *inst = &s->instruments[i];
+        snprintf(inst->name, sizeof inst->name, "%s", kInstruments[i].name);
+        inst->waveTableIndex   = kInstruments[i].wave;
+        inst->filterTableIndex = kInstruments[i].filter;
+        inst->attack  = kInstruments[i].a;
+        inst->decay   = kInstruments[i].d;
+        inst->sustain = kInstruments[i].s;
+        inst->release = kInstruments[i].r;
+        inst->volume  = kInstruments[i].vol;
+    }
 
-static void clear_screen(void) {
-    // clear + home + disable line wrap for nicer alignment
-    printf("\x1b[2J\x1b[H\x1b[?7l");
+    for (int r = 0; r < EDIT_ROWS; ++r) {
+        for (int c = 0; c < NUM_CHANNELS; ++c) {
+            Cell cell = p->row[r][c];
+            cell.instr = (uint8_t)(cell.instr + 1);
+            s->patterns[0].row[r][c] = cell;
+        }
+    }
 }
 
+static void export_pattern(const Pattern *p) {
+    build_song(&g_song, p);
+
+    char binPath[512], b99Path[512];
+    snprintf(binPath, sizeof binPath, "%s.bin", g_export_stem);
+    snprintf(b99Path, sizeof b99Path, "%s.b99", g_export_stem);
+    TrackerExportStats st;
+    if (tracker_export(&g_song, binPath, b99Path, &st) != 0) {
+        snprintf(g_status, sizeof g_status, "Export to %s failed", g_export_stem);
+        return;
+    }
+    double songSec = (double)st.cycles / SID_CLOCK_HZ;
+    snprintf(g_status, sizeof g_status,
+             "Exported %.40s.bin/.b99: %.1f s of music in %.2f ms (%.0fx real time)",
+             g_export_stem, songSec, st.seconds * 1000.0,
+             st.seconds > 0 ? songSec / st.seconds : 0.0);
+}
+
+// --------- helpers -------------------------------------
+
 static void hex2(uint8_t v, char out[3]) {
     const char *hex = "0123456789ABCDEF";
     out[0] = hex[(v >> 4) & 0xF];
@@ -152,49 +247,234 @@ static void hex2(uint8_t v, char out[3]) {
     out[2] = '\0';
 }
 
+// --------- screen model --------------------------------
+//
+// Frames are drawn into a character grid and diffed against the grid the
+// terminal already shows; only changed spans go out, each behind a
+// cursor-addressing escape, batched into one write(). Over SSH a cursor
+// move or one edited cell costs a few dozen bytes instead of a full
+// repaint. Drawing is clipped to the terminal size, read on every full
+// repaint; SIGWINCH forces one.
+
+#define SCREEN_ROWS 24
+#define SCREEN_COLS 160
+#define SPAN_GAP    6   // unchanged cells worth resending to save an escape
+
+typedef struct {
+    char cell[SCREEN_ROWS][SCREEN_COLS];
+} Screen;
+
+typedef struct {
+    char   data[4 * SCREEN_ROWS * SCREEN_COLS];
+    size_t len;
+} OutBuf;
+
+static Screen g_frame;      // frame being drawn
+static Screen g_shown;      // what the terminal shows
+static volatile sig_atomic_t g_shownValid; // 0 = repaint everything on the next frame
+static int    g_repaint;    // the frame being drawn is a full repaint
+static int    g_rows = SCREEN_ROWS; // visible part of the grid
+static int    g_cols = SCREEN_COLS;
+
+static void on_winch(int sig) {
+    (void)sig;
+    g_shownValid = 0;
+}
+
+// Clip the grid to the terminal; keep the full grid if stdout is no tty.
+static void screen_size(void) {
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) != 0 || ws.ws_col == 0 || ws.ws_row == 0) {
+        g_rows = SCREEN_ROWS;
+        g_cols = SCREEN_COLS;
+        return;
+    }
+    g_rows = ws.ws_row < SCREEN_ROWS ? ws.ws_row : SCREEN_ROWS;
+    g_cols = ws.ws_col < SCREEN_COLS ? ws.ws_col : SCREEN_COLS;
+}
+
+static void screen_begin(void) {
+    if (!g_shownValid) {
+        // A resize arriving while this frame is drawn clears the flag
+        // again and is picked up by the next one.
+        g_shownValid = 1;
+        g_repaint = 1;
+        screen_size();
+    }
+    memset(g_frame.cell, ' ', sizeof g_frame.cell);
+}
+
+// printf into the frame at (row, col); clipped, no wrapping.
+static void screen_printf(int row, int col, const char *fmt, ...) {
+    if (row < 0 || row >= g_rows || col >= g_cols) return;
+    char tmp[SCREEN_COLS + 1];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(tmp, sizeof tmp, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if (n > g_cols - col) n = g_cols - col;
+    memcpy(&g_frame.cell[row][col], tmp, (size_t)n);
+}
+
+static void out_append(OutBuf *o, const char *data, size_t len) {
+    if (len > sizeof o->data - o->len) len = sizeof o->data - o->len;
+    memcpy(o->data + o->len, data, len);
+    o->len += len;
+}
+
+static void out_move(OutBuf *o, int row, int col) {
+    char esc[16];
+    int n = snprintf(esc, sizeof esc, "\x1b[%d;%dH", row + 1, col + 1);
+    out_append(o, esc, (size_t)n);
+}
+
+static void out_flush(const OutBuf *o) {
+    size_t off = 0;
+    while (off < o->len) {
+        ssize_t n = write(STDOUT_FILENO, o->data + off, o->len - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        off += (size_t)n;
+    }
+}
+
+// Send the differences between g_frame and g_shown.
+static void screen_flush(void) {
+    static OutBuf o;
+    o.len = 0;
+    if (g_repaint) {
+        // clear + home + disable line wrap for nicer alignment
+        out_append(&o, "\x1b[2J\x1b[H\x1b[?7l", 13);
+        memset(g_shown.cell, ' ', sizeof g_shown.cell);
+        g_repaint = 0;
+    }
+    for (int r = 0; r < g_rows; ++r) {
+        const char *want = g_frame.cell[r];
+        char *have = g_shown.cell[r];
+        int c = 0;
+        while (c < g_cols) {
+            if (want[c] == have[c]) {
+                c++;
+                continue;
+            }
+            // Extend the span over short unchanged stretches.
+            int start = c, end = c + 1;
+            for (int k = end; k < g_cols && k - end < SPAN_GAP; ++k) {
+                if (want[k] != have[k]) end = k + 1;
+            }
+            out_move(&o, r, start);
+            out_append(&o, want + start, (size_t)(end - start));
+            memcpy(have + start, want + start, (size_t)(end - start));
+            c = end;
+        }
+    }
+    if (o.len) out_flush(&o);
+}
+
 // --------- drawing -------------------------------------
 
-static void draw_ui(const Pattern *p, const EditorState *ed) {
-    clear_screen();
+static void draw_ui(const Pattern *p, const EditorState *ed, int playing) {
+    screen_begin();
 
-    printf("Tiny term-tracker (3ch, 16 rows)\n");
-    printf("Arrows: move  |  z/s/x/d/...: notes  |  -/=: octave (%d)  |  0-9: instr  |  Backspace: del note  |  q: quit\n\n",
-           ed->currentOctave);
+    screen_printf(0, 0, "Tiny term-tracker (3ch, 16 rows)");
+    screen_printf(1, 0, "Arrows: move  |  z/s/x/d/...: notes  |  -/=: octave (%d)  |  0-9: instr  |  Backspace: del note  |  Space: %s  |  E: export  |  q: quit",
+                  ed->currentOctave, playing ? "stop" : "play");
+    screen_printf(2, 0, "%s", g_status);
 
     // Header row for channels
-    printf("    CH0          CH1          CH2\n");
+    screen_printf(3, 0, "    CH0          CH1          CH2");
 
-    for (int r = 0; r < PATTERN_ROWS; ++r) {
+    for (int r = 0; r < EDIT_ROWS; ++r) {
+        int line = 4 + r;
         char rowHex[3];
         hex2((uint8_t)r, rowHex);
 
-        char cursorMark = (r == ed->cursorRow) ? '>' : ' ';
-        printf("%c%s ", cursorMark, rowHex);
+        char cursorMark = (r == ed->cursorRow) ? (playing ? '*' : '>') : ' ';
+        screen_printf(line, 0, "%c%s ", cursorMark, rowHex);
 
         for (int ch = 0; ch < NUM_CHANNELS; ++ch) {
-            const Cell *cell = &p->cell[r][ch];
-            char nstr[4];
+            const Cell *cell = &p->row[r][ch];
+            char nstr[4], cstr[4];
             note_to_string(cell->note, nstr);
-            printf("%3s %1d %3s", nstr, cell->instr, cell->cmd);
-            if (ch < NUM_CHANNELS - 1) printf(" ");
+            cmd_to_string(cell, cstr);
+            screen_printf(line, 4 + ch * 13, "%3s %1d %3s", nstr, cell->instr, cstr);
         }
 
         // Right-side info block similar to your example
+        int info = 4 + NUM_CHANNELS * 13 - 1;
         if (r == 0) {
-            const Cell *cur = &p->cell[ed->cursorRow][ed->cursorChan];
-            printf(" I=%02d", cur->instr);
+            const Cell *cur = &p->row[ed->cursorRow][ed->cursorChan];
+            screen_printf(line, info, " I=%02d", cur->instr);
         } else if (r == 1) {
-            printf(" W 00 00 F 00 00");
+            screen_printf(line, info, " W 00 00 F 00 00");
         } else if (r == 2) {
-            printf("   00 00   00 00");
+            screen_printf(line, info, "   00 00   00 00");
         } else if (r == 3) {
-            printf("   00 00   00 00");
+            screen_printf(line, info, "   00 00   00 00");
         }
+    }
+
+    screen_flush();
+}
+
+// --------- playback follow -----------------------------
+//
+// Space runs the engine over the pattern at tick rate (silently: the
+// writes are dropped) and the cursor follows the row being played, so a
+// tick redraws at most the two rows whose marker moved. Edits are picked
+// up at the next row.
+
+typedef struct {
+    int         playing;
+    EngineState engine;
+    double      tickSec;
+    double      nextTick;   // monotonic time of the next tick
+} Playback;
+
+static void discard_write(void *user, int chIndex, uint8_t addr, uint8_t value) {
+    (void)user; (void)chIndex; (void)addr; (void)value;
+}
 
-        printf("\n");
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void playback_start(Playback *pb) {
+    build_song(&g_song, &g_pattern);
+    engine_init(&pb->engine, &g_song, discard_write, NULL, NULL);
+    pb->tickSec  = engine_tick_seconds(&g_song);
+    pb->nextTick = now_seconds();
+    pb->playing  = 1;
+}
+
+// Run the ticks that are due; the cursor goes to the row being played.
+static void playback_advance(Playback *pb, EditorState *ed) {
+    double now = now_seconds();
+    if (now - pb->nextTick > 1.0) pb->nextTick = now; // stalled: don't race
+    while (pb->playing && now >= pb->nextTick) {
+        EngineState *e = &pb->engine;
+        if (e->tick == 0) {
+            build_song(&g_song, &g_pattern);
+            ed->cursorRow = e->row;
+        }
+        engine_tick(e);
+        if (e->songEnd) {
+            engine_init(e, &g_song, discard_write, NULL, NULL); // loop the pattern
+        }
+        pb->nextTick += pb->tickSec;
     }
+}
 
-    fflush(stdout);
+// poll() timeout until the next tick; -1 (wait for a key) when stopped.
+static int playback_timeout_ms(const Playback *pb) {
+    if (!pb->playing) return -1;
+    double ms = (pb->nextTick - now_seconds()) * 1000.0;
+    return ms > 0.0 ? (int)ms + 1 : 0;
 }
 
 // --------- input (arrow keys, etc.) --------------------
@@ -255,7 +535,8 @@ static KeyEvent get_key_event(void) {
 
 // --------- main loop -----------------------------------
 
-int main(void) {
+int main(int argc, char **argv) {
+    if (argc > 1) g_export_stem = argv[1];
     init_pattern(&g_pattern);
 
     EditorState ed;
@@ -265,9 +546,24 @@ int main(void) {
 
     enable_raw_mode();
 
+    // No SA_RESTART: the resize also wakes poll() for the repaint.
+    struct sigaction sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sa_handler = on_winch;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGWINCH, &sa, NULL);
+
+    Playback pb;
+    memset(&pb, 0, sizeof pb);
+
     int running = 1;
     while (running) {
-        draw_ui(&g_pattern, &ed);
+        draw_ui(&g_pattern, &ed, pb.playing);
+
+        struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+        int ready = poll(&pfd, 1, playback_timeout_ms(&pb));
+        if (pb.playing) playback_advance(&pb, &ed);
+        if (ready <= 0) continue;
 
         KeyEvent ev = get_key_event();
         if (ev.type == KEY_NONE) continue;
@@ -275,14 +571,14 @@ int main(void) {
         if (ev.type == KEY_ARROW_UP) {
             if (ed.cursorRow > 0) ed.cursorRow--;
         } else if (ev.type == KEY_ARROW_DOWN) {
-            if (ed.cursorRow < PATTERN_ROWS - 1) ed.cursorRow++;
+            if (ed.cursorRow < EDIT_ROWS - 1) ed.cursorRow++;
         } else if (ev.type == KEY_ARROW_LEFT) {
             if (ed.cursorChan > 0) ed.cursorChan--;
         } else if (ev.type == KEY_ARROW_RIGHT) {
             if (ed.cursorChan < NUM_CHANNELS - 1) ed.cursorChan++;
         } else if (ev.type == KEY_BACKSPACE) {
             // delete note on current cell
-            g_pattern.cell[ed.cursorRow][ed.cursorChan].note = -1;
+            g_pattern.row[ed.cursorRow][ed.cursorChan].note = -1;
         } else if (ev.type == KEY_OTHER) {
             char c = (char)ev.ch;
 
@@ -291,6 +587,22 @@ int main(void) {
                 continue;
             }
 
+            if (c == 'E') {
+                export_pattern(&g_pattern);
+                continue;
+            }
+
+            if (c == ' ') {
+                if (pb.playing) pb.playing = 0;
+                else playback_start(&pb);
+                continue;
+            }
+
+            if (c == 0x0C) { // Ctrl-L: full repaint
+                g_shownValid = 0;
+                continue;
+            }
+
             // octave control
             if (c == '-') {
                 if (ed.currentOctave > 0) ed.currentOctave--;
@@ -302,7 +614,7 @@ int main(void) {
 
             // instrument digit 0..9 for current cell
             if (c >= '0' && c <= '9') {
-                g_pattern.cell[ed.cursorRow][ed.cursorChan].instr =
+                g_pattern.row[ed.cursorRow][ed.cursorChan].instr =
                     (uint8_t)(c - '0');
                 continue;
             }
@@ -311,11 +623,11 @@ int main(void) {
             Note n = note_from_key((char)tolower((unsigned char)c),
                                    ed.currentOctave);
             if (n >= 0) {
-                Cell *cell = &g_pattern.cell[ed.cursorRow][ed.cursorChan];
+                Cell *cell = &g_pattern.row[ed.cursorRow][ed.cursorChan];
                 cell->note = n;
                 // If cmd is empty, leave it as-is; instrument stays whatever user set.
                 // Move down automatically (tracker style)
-                if (ed.cursorRow < PATTERN_ROWS - 1) {
+                if (ed.cursorRow < EDIT_ROWS - 1) {
                     ed.cursorRow++;
                 }
                 continue;
@@ -325,6 +637,9 @@ int main(void) {
         }
     }
 
-    // On exit, terminal raw mode is disabled by atexit
+    // Leave the cursor below the pattern with wrapping back on; raw mode
+    // is disabled by atexit
+    printf("\x1b[%d;1H\x1b[?7h\r\n", 4 + EDIT_ROWS + 1);
+    fflush(stdout);
     return 0;
 }
@@ -0,0 +1,208 @@
+// tracker_engine.c - rows and wave/filter tables to SID register writes.
+#include "tracker_engine.h"
+
+#include <math.h>
+#include <string.h>
+
+// ============ HELPER: note->frequency =================
+
+static float note_to_freq(Note n) {
+    if (n < 0) return 0.0f;
+    // Let note 60 = C-5 ~ 523.25 Hz for convenience
+    const float base = 523.25f;
+    int delta = (int)n - 60;
+    return base * powf(2.0f, delta / 12.0f);
+}
+
+static uint16_t freq_to_sid(float hz) {
+    double reg = hz * 16777216.0 / SID_CLOCK_HZ;
+    if (reg < 0.0) return 0;
+    if (reg > 65535.0) return 65535;
+    return (uint16_t)reg;
+}
+
+// ============ SID REGISTER WRITES =====================
+
+static void sid_write(EngineState *e, int chIndex, uint8_t addr, uint8_t value) {
+    if ((e->regsWritten & (1u << addr)) && e->regs[addr] == value) return;
+    e->regs[addr] = value;
+    e->regsWritten |= 1u << addr;
+    e->write(e->user, chIndex, addr, value);
+}
+
+static void write_voice(EngineState *e, int chIndex) {
+    ChannelState *ch = &e->ch[chIndex];
+    uint8_t base = (uint8_t)(chIndex * 7);
+    sid_write(e, chIndex, base + 0, (uint8_t)(ch->freq & 0xFF));
+    sid_write(e, chIndex, base + 1, (uint8_t)(ch->freq >> 8));
+    sid_write(e, chIndex, base + 4, (uint8_t)(ch->waveform | ch->gate));
+}
+
+static const uint8_t kWaveformBits[4] = {
+    0x40, // pulse
+    0x20, // saw
+    0x10, // tri
+    0x80, // noise
+};
+
+// ============ ADVANCE WAVE/FILTER TABLES ===============
+
+static void advance_wave_table(EngineState *e, int chIndex) {
+    const Song *s = e->song;
+    ChannelState *ch = &e->ch[chIndex];
+    if (ch->instrIndex == 0xFF) return;
+
+    const Instrument *inst = &s->instruments[ch->instrIndex];
+    if (inst->waveTableIndex >= 8) return;
+
+    const WaveTable *wt = &s->waveTables[inst->waveTableIndex];
+    if (wt->length == 0) return;
+
+    if (ch->waveTickLeft == 0) {
+        ch->wavePos = (ch->wavePos + 1) % wt->length;
+        ch->waveTickLeft = wt->steps[ch->wavePos].length;
+    } else {
+        ch->waveTickLeft--;
+    }
+
+    const WaveStep *step = &wt->steps[ch->wavePos];
+    Note n = ch->note;
+    if (n >= 0) n += step->transpose;
+    ch->freq = freq_to_sid(note_to_freq(n));
+    ch->waveform = kWaveformBits[step->waveform & 3];
+    write_voice(e, chIndex);
+}
+
+static void advance_filter_table(EngineState *e, int chIndex) {
+    const Song *s = e->song;
+    ChannelState *ch = &e->ch[chIndex];
+    if (ch->instrIndex == 0xFF) return;
+
+    const Instrument *inst = &s->instruments[ch->instrIndex];
+    if (inst->filterTableIndex >= 8) return;
+
+    const FilterTable *ft = &s->filterTables[inst->filterTableIndex];
+    if (ft->length == 0) return;
+
+    if (ch->filtTickLeft == 0) {
+        ch->filtPos = (ch->filtPos + 1) % ft->length;
+        ch->filtTickLeft = ft->steps[ch->filtPos].length;
+    } else {
+        ch->filtTickLeft--;
+    }
+
+    // One filter per chip: the last channel to step its table sets it.
+    const FilterStep *step = &ft->steps[ch->filtPos];
+    uint8_t route = (uint8_t)((e->regs[0x17] & 0x07) | (1u << chIndex));
+    sid_write(e, chIndex, 0x15, 0x00);
+    sid_write(e, chIndex, 0x16, step->cutoff);
+    sid_write(e, chIndex, 0x17, (uint8_t)((step->resonance & 0xF0) | route));
+    sid_write(e, chIndex, 0x18, 0x1F); // low-pass, full volume
+}
+
+// ============ PROCESS ROW ==============================
+
+static void process_row(EngineState *e) {
+    const Song *s = e->song;
+    if (e->order >= s->numOrders) {
+        e->songEnd = 1;
+        return;
+    }
+
+    uint8_t patIndex = s->orderList[e->order];
+    if (patIndex >= s->numPatterns) {
+        e->songEnd = 1;
+        return;
+    }
+
+    const Pattern *pat = &s->patterns[patIndex];
+
+    for (int chIndex = 0; chIndex < NUM_CHANNELS; ++chIndex) {
+        const Cell *cell = &pat->row[e->row][chIndex];
+        if (cell->note >= 0 && cell->note <= 95 && cell->instr > 0 &&
+            cell->instr <= s->numInstruments) {
+            // Note on
+            ChannelState *ch = &e->ch[chIndex];
+            if (e->noteOn) e->noteOn(e->user, chIndex);
+            ch->note       = cell->note;
+            ch->instrIndex = cell->instr - 1;
+            ch->wavePos    = 0;
+            ch->waveTickLeft = 0;
+            ch->filtPos    = 0;
+            ch->filtTickLeft = 0;
+
+            const Instrument *inst = &s->instruments[ch->instrIndex];
+            // The chip has no per-voice level: volume scales sustain.
+            unsigned sustain = (unsigned)inst->sustain * inst->volume * 15u / (64u * 64u);
+            uint8_t base = (uint8_t)(chIndex * 7);
+            sid_write(e, chIndex, base + 5,
+                      (uint8_t)(((inst->attack & 0x0F) << 4) | (inst->decay & 0x0F)));
+            sid_write(e, chIndex, base + 6, (uint8_t)(((sustain > 15 ? 15 : sustain) << 4) |
+                                                      (inst->release & 0x0F)));
+            ch->freq = freq_to_sid(note_to_freq(ch->note));
+            if (!ch->waveform) ch->waveform = kWaveformBits[0];
+            // Gate off then on restarts the envelope's attack
+            ch->gate = 0;
+            write_voice(e, chIndex);
+            ch->gate = 1;
+            write_voice(e, chIndex);
+            if (inst->filterTableIndex >= 8 || s->filterTables[inst->filterTableIndex].length == 0) {
+                sid_write(e, chIndex, 0x17, (uint8_t)(e->regs[0x17] & ~(1u << chIndex)));
+            }
+        }
+
+        // Effects can go here (arpeggio, slide, etc.) based on cell->effect
+    }
+}
+
+// ============ ENGINE API ===============================
+
+void engine_init(EngineState *e, const Song *song, SidWriteFn write,
+                 NoteOnFn noteOn, void *user) {
+    memset(e, 0, sizeof(*e));
+    e->song   = song;
+    e->write  = write;
+    e->noteOn = noteOn;
+    e->user   = user;
+    for (int i = 0; i < NUM_CHANNELS; ++i) {
+        e->ch[i].note       = -1;
+        e->ch[i].instrIndex = 0xFF;
+        sid_write(e, -1, (uint8_t)(i * 7 + 2), 0x00); // pulse width 50%
+        sid_write(e, -1, (uint8_t)(i * 7 + 3), 0x08);
+    }
+    sid_write(e, -1, 0x18, 0x0F);
+}
+
+void engine_tick(EngineState *e) {
+    const Song *s = e->song;
+    uint8_t rows = s->patternRows;
+    if (rows == 0 || rows > PATTERN_ROWS) rows = PATTERN_ROWS;
+
+    if (e->tick == 0) {
+        process_row(e);
+    }
+
+    // Advance per-channel tables every tick
+    for (int i = 0; i < NUM_CHANNELS; ++i) {
+        advance_wave_table(e, i);
+        advance_filter_table(e, i);
+    }
+
+    // Next tick
+    e->tick++;
+    if (e->tick >= s->speed) {
+        e->tick = 0;
+        e->row++;
+        if (e->row >= rows) {
+            e->row = 0;
+            e->order++;
+            if (e->order >= s->numOrders) {
+                e->songEnd = 1;
+            }
+        }
+    }
+}
+
+double engine_tick_seconds(const Song *song) {
+    return (2.5 * song->speed) / (double)song->bpm; // ProTracker-ish formula
+}
@@ -0,0 +1,141 @@
+// tracker_engine.h - song data and tick engine shared by the trackers.
+//
+// The engine turns a Song into SID register writes one tick at a time.
+// Where the writes go is up to the caller: oddtracker queues them on the
+// host sid_engine, tracker_export records them with their cycle times.
+#ifndef TRACKER_ENGINE_H
+#define TRACKER_ENGINE_H
+
+#include <stdint.h>
+
+typedef int8_t Note; // -1 = none, 0..95 = semitone
+
+typedef struct {
+    Note    note;
+    uint8_t instr;       // 1-based, 0 = none
+    uint8_t effect;
+    uint8_t effectParam;
+} Cell;
+
+#define NUM_CHANNELS 3
+#define PATTERN_ROWS 64  // storage; a song may use fewer (Song.patternRows)
+
+typedef struct {
+    Cell row[PATTERN_ROWS][NUM_CHANNELS];
+} Pattern;
+
+typedef struct {
+    uint8_t waveform;   // 0=pulse,1=saw,2=tri,3=noise
+    int8_t  transpose;  // semitones
+    uint8_t length;     // ticks
+} WaveStep;
+
+#define WAVETABLE_STEPS 32
+
+typedef struct {
+    WaveStep steps[WAVETABLE_STEPS];
+    uint8_t  length;
+} WaveTable;
+
+typedef struct {
+    uint8_t cutoff;     // 0..255
+    uint8_t resonance;  // 0..255
+    uint8_t length;     // ticks
+} FilterStep;
+
+#define FILTERTABLE_STEPS 32
+
+typedef struct {
+    FilterStep steps[FILTERTABLE_STEPS];
+    uint8_t    length;
+} FilterTable;
+
+typedef struct {
+    char     name[16];
+    uint8_t  waveTableIndex;
+    uint8_t  filterTableIndex;
+    uint8_t  attack, decay, sustain, release;
+    uint8_t  volume; // 0..64
+} Instrument;
+
+#define MAX_INSTRUMENTS 16
+#define MAX_PATTERNS    16
+#define MAX_ORDERS      64
+
+typedef struct {
+    uint8_t numPatterns;
+    uint8_t numOrders;
+    uint8_t orderList[MAX_ORDERS];
+    uint8_t patternRows; // rows played per pattern, 1..PATTERN_ROWS
+
+    uint8_t  speed; // ticks per row
+    uint16_t bpm;
+
+    Instrument  instruments[MAX_INSTRUMENTS];
+    uint8_t     numInstruments;
+
+    WaveTable   waveTables[8];
+    FilterTable filterTables[8];
+
+    Pattern     patterns[MAX_PATTERNS];
+} Song;
+
+// ===================== ENGINE STATE =====================
+
+#define SID_CLOCK_HZ 985248.0
+#define SID_REGS     0x19
+
+// chIndex is the channel whose row or table caused the write (the filter
+// registers are shared), -1 for the setup writes of engine_init().
+typedef void (*SidWriteFn)(void *user, int chIndex, uint8_t addr, uint8_t value);
+// Called on a note-on before its register writes; may be NULL.
+typedef void (*NoteOnFn)(void *user, int chIndex);
+
+typedef struct {
+    Note    note;
+    uint16_t freq;        // SID frequency register
+    uint8_t instrIndex;
+
+    // wave/filter table state
+    uint8_t wavePos;
+    uint8_t waveTickLeft;
+
+    uint8_t filtPos;
+    uint8_t filtTickLeft;
+
+    uint8_t waveform;     // control register bits without gate
+    uint8_t gate;
+} ChannelState;
+
+typedef struct {
+    uint8_t  tick;        // 0..speed-1
+    uint8_t  row;         // 0..patternRows-1
+    uint8_t  order;       // 0..numOrders-1
+
+    // per-channel runtime state
+    ChannelState ch[NUM_CHANNELS];
+
+    // last value written to each SID register, to skip redundant writes
+    uint8_t  regs[SID_REGS];
+    uint32_t regsWritten;   // bit per register
+
+    const Song *song;
+    int   songEnd;
+
+    SidWriteFn write;
+    NoteOnFn   noteOn;
+    void      *user;
+} EngineState;
+
+// Reset e to the start of song and write the initial register state
+// (pulse width 50%, full volume).
+void engine_init(EngineState *e, const Song *song, SidWriteFn write,
+                 NoteOnFn noteOn, void *user);
+
+// Process one tick: a new row on tick 0, then the wave/filter tables.
+void engine_tick(EngineState *e);
+
+// Classic tracker tick length = (2.5 * speed) / bpm seconds
+double engine_tick_seconds(const Song *song);
+
+#endif // TRACKER_ENGINE_H
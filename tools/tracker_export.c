@@ -0,0 +1,143 @@
+// tracker_export.c - headless engine run to .bin and beta99 (see
+// tracker_export.h).
+//
+// The engine's writes go to the .bin stream and to beta99_cutter, which
+// keeps a fragment per voice from note-on to note-on. Every tick ends with
+// a flush, so a voice gets at most one row per tick besides those of its
+// control register writes.
+#define _POSIX_C_SOURCE 200809L
+
+#include "tracker_export.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "beta99_cutter.h"
+
+#define SID_DELAY_ADDR 0xFFu   // as in sid2serial
+
+typedef struct {
+    uint64_t clock;
+
+    FILE    *bin;
+    uint64_t binClock;    // clock of the last .bin record
+    uint64_t events;
+
+    beta99_cutter_t *cutter;
+    int      error;
+} Exporter;
+
+static double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// ============ .bin STREAM ==============================
+
+static void bin_record(Exporter *x, uint16_t delta, uint8_t addr, uint8_t value) {
+    uint8_t rec[4] = { (uint8_t)(delta & 0xFF), (uint8_t)(delta >> 8), addr, value };
+    if (fwrite(rec, 1, sizeof rec, x->bin) != sizeof rec) x->error = 1;
+    x->events++;
+}
+
+static void bin_write(Exporter *x, uint8_t addr, uint8_t value) {
+    uint64_t delta = x->clock - x->binClock;
+    x->binClock = x->clock;
+    while (delta > 0xFFFF) {
+        bin_record(x, 0xFFFF, SID_DELAY_ADDR, 0);
+        delta -= 0xFFFF;
+    }
+    bin_record(x, (uint16_t)delta, addr, value);
+}
+
+// ============ ENGINE CALLBACKS =========================
+
+static void on_write(void *user, int chIndex, uint8_t addr, uint8_t value) {
+    Exporter *x = user;
+    if (x->bin) bin_write(x, addr, value);
+    if (x->cutter && beta99_cutter_write(x->cutter, x->clock, chIndex, addr, value) != 0) {
+        x->error = 1;
+    }
+}
+
+static void on_note_on(void *user, int chIndex) {
+    Exporter *x = user;
+    if (x->cutter && beta99_cutter_note_on(x->cutter, x->clock, chIndex) != 0) x->error = 1;
+}
+
+// ============ EXPORT ===================================
+
+int tracker_export(const Song *song, const char *binPath, const char *b99Path,
+                   TrackerExportStats *stats) {
+    if (song->bpm == 0) {
+        fprintf(stderr, "tracker_export: song has no tempo (bpm 0)\n");
+        return -1;
+    }
+    double t0 = monotonic_seconds();
+    // Whole cycles per tick, so equal fragments get equal relative clocks
+    // wherever they start (the drift is at most half a cycle per tick).
+    uint64_t cyclesPerTick = (uint64_t)(engine_tick_seconds(song) * SID_CLOCK_HZ + 0.5);
+
+    Exporter x;
+    memset(&x, 0, sizeof x);
+    if (binPath) {
+        x.bin = fopen(binPath, "wb");
+        if (!x.bin) {
+            fprintf(stderr, "tracker_export: open %s: %s\n", binPath, strerror(errno));
+            return -1;
+        }
+    }
+    if (b99Path && !(x.cutter = beta99_cutter_new(b99Path, 1))) {
+        if (x.bin) fclose(x.bin);
+        return -1;
+    }
+
+    EngineState e;
+    engine_init(&e, song, on_write, on_note_on, &x);
+    uint64_t ticks = 0;
+    while (!e.songEnd && !x.error) {
+        x.clock = ticks * cyclesPerTick;
+        engine_tick(&e);
+        if (x.cutter && beta99_cutter_flush(x.cutter) != 0) x.error = 1;
+        ticks++;
+    }
+    x.clock = ticks * cyclesPerTick;
+
+    int rc = 0;
+    if (x.error) {
+        fprintf(stderr, "tracker_export: %s\n",
+                x.bin && ferror(x.bin) ? "write error" : "out of memory");
+        rc = -1;
+    }
+    if (x.bin && fclose(x.bin) != 0 && rc == 0) {
+        fprintf(stderr, "tracker_export: write %s: %s\n", binPath, strerror(errno));
+        rc = -1;
+    }
+
+    beta99_pack_stats_t packed;
+    beta99_cutter_stats_t cut;
+    memset(&packed, 0, sizeof packed);
+    memset(&cut, 0, sizeof cut);
+    if (rc == 0 && x.cutter) {
+        beta99_bundle_t *b = beta99_cutter_pack(x.cutter, x.clock, BETA99_DEFAULT_MAX_OPS,
+                                                &packed, &cut);
+        if (!b || beta99_bundle_write(b, b99Path) != 0) rc = -1;
+        beta99_bundle_free(b);
+    }
+
+    if (stats) {
+        stats->ticks = ticks;
+        stats->cycles = x.clock;
+        stats->events = x.events;
+        stats->fragments = cut.fragments;
+        stats->uniqueFragments = cut.unique;
+        stats->bundleBytes = packed.bytes;
+        stats->seconds = monotonic_seconds() - t0;
+    }
+    beta99_cutter_free(x.cutter);
+    return rc;
+}
@@ -0,0 +1,33 @@
+// tracker_export.h - compile a tracker Song into device streams.
+//
+// Runs the engine headless, tick by tick on the PAL SID clock, and writes
+//   - a .bin stream in sid2serial's format: 4 bytes per write, u16 LE cycle
+//     delta, addr, value, with gaps over 0xFFFF cycles split into
+//     SID_DELAY_ADDR (0xFF) events;
+//   - a beta99 bundle: every note-on starts an SSF fragment on its voice
+//     that holds the voice's register writes (and the filter writes of its
+//     filter table) until the next note-on. Identical fragments are stored
+//     once and triggered again.
+#ifndef TRACKER_EXPORT_H
+#define TRACKER_EXPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tracker_engine.h"
+
+typedef struct {
+    uint64_t ticks;
+    uint64_t cycles;      // song length in SID cycles
+    uint64_t events;      // .bin records, delay records included
+    size_t   fragments;   // note-on fragments (beta99 triggers)
+    size_t   uniqueFragments;
+    size_t   bundleBytes;
+    double   seconds;     // wall time of the export
+} TrackerExportStats;
+
+// Either path may be NULL. Returns 0, or -1 after printing the reason.
+int tracker_export(const Song *song, const char *binPath, const char *b99Path,
+                   TrackerExportStats *stats);
+
+#endif // TRACKER_EXPORT_H